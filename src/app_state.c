@@ -13,17 +13,14 @@ void print_status(AppState* s)
     float cx = s->corners[sq][0];
     float cy = s->corners[sq][1];
 
-    printf("\n====================\n");
-    printf("EDIT MODE : %s\n", s->edit_mode ? "ON" : "OFF");
-    printf("SUBMODE   : %s\n", s->select_mode ? "SELECT" : "MOVE");
-    printf("SELECTED  : %s  (x=%.3f, y=%.3f)\n", corner_name_ui(s->selected_ui), cx, cy);
-    printf("CORNERS   : TL(%.3f,%.3f) TR(%.3f,%.3f) BL(%.3f,%.3f) BR(%.3f,%.3f)\n",
-           s->corners[C_TL][0], s->corners[C_TL][1],
-           s->corners[C_TR][0], s->corners[C_TR][1],
-           s->corners[C_BL][0], s->corners[C_BL][1],
-           s->corners[C_BR][0], s->corners[C_BR][1]);
-    printf("====================\n");
-    fflush(stdout);
+    // One line: this runs on every corner nudge.
+    log_info("[STATUS] edit %s, %s, selected %s (%.3f,%.3f) | TL(%.3f,%.3f) TR(%.3f,%.3f) BL(%.3f,%.3f) BR(%.3f,%.3f)",
+             s->edit_mode ? "ON" : "OFF", s->select_mode ? "SELECT" : "MOVE",
+             corner_name_ui(s->selected_ui), cx, cy,
+             s->corners[C_TL][0], s->corners[C_TL][1],
+             s->corners[C_TR][0], s->corners[C_TR][1],
+             s->corners[C_BL][0], s->corners[C_BL][1],
+             s->corners[C_BR][0], s->corners[C_BR][1]);
 }
 
 void rebuild_mesh_from_corners(AppState* s)
@@ -37,10 +34,10 @@ void rebuild_mesh_from_corners(AppState* s)
     );
 
     int v = 0;
-    for (int y = 0; y < GRID_Y; y++) {
-        for (int x = 0; x < GRID_X; x++) {
-            float fx = (float)x / (GRID_X - 1);
-            float fy = (float)y / (GRID_Y - 1);
+    for (int y = 0; y < s->grid_y; y++) {
+        for (int x = 0; x < s->grid_x; x++) {
+            float fx = (float)x / (s->grid_x - 1);
+            float fy = (float)y / (s->grid_y - 1);
 
             float px, py;
             apply_homography(s->H, fx, fy, &px, &py);
@@ -56,6 +53,41 @@ void rebuild_mesh_from_corners(AppState* s)
     glBufferSubData(GL_ARRAY_BUFFER, 0, s->numVerts * 4 * sizeof(float), s->vertices);
 }
 
+void app_state_set_grid(AppState* s, int gx, int gy)
+{
+    static GLushort indices[(GRID_X - 1) * (GRID_Y - 1) * 6];
+
+    gx = (gx < 2) ? 2 : (gx > GRID_X) ? GRID_X : gx;
+    gy = (gy < 2) ? 2 : (gy > GRID_Y) ? GRID_Y : gy;
+
+    int ii = 0;
+    for (int y = 0; y < gy - 1; y++) {
+        for (int x = 0; x < gx - 1; x++) {
+            int tl = y * gx + x;
+            int tr = tl + 1;
+            int bl = tl + gx;
+            int br = bl + 1;
+
+            indices[ii++] = (GLushort)tl;
+            indices[ii++] = (GLushort)bl;
+            indices[ii++] = (GLushort)tr;
+
+            indices[ii++] = (GLushort)tr;
+            indices[ii++] = (GLushort)bl;
+            indices[ii++] = (GLushort)br;
+        }
+    }
+
+    s->grid_x = gx;
+    s->grid_y = gy;
+    s->numVerts = gx * gy;
+    s->numIndices = ii;
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s->ebo);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, (size_t)ii * sizeof(GLushort), indices);
+    rebuild_mesh_from_corners(s);
+}
+
 int debounce_ok(Uint32* last_ms)
 {
     Uint32 now = SDL_GetTicks();
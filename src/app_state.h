@@ -10,10 +10,12 @@ typedef struct {
     float corners[4][2]; // BL,BR,TR,TL
     float H[9];
 
-    float* vertices;
+    float* vertices;     // GRID_X * GRID_Y capacity
     int numVerts;
     int numIndices;
+    int grid_x, grid_y;  // current mesh density (<= GRID_X, GRID_Y)
     GLuint vbo;
+    GLuint ebo;
 
     Uint32 last_btn1, last_btn2, last_btn3;
     Uint32 last_up, last_down, last_left, last_right;
@@ -21,4 +23,6 @@ typedef struct {
 
 void print_status(AppState* s);
 void rebuild_mesh_from_corners(AppState* s);
+/* Re-tessellates the warp mesh at gx x gy vertices (index + vertex buffers). */
+void app_state_set_grid(AppState* s, int gx, int gy);
 int debounce_ok(Uint32* last_ms);
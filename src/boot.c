@@ -0,0 +1,141 @@
+#include "boot.h"
+#include "gst_plugins.h"
+#include <unistd.h>
+
+/* ================= Time since process start ================= */
+
+static double process_start_boottime_ms(void)
+{
+    static double start_ms = -1.0;
+    if (start_ms >= 0.0) return start_ms;
+
+    start_ms = 0.0;
+    FILE* f = fopen("/proc/self/stat", "r");
+    if (!f) return start_ms;
+
+    char buf[1024];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+
+    // comm may contain spaces; fields resume after the last ')'
+    char* p = strrchr(buf, ')');
+    if (!p) return start_ms;
+
+    // field 3 (state) follows; starttime is field 22
+    unsigned long long starttime = 0;
+    int field = 2;
+    char* save = NULL;
+    for (char* tok = strtok_r(p + 1, " ", &save); tok; tok = strtok_r(NULL, " ", &save)) {
+        if (++field == 22) {
+            starttime = strtoull(tok, NULL, 10);
+            break;
+        }
+    }
+
+    long hz = sysconf(_SC_CLK_TCK);
+    if (hz > 0)
+        start_ms = (double)starttime * 1000.0 / (double)hz;
+    return start_ms;
+}
+
+double boot_elapsed_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    double now_ms = ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+    return now_ms - process_start_boottime_ms();
+}
+
+void boot_mark(const char* what)
+{
+    log_info("[BOOT] +%.1f ms %s", boot_elapsed_ms(), what);
+}
+
+/* ================= Worker ================= */
+
+static gpointer boot_worker(gpointer user)
+{
+    BootTask* b = (BootTask*)user;
+
+    Uint64 t0 = time_now_us();
+    gst_init(NULL, NULL);
+    log_info("[BOOT] gst_init took %.1f ms (%s plugin set)",
+             (time_now_us() - t0) / 1000.0, b->gst_pinned ? "pinned" : "full");
+    boot_mark("gst ready");
+
+    int ok = b->gapless ? video_start_gapless(&b->first, b->initial_path)
+                        : video_start(&b->first, b->initial_path);
+    boot_mark(ok ? "first pipeline started" : "first pipeline FAILED");
+
+    g_mutex_lock(&b->lock);
+    b->first_ok = ok;
+    b->pipeline_ready = 1;
+    g_cond_broadcast(&b->cond);
+    g_mutex_unlock(&b->lock);
+
+    // Deferred: the first clip is already decoding by now.
+    Playlist pl;
+    if (!playlist_load_from_home_videos(&pl, b->videos_dir, sizeof(b->videos_dir)))
+        memset(&pl, 0, sizeof(pl));
+    boot_mark("playlist scanned");
+
+    g_mutex_lock(&b->lock);
+    b->pl = pl;
+    b->playlist_done = 1;
+    g_mutex_unlock(&b->lock);
+
+    return NULL;
+}
+
+void boot_start(BootTask* b, const char* initial_path, int gapless)
+{
+    memset(b, 0, sizeof(*b));
+    g_mutex_init(&b->lock);
+    g_cond_init(&b->cond);
+    b->initial_path = initial_path;
+    b->gapless = gapless;
+
+    // setenv() is not thread-safe against SDL's getenv(): do it before spawning.
+    b->gst_pinned = gst_plugins_prepare();
+
+    b->thread = g_thread_new("boot", boot_worker, b);
+}
+
+int boot_wait_pipeline(BootTask* b, Video* out)
+{
+    g_mutex_lock(&b->lock);
+    while (!b->pipeline_ready)
+        g_cond_wait(&b->cond, &b->lock);
+    int ok = b->first_ok;
+    g_mutex_unlock(&b->lock);
+
+    *out = b->first;
+    video_reset(&b->first);
+    return ok;
+}
+
+int boot_take_playlist(BootTask* b, Playlist* out)
+{
+    if (b->playlist_taken) return 0;
+
+    g_mutex_lock(&b->lock);
+    int done = b->playlist_done;
+    g_mutex_unlock(&b->lock);
+    if (!done) return 0;
+
+    boot_join(b);
+    *out = b->pl;
+    memset(&b->pl, 0, sizeof(b->pl));
+    b->playlist_taken = 1;
+    return 1;
+}
+
+void boot_join(BootTask* b)
+{
+    if (!b->thread) return;
+    g_thread_join(b->thread);
+    b->thread = NULL;
+    g_mutex_clear(&b->lock);
+    g_cond_clear(&b->cond);
+}
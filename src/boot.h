@@ -0,0 +1,42 @@
+#pragma once
+#include "common.h"
+#include "playlist.h"
+#include "video.h"
+
+/*
+  Startup worker: runs gst_init() and starts the first pipeline while the
+  main thread brings up SDL/KMS and GL, then scans the playlist directory
+  off the critical path.
+*/
+typedef struct {
+    GThread* thread;
+    GMutex lock;
+    GCond cond;
+
+    const char* initial_path;
+    int gst_pinned;
+    int gapless;
+
+    Video first;
+    int first_ok;
+    int pipeline_ready;
+
+    Playlist pl;
+    char videos_dir[512];
+    int playlist_done;
+    int playlist_taken;
+} BootTask;
+
+/* Milliseconds since the process was started (from /proc/self/stat). */
+double boot_elapsed_ms(void);
+void   boot_mark(const char* what);
+
+void boot_start(BootTask* b, const char* initial_path, int gapless);
+
+/* Blocks until the first pipeline is started; moves it into *out. */
+int  boot_wait_pipeline(BootTask* b, Video* out);
+
+/* Non-blocking: returns 1 exactly once, when the playlist scan finished. */
+int  boot_take_playlist(BootTask* b, Playlist* out);
+
+void boot_join(BootTask* b);
@@ -0,0 +1,251 @@
+#include "commands.h"
+
+#include <stdarg.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define MAX_CHANNELS 4
+#define MAX_DEFERRED 32
+
+typedef struct {
+    Uint64 recv_us;
+    StatStage stage;
+} Applied;
+
+typedef struct {
+    Command cmd;
+    CmdChannel* ch;
+} Deferred;
+
+static CmdChannel* channels[MAX_CHANNELS];
+
+// Commands applied this frame, resolved to latencies after the swap
+static Applied applied[CMD_CHANNEL_CAP * MAX_CHANNELS + MAX_DEFERRED];
+static int applied_n;
+
+// Timed commands waiting for their frame (render thread only)
+static Deferred deferred[MAX_DEFERRED];
+static int deferred_n;
+
+static Uint64 last_swap_us;
+static Uint64 frame_us = 16667;
+
+int cmd_channel_init(CmdChannel* ch, const char* name, StatStage latency)
+{
+    memset(ch, 0, sizeof(*ch));
+    ch->name = name;
+    ch->latency = latency;
+    atomic_init(&ch->dropped, 0);
+    spsc_init(&ch->cmds, ch->cmd_slots, sizeof(Command), CMD_CHANNEL_CAP);
+    spsc_init(&ch->replies, ch->reply_slots, sizeof(CmdReply), CMD_CHANNEL_CAP);
+
+    ch->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return ch->wake_fd >= 0;
+}
+
+void cmd_channel_destroy(CmdChannel* ch)
+{
+    if (ch->wake_fd >= 0) close(ch->wake_fd);
+    ch->wake_fd = -1;
+}
+
+int cmd_submit(CmdChannel* ch, const Command* c)
+{
+    if (spsc_push(&ch->cmds, c)) return 1;
+    atomic_fetch_add_explicit(&ch->dropped, 1, memory_order_relaxed);
+    return 0;
+}
+
+void commands_register(CmdChannel* ch)
+{
+    for (int i = 0; i < MAX_CHANNELS; i++) {
+        if (!channels[i]) {
+            channels[i] = ch;
+            return;
+        }
+    }
+}
+
+void commands_unregister(CmdChannel* ch)
+{
+    for (int i = 0; i < MAX_CHANNELS; i++)
+        if (channels[i] == ch) channels[i] = NULL;
+}
+
+int cmd_corner_from_name(const char* name)
+{
+    for (int i = 0; i < 4; i++)
+        if (name && strcmp(name, corner_name_ui(i)) == 0) return i;
+    return -1;
+}
+
+/* ================= Render side ================= */
+
+static void reply(CmdChannel* ch, const Command* c, const char* fmt, ...)
+{
+    if (!c->client) return;
+
+    CmdReply r;
+    r.client = c->client;
+
+    int off = snprintf(r.text, sizeof(r.text), "{\"id\":%u,", c->id);
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(r.text + off, sizeof(r.text) - (size_t)off, fmt, ap);
+    va_end(ap);
+
+    if (spsc_push(&ch->replies, &r)) {
+        uint64_t one = 1;
+        if (write(ch->wake_fd, &one, sizeof(one)) < 0) { /* counter saturated: already awake */ }
+    }
+}
+
+static const char* resolve_path(const CmdTarget* t, const char* path)
+{
+    if (path[0] == '/') return path;
+    return playlist_find_name(t->pl, path);
+}
+
+static void apply_one(const CmdTarget* t, CmdChannel* ch, const Command* c)
+{
+    VideoEngine* ve = t->ve;
+    AppState* st = t->st;
+
+    switch (c->type) {
+    case CMD_TRANSITION:
+    case CMD_LOAD: {
+        const char* path = resolve_path(t, c->path);
+        if (!path) {
+            reply(ch, c, "\"ok\":false,\"error\":\"unknown clip\"}");
+            return;
+        }
+        if (c->type == CMD_TRANSITION)
+            ve_layer_request_transition(ve, c->layer, path);
+        else if (!ve_layer_load(ve, c->layer, path)) {
+            reply(ch, c, "\"ok\":false,\"error\":\"start failed\"}");
+            return;
+        }
+        reply(ch, c, "\"ok\":true}");
+        return;
+    }
+    case CMD_RANDOM: {
+        const char* cur = ve_base(ve)->cur.path;
+        const char* next = playlist_random(t->pl, cur[0] ? cur : NULL);
+        if (next) ve_request_transition(ve, next);
+        reply(ch, c, next ? "\"ok\":true}" : "\"ok\":false,\"error\":\"empty playlist\"}");
+        return;
+    }
+    case CMD_UNLOAD:
+        ve_layer_unload(ve, c->layer);
+        reply(ch, c, "\"ok\":true}");
+        return;
+    case CMD_SET_CORNER: {
+        if (c->index < 0 || c->index > 3) {
+            reply(ch, c, "\"ok\":false,\"error\":\"bad corner\"}");
+            return;
+        }
+        int sq = UI_TO_SQ_CORNER[c->index];
+        st->corners[sq][0] = c->f[0];
+        st->corners[sq][1] = c->f[1];
+        rebuild_mesh_from_corners(st);
+        reply(ch, c, "\"ok\":true}");
+        return;
+    }
+    case CMD_GET_CORNERS: {
+        float (*k)[2] = st->corners;
+        reply(ch, c, "\"ok\":true,\"corners\":{\"TL\":[%.4f,%.4f],\"TR\":[%.4f,%.4f],"
+                     "\"BL\":[%.4f,%.4f],\"BR\":[%.4f,%.4f]}}",
+              k[C_TL][0], k[C_TL][1], k[C_TR][0], k[C_TR][1],
+              k[C_BL][0], k[C_BL][1], k[C_BR][0], k[C_BR][1]);
+        return;
+    }
+    case CMD_SET_XFADE:
+        ve->xfade_seconds = (c->f[0] < 0.0f) ? 0.0f : c->f[0];
+        reply(ch, c, "\"ok\":true}");
+        return;
+    case CMD_SET_OPACITY:
+        ve_layer_set_opacity(ve, c->layer, c->f[0]);
+        reply(ch, c, "\"ok\":true}");
+        return;
+    case CMD_STATS: {
+        char js[1792];
+        if (!stats_format_json(js, sizeof(js))) snprintf(js, sizeof(js), "{}");
+        reply(ch, c, "\"ok\":true,\"dropped_commands\":%u,\"stats\":%s}", atomic_load_explicit(&ch->dropped, memory_order_relaxed), js);
+        return;
+    }
+    case CMD_FRAMES: {
+        if (c->layer < 0 || c->layer >= VE_MAX_LAYERS || !ve->layers[c->layer].active) {
+            reply(ch, c, "\"ok\":false,\"error\":\"layer not active\"}");
+            return;
+        }
+        const Layer* l = &ve->layers[c->layer];
+        char cur[400], nxt[400] = "null";
+        if (!video_frames_json(&l->cur, cur, sizeof(cur))) snprintf(cur, sizeof(cur), "{}");
+        if (l->transitioning && !video_frames_json(&l->nxt, nxt, sizeof(nxt))) snprintf(nxt, sizeof(nxt), "{}");
+        reply(ch, c, "\"ok\":true,\"layer\":%d,\"cur\":%s,\"nxt\":%s}", c->layer, cur, nxt);
+        return;
+    }
+    default:
+        reply(ch, c, "\"ok\":false,\"error\":\"unknown command\"}");
+        return;
+    }
+}
+
+static void apply_and_note(const CmdTarget* t, CmdChannel* ch, const Command* c)
+{
+    apply_one(t, ch, c);
+    if (applied_n < (int)(sizeof(applied) / sizeof(applied[0]))) {
+        // Timed commands count from their target time, i.e. how late they landed.
+        applied[applied_n].recv_us = (c->apply_at_us > c->recv_us) ? c->apply_at_us : c->recv_us;
+        applied[applied_n].stage = ch->latency;
+        applied_n++;
+    }
+}
+
+/* Due when the frame being drawn now is the first to present at/after apply_at. */
+static int is_due(const Command* c, Uint64 now)
+{
+    return c->apply_at_us == 0 || c->apply_at_us <= now + frame_us;
+}
+
+void commands_apply(const CmdTarget* t)
+{
+    Uint64 now = time_now_us();
+
+    for (int i = 0; i < deferred_n; ) {
+        if (is_due(&deferred[i].cmd, now)) {
+            apply_and_note(t, deferred[i].ch, &deferred[i].cmd);
+            deferred[i] = deferred[--deferred_n];
+        } else {
+            i++;
+        }
+    }
+
+    for (int i = 0; i < MAX_CHANNELS; i++) {
+        CmdChannel* ch = channels[i];
+        if (!ch) continue;
+
+        // With every deferred slot taken the rest stay queued, in order, until one is due.
+        Command c;
+        while (deferred_n < MAX_DEFERRED && spsc_pop(&ch->cmds, &c)) {
+            if (!is_due(&c, now)) {
+                deferred[deferred_n].cmd = c;
+                deferred[deferred_n].ch = ch;
+                deferred_n++;
+                continue;
+            }
+            apply_and_note(t, ch, &c);
+        }
+    }
+}
+
+void commands_after_swap(void)
+{
+    Uint64 now = time_now_us();
+    if (last_swap_us) frame_us = (frame_us * 7 + (now - last_swap_us)) / 8;
+    last_swap_us = now;
+
+    for (int i = 0; i < applied_n; i++)
+        stats_stage_add(applied[i].stage, applied[i].recv_us, 0);
+    applied_n = 0;
+}
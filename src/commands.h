@@ -0,0 +1,81 @@
+#pragma once
+#include "common.h"
+#include "app_state.h"
+#include "playlist.h"
+#include "spsc_ring.h"
+#include "stats.h"
+#include "video_engine.h"
+
+/*
+  Remote control commands. I/O threads (control socket, ...) parse
+  requests into Commands and push them into their own CmdChannel; the
+  render thread drains every registered channel once per frame, applies
+  the commands between frames and pushes replies back. Neither side
+  blocks on the other.
+*/
+
+typedef enum {
+    CMD_NONE = 0,
+    CMD_TRANSITION,     // layer, path (playlist file name or absolute path)
+    CMD_RANDOM,         // random playlist clip on the base layer
+    CMD_LOAD,           // layer, path
+    CMD_UNLOAD,         // layer
+    CMD_SET_CORNER,     // index (TL, TR, BL, BR), f = x, y
+    CMD_GET_CORNERS,
+    CMD_SET_XFADE,      // f[0] = seconds
+    CMD_SET_OPACITY,    // layer, f[0]
+    CMD_STATS,
+    CMD_FRAMES          // layer: per-clip frame accounting
+} CmdType;
+
+typedef struct {
+    CmdType type;
+    int layer;
+    int index;
+    float f[2];
+    char path[256];
+
+    Uint32 client;      // producer's reply target (0 = no reply)
+    Uint32 id;          // echoed in the reply
+    Uint64 recv_us;     // arrival on the I/O thread
+    Uint64 apply_at_us; // 0 = next frame; else the frame presented at/after this time
+} Command;
+
+typedef struct {
+    Uint32 client;
+    char text[2048];    // one JSON line without the newline
+} CmdReply;
+
+#define CMD_CHANNEL_CAP 64
+
+typedef struct {
+    const char* name;
+    SpscRing cmds;      // I/O thread -> render thread
+    SpscRing replies;   // render thread -> I/O thread
+    Command cmd_slots[CMD_CHANNEL_CAP];
+    CmdReply reply_slots[CMD_CHANNEL_CAP];
+    int wake_fd;        // eventfd, readable when replies are queued
+    StatStage latency;  // arrival -> frame latency is reported under this stage
+    atomic_uint dropped; // commands refused because the ring was full
+} CmdChannel;
+
+typedef struct {
+    VideoEngine* ve;
+    AppState* st;
+    const Playlist* pl;
+} CmdTarget;
+
+int  cmd_channel_init(CmdChannel* ch, const char* name, StatStage latency);
+void cmd_channel_destroy(CmdChannel* ch);
+
+/* I/O thread. Returns 0 when the render thread is CMD_CHANNEL_CAP commands behind. */
+int  cmd_submit(CmdChannel* ch, const Command* c);
+
+/* Render thread. */
+void commands_register(CmdChannel* ch);
+void commands_unregister(CmdChannel* ch);
+void commands_apply(const CmdTarget* t);
+void commands_after_swap(void);
+
+/* "TL", "TR", "BL", "BR" -> UI corner index, -1 if unknown. */
+int cmd_corner_from_name(const char* name);
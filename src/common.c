@@ -8,3 +8,51 @@ void handle_sigint(int sig)
     (void)sig;
     keepRunning = 0;
 }
+
+Uint64 time_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (Uint64)ts.tv_sec * 1000000ull + (Uint64)(ts.tv_nsec / 1000);
+}
+
+int env_flag(const char* name, int def)
+{
+    const char* v = getenv(name);
+    if (!v || !v[0]) return def;
+    return !(v[0] == '0' || v[0] == 'n' || v[0] == 'N' || v[0] == 'f' || v[0] == 'F');
+}
+
+static int ensure_dir(const char* path)
+{
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+
+    for (char* p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return 0;
+        *p = '/';
+    }
+    return mkdir(tmp, 0755) == 0 || errno == EEXIST;
+}
+
+const char* app_cache_dir(void)
+{
+    static char dir[512];
+    static int state = 0; // 0 = unresolved, 1 = ok, -1 = unusable
+
+    if (state == 0) {
+        const char* xdg = getenv("XDG_CACHE_HOME");
+        const char* home = getenv("HOME");
+        if (!home) home = "/home/pi";
+
+        if (xdg && xdg[0])
+            snprintf(dir, sizeof(dir), "%s/mapping_video_keystone", xdg);
+        else
+            snprintf(dir, sizeof(dir), "%s/.cache/mapping_video_keystone", home);
+
+        state = ensure_dir(dir) ? 1 : -1;
+    }
+    return (state > 0) ? dir : NULL;
+}
@@ -20,6 +20,9 @@
 #include <signal.h>
 #include <string.h>
 #include <time.h>
+#include <errno.h>
+
+#include "log.h"
 
 // ================= CONFIG =================
 
@@ -43,6 +46,9 @@ extern volatile int keepRunning;
 // Crossfade duration (seconds)
 #define XFADE_SECONDS 0.60f
 
+// Boot with a pinned plugin set + cached registry (MAPPER_GST_PINNED=0 to disable)
+#define GST_PINNED_DEFAULT 1
+
 // Corner order for homography: BL, BR, TR, TL
 typedef enum { C_BL=0, C_BR=1, C_TR=2, C_TL=3 } CornerSq;
 
@@ -51,3 +57,12 @@ extern const int UI_TO_SQ_CORNER[4];
 
 const char* corner_name_ui(int uiIdx);
 void handle_sigint(int sig);
+
+// Monotonic clock in microseconds (usable before SDL_Init and off-thread).
+Uint64 time_now_us(void);
+
+// Optional features: env var "0"/"1" overrides the compiled default.
+int env_flag(const char* name, int def);
+
+// Per-user cache directory (created on first use), e.g. ~/.cache/mapping_video_keystone
+const char* app_cache_dir(void);
@@ -0,0 +1,510 @@
+#include "compositor.h"
+#include "program_cache.h"
+#include "shaders.h"
+#include "pyramid.h"
+
+#define COMP_MAX_ITEMS (VE_MAX_LAYERS * 2)
+
+#define TRANS_SOFTNESS 0.12f
+
+typedef struct {
+    Video* v;
+    float alpha;
+    BlendMode mode;
+    const float* rect;
+    int layer;
+
+    Video* v2;                 // incoming clip when drawn by a transition program
+    TransitionKind trans;
+    float progress;
+    int prev;                  // A side is v's previous frame (blend cadence)
+} DrawItem;
+
+enum { OUT_OVER_BLACK = 0, OUT_SCALAR, OUT_SCREEN, OUT_MULTIPLY };
+
+static int load_program(CompProgram* p, int layers)
+{
+    const char* body = layer_fragment_shader_src;
+
+    size_t len = strlen(body) + 32;
+    char* src = (char*)malloc(len);
+    if (!src) return 0;
+    snprintf(src, len, "#define LAYERS %d\n#define PYRAMID %d\n%s", layers, pyramid_enabled(), body);
+
+    char name[32];
+    snprintf(name, sizeof(name), "layers%d%s", layers, pyramid_enabled() ? "-pyr" : "");
+    p->prog = program_cache_get(name, vertex_shader_src, src);
+    free(src);
+    if (!p->prog) return 0;
+
+    p->aPos = glGetAttribLocation(p->prog, "aPos");
+    p->aTex = glGetAttribLocation(p->prog, "aTex");
+    p->uOutput = glGetUniformLocation(p->prog, "uOutput");
+    p->uWarp = glGetUniformLocation(p->prog, "uWarp");
+    p->uHalfView = glGetUniformLocation(p->prog, "uHalfView");
+
+    for (int i = 0; i < layers; i++) {
+        char u[32];
+#define LOC(field, fmt) snprintf(u, sizeof(u), fmt, i); p->field[i] = glGetUniformLocation(p->prog, u)
+        LOC(uTexY,  "uTexY%d");
+        LOC(uTexU,  "uTexU%d");
+        LOC(uTexV,  "uTexV%d");
+        LOC(uTexA,  "uTexA%d");
+        LOC(uAlphaMode, "uAlphaMode%d");
+        LOC(uRange, "uVideoRange%d");
+        LOC(uBT709, "uBT709%d");
+        LOC(uDepth, "uDepth%d");
+        LOC(uSize,  "uSize%d");
+        LOC(uDeint, "uDeint%d");
+        LOC(uPyr,   "uPyr%d");
+        LOC(uPyrSize,  "uPyrSize%d");
+        LOC(uPyrScale, "uPyrScale%d");
+        LOC(uMode,  "uMode%d");
+        LOC(uAlpha, "uAlpha%d");
+        LOC(uRect,  "uRect%d");
+#undef LOC
+    }
+
+    if (p->aPos < 0 || p->aTex < 0) {
+        log_error("Shader attributes missing: aPos=%d aTex=%d", p->aPos, p->aTex);
+        return 0;
+    }
+    return 1;
+}
+
+static int load_trans_program(TransProgram* p, TransitionKind kind)
+{
+    const char* body = transition_fragment_shader_src;
+
+    size_t len = strlen(body) + 32;
+    char* src = (char*)malloc(len);
+    if (!src) return 0;
+    snprintf(src, len, "#define TRANSITION %d\n%s", (int)kind, body);
+
+    char name[32];
+    snprintf(name, sizeof(name), "trans-%s", transition_name(kind));
+    p->prog = program_cache_get(name, vertex_shader_src, src);
+    free(src);
+    if (!p->prog) return 0;
+
+    p->aPos = glGetAttribLocation(p->prog, "aPos");
+    p->aTex = glGetAttribLocation(p->prog, "aTex");
+    p->uOutput = glGetUniformLocation(p->prog, "uOutput");
+    p->uMode = glGetUniformLocation(p->prog, "uMode");
+    p->uAlpha = glGetUniformLocation(p->prog, "uAlpha");
+    p->uRect = glGetUniformLocation(p->prog, "uRect");
+    p->uProgress = glGetUniformLocation(p->prog, "uProgress");
+    p->uSoftness = glGetUniformLocation(p->prog, "uSoftness");
+    p->uMask = glGetUniformLocation(p->prog, "uMask");
+
+    static const char* plane[3] = { "Y", "U", "V" };
+    static const char* side[2] = { "A", "B" };
+    for (int i = 0; i < 2; i++) {
+        char u[32];
+        for (int k = 0; k < 3; k++) {
+            snprintf(u, sizeof(u), "uTex%s%s", plane[k], side[i]);
+            p->uTex[i][k] = glGetUniformLocation(p->prog, u);
+        }
+        snprintf(u, sizeof(u), "uAlphaMode%s", side[i]);
+        p->uAlphaMode[i] = glGetUniformLocation(p->prog, u);
+        snprintf(u, sizeof(u), "uVideoRange%s", side[i]);
+        p->uRange[i] = glGetUniformLocation(p->prog, u);
+        snprintf(u, sizeof(u), "uBT709%s", side[i]);
+        p->uBT709[i] = glGetUniformLocation(p->prog, u);
+        snprintf(u, sizeof(u), "uDepth%s", side[i]);
+        p->uDepth[i] = glGetUniformLocation(p->prog, u);
+        snprintf(u, sizeof(u), "uSize%s", side[i]);
+        p->uSize[i] = glGetUniformLocation(p->prog, u);
+        snprintf(u, sizeof(u), "uDeint%s", side[i]);
+        p->uDeint[i] = glGetUniformLocation(p->prog, u);
+    }
+
+    if (p->aPos < 0 || p->aTex < 0) {
+        log_error("Transition shader attributes missing: aPos=%d aTex=%d", p->aPos, p->aTex);
+        glDeleteProgram(p->prog);
+        p->prog = 0;
+        return 0;
+    }
+    return 1;
+}
+
+int compositor_init(Compositor* c, GLuint vbo, GLuint ebo)
+{
+    memset(c, 0, sizeof(*c));
+    c->vbo = vbo;
+    c->ebo = ebo;
+    c->last_items = c->last_draws = -1;
+
+    GLint vp[4] = { 0 };
+    glGetIntegerv(GL_VIEWPORT, vp);
+    c->view_w = vp[2];
+    c->view_h = vp[3];
+
+    // The pyramid atlas takes a fifth unit per layer, which can cost the two-layer pass.
+    pyramid_init();
+    c->units_per_layer = COMP_UNITS_PER_LAYER + (pyramid_enabled() ? 1 : 0);
+
+    GLint units = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &units);
+    c->max_per_pass = (units >= c->units_per_layer * COMP_MAX_PER_PASS) ? COMP_MAX_PER_PASS : 1;
+
+    for (int n = 1; n <= c->max_per_pass; n++) {
+        if (!load_program(&c->progs[n - 1], n))
+            return 0;
+    }
+
+    // Every style is built now: starting a transition must never compile.
+    // The fade program only serves the blend cadence.
+    Uint64 t0 = time_now_us();
+    int built = 0;
+    int first = (video_cadence_mode() == CADENCE_BLEND) ? TRANS_FADE : TRANS_FADE + 1;
+    for (int k = first; k < TRANS_COUNT; k++)
+        built += load_trans_program(&c->trans[k], (TransitionKind)k);
+    c->mask_tex = transition_load_mask(NULL);
+
+    log_info("[COMP] %d texture units, up to %d layer(s) per pass, %d transition program(s) in %.1f ms",
+             units, c->max_per_pass, built, (time_now_us() - t0) / 1000.0);
+    return 1;
+}
+
+void compositor_set_mask(Compositor* c, const char* bmp_path)
+{
+    GLuint tex = transition_load_mask(bmp_path);
+    if (!tex) return;
+    if (c->mask_tex) glDeleteTextures(1, &c->mask_tex);
+    c->mask_tex = tex;
+}
+
+void compositor_shutdown(Compositor* c)
+{
+    for (int i = 0; i < COMP_MAX_PER_PASS; i++)
+        if (c->progs[i].prog) glDeleteProgram(c->progs[i].prog);
+    for (int k = 0; k < TRANS_COUNT; k++)
+        if (c->trans[k].prog) glDeleteProgram(c->trans[k].prog);
+    if (c->mask_tex) glDeleteTextures(1, &c->mask_tex);
+    pyramid_shutdown();
+    memset(c, 0, sizeof(*c));
+}
+
+/* ================= Draw list ================= */
+
+static int rect_is_full(const float* r)
+{
+    return r[0] <= 0.0f && r[1] <= 0.0f && r[0] + r[2] >= 1.0f && r[1] + r[3] >= 1.0f;
+}
+
+static int item_is_opaque(const DrawItem* it)
+{
+    return it->alpha >= 1.0f && it->mode == BLEND_NORMAL && rect_is_full(it->rect) &&
+           it->v->alpha == VIDEO_ALPHA_NONE &&
+           (!it->v2 || it->v2->alpha == VIDEO_ALPHA_NONE);
+}
+
+/* Normal and add reduce to a scalar dst factor, so two of them fit one blend func. */
+static int item_is_scalar(const DrawItem* it)
+{
+    return !it->v2 && (it->mode == BLEND_NORMAL || it->mode == BLEND_ADD);
+}
+
+/* Transition programs have no A420 sampler; such layers fall back to a fade. */
+static int use_trans_program(const Compositor* c, const Layer* l)
+{
+    return l->transition != TRANS_FADE && c->trans[l->transition].prog &&
+           l->cur.alpha != VIDEO_ALPHA_PLANE && l->nxt.alpha != VIDEO_ALPHA_PLANE;
+}
+
+static int collect_items(const Compositor* c, VideoEngine* ve, DrawItem* items)
+{
+    int n = 0;
+    for (int i = 0; i < VE_MAX_LAYERS; i++) {
+        Layer* l = &ve->layers[i];
+        if (!l->active || l->opacity <= 0.0f) continue;
+
+        int mixing = l->transitioning && l->nxt.tex_inited && l->blend > 0.0f;
+
+        if (mixing && l->cur.tex_inited && use_trans_program(c, l)) {
+            DrawItem it = { &l->cur, l->opacity, l->blend_mode, l->rect, i,
+                            &l->nxt, l->transition, l->blend, 0 };
+            items[n++] = it;
+            continue;
+        }
+
+        // Blend cadence: previous and newest frame mixed by phase in one pass.
+        if (!mixing && l->cur.has_prev && l->cur.alpha != VIDEO_ALPHA_PLANE &&
+            l->cur.cad.weight < 1.0f && c->trans[TRANS_FADE].prog) {
+            DrawItem it = { &l->cur, l->opacity, l->blend_mode, l->rect, i,
+                            &l->cur, TRANS_FADE, l->cur.cad.weight, 1 };
+            items[n++] = it;
+            continue;
+        }
+
+        if (l->cur.tex_inited) {
+            DrawItem it = { &l->cur, l->opacity, l->blend_mode, l->rect, i, NULL, TRANS_FADE, 0.0f, 0 };
+            items[n++] = it;
+        }
+        if (mixing) {
+            DrawItem it = { &l->nxt, l->opacity * l->blend, l->blend_mode, l->rect, i, NULL, TRANS_FADE, 0.0f, 0 };
+            items[n++] = it;
+        }
+    }
+    return n;
+}
+
+/* A paused layer never gets a frame, so one still prerolling can't be culled. */
+static int layer_has_frames(const Layer* l)
+{
+    return l->cur.tex_inited && (!l->transitioning || l->nxt.tex_inited);
+}
+
+/* Drops items under the topmost opaque one; pauses layers that end up unseen. */
+static int cull_occluded(VideoEngine* ve, DrawItem* items, int n)
+{
+    int first = 0;
+    int occluder_layer = -1;
+    for (int k = n - 1; k >= 0; k--) {
+        if (item_is_opaque(&items[k])) {
+            first = k;
+            occluder_layer = items[k].layer;
+            break;
+        }
+    }
+
+    for (int i = 0; i < VE_MAX_LAYERS; i++) {
+        Layer* l = &ve->layers[i];
+        if (!l->active) continue;
+        int hidden = (l->opacity <= 0.0f) || (i < occluder_layer && layer_has_frames(l));
+        ve_layer_set_hidden(ve, i, hidden);
+    }
+
+    if (first > 0)
+        memmove(items, items + first, (size_t)(n - first) * sizeof(DrawItem));
+    return n - first;
+}
+
+/* ================= Submission ================= */
+
+static void bind_size(GLint loc, const Video* v)
+{
+    float sz[4];
+    video_plane_size(v, sz);
+    glUniform4f(loc, sz[0], sz[1], sz[2], sz[3]);
+}
+
+/* Field to show and how to rebuild the missing lines; see video_field_params. */
+static void bind_field(GLint loc, const Video* v)
+{
+    float di[3];
+    video_field_params(v, di);
+    glUniform3f(loc, di[0], di[1], di[2]);
+}
+
+/* Source texels per unit of mesh (u, v): what the warp scales down. */
+static void item_texels(const DrawItem* it, float t[2])
+{
+    const Video* v = it->v;
+    float w = (float)(v->width >> v->upload_shift);
+    if (v->alpha == VIDEO_ALPHA_PACKED) w *= 0.5f;
+    t[0] = w / it->rect[2];
+    t[1] = (float)(v->height >> v->upload_shift) / it->rect[3];
+}
+
+static void bind_pyramid(const CompProgram* p, int slot, int unit, const DrawItem* it)
+{
+    const VideoPyramid* pyr = &it->v->pyr;
+    float t[2];
+    item_texels(it, t);
+
+    glActiveTexture(GL_TEXTURE0 + (GLenum)unit);
+    glBindTexture(GL_TEXTURE_2D, pyr->levels ? pyr->atlas : it->v->texY);
+    glUniform1i(p->uPyr[slot], unit);
+    glUniform4f(p->uPyrSize[slot], (float)pyr->w1, (float)pyr->h1,
+                pyr->w1 ? 1.0f / (float)(pyr->w1 + pyr->w1 / 2) : 0.0f,
+                pyr->h1 ? 1.0f / (float)pyr->h1 : 0.0f);
+    glUniform3f(p->uPyrScale[slot], t[0], t[1], (float)pyr->levels);
+}
+
+static void bind_item(const Compositor* c, const CompProgram* p, int slot, const DrawItem* it)
+{
+    const Video* v = it->v;
+    int base = slot * c->units_per_layer;
+
+    // Without an alpha plane the A sampler still needs a valid texture; reuse Y.
+    GLuint tex[COMP_UNITS_PER_LAYER] = { v->texY, v->texU, v->texV, v->texA ? v->texA : v->texY };
+    const GLint* loc[COMP_UNITS_PER_LAYER] = { p->uTexY, p->uTexU, p->uTexV, p->uTexA };
+
+    for (int k = 0; k < COMP_UNITS_PER_LAYER; k++) {
+        glActiveTexture(GL_TEXTURE0 + (GLenum)(base + k));
+        glBindTexture(GL_TEXTURE_2D, tex[k]);
+        glUniform1i(loc[k][slot], base + k);
+    }
+    if (pyramid_enabled())
+        bind_pyramid(p, slot, base + COMP_UNITS_PER_LAYER, it);
+
+    glUniform1i(p->uAlphaMode[slot], (int)v->alpha);
+    glUniform1i(p->uRange[slot], v->video_range);
+    glUniform1i(p->uBT709[slot], v->bt709);
+    glUniform1i(p->uDepth[slot], (int)v->depth);
+    bind_size(p->uSize[slot], v);
+    bind_field(p->uDeint[slot], v);
+    glUniform1i(p->uMode[slot], (int)it->mode);
+    glUniform1f(p->uAlpha[slot], it->alpha);
+    glUniform4f(p->uRect[slot], it->rect[0], it->rect[1], it->rect[2], it->rect[3]);
+}
+
+static void bind_trans_item(const Compositor* c, const TransProgram* p, const DrawItem* it)
+{
+    const Video* vids[2] = { it->v, it->v2 };
+
+    for (int i = 0; i < 2; i++) {
+        const Video* v = vids[i];
+        GLuint tex[3] = { v->texY, v->texU, v->texV };
+        if (i == 0 && it->prev) {
+            tex[0] = v->prevY;
+            tex[1] = v->prevU;
+            tex[2] = v->prevV;
+        }
+        for (int k = 0; k < 3; k++) {
+            int unit = i * 3 + k;
+            glActiveTexture(GL_TEXTURE0 + (GLenum)unit);
+            glBindTexture(GL_TEXTURE_2D, tex[k]);
+            glUniform1i(p->uTex[i][k], unit);
+        }
+        glUniform1i(p->uAlphaMode[i], (int)v->alpha);
+        glUniform1i(p->uRange[i], v->video_range);
+        glUniform1i(p->uBT709[i], v->bt709);
+        glUniform1i(p->uDepth[i], (int)v->depth);
+        bind_size(p->uSize[i], v);
+        bind_field(p->uDeint[i], v);
+    }
+
+    if (p->uMask >= 0) {
+        glActiveTexture(GL_TEXTURE6);
+        glBindTexture(GL_TEXTURE_2D, c->mask_tex);
+        glUniform1i(p->uMask, 6);
+    }
+
+    glUniform1i(p->uMode, (int)it->mode);
+    glUniform1f(p->uAlpha, it->alpha);
+    glUniform4f(p->uRect, it->rect[0], it->rect[1], it->rect[2], it->rect[3]);
+    glUniform1f(p->uProgress, it->progress);
+    glUniform1f(p->uSoftness, TRANS_SOFTNESS);
+}
+
+static void use_program(const Compositor* c, GLuint prog, GLint aPos, GLint aTex)
+{
+    glUseProgram(prog);
+    glBindBuffer(GL_ARRAY_BUFFER, c->vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, c->ebo);
+
+    // Attrib pointers are global state in GLES2; locations differ per program.
+    glEnableVertexAttribArray((GLuint)aPos);
+    glVertexAttribPointer((GLuint)aPos, 2, GL_FLOAT, GL_FALSE,
+                          4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray((GLuint)aTex);
+    glVertexAttribPointer((GLuint)aTex, 2, GL_FLOAT, GL_FALSE,
+                          4 * sizeof(float), (void*)(2 * sizeof(float)));
+}
+
+static void set_output(GLint uOutput, int out)
+{
+    glUniform1i(uOutput, out);
+
+    switch (out) {
+    case OUT_OVER_BLACK:
+        glDisable(GL_BLEND);
+        break;
+    case OUT_SCALAR:
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+    case OUT_SCREEN:
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_COLOR);
+        break;
+    default:
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ZERO, GL_SRC_COLOR);
+        break;
+    }
+}
+
+/* Brings each layer-program item's pyramid up to what the warp needs; transition programs don't sample it. */
+static void update_pyramids(const Compositor* c, DrawItem* items, int n, const float H[9])
+{
+    for (int i = 0; i < n; i++) {
+        if (items[i].v2) continue;
+        float t[2];
+        item_texels(&items[i], t);
+        pyramid_update(items[i].v, pyramid_levels_needed(H, c->view_w, c->view_h, t[0], t[1]));
+    }
+    glViewport(0, 0, c->view_w, c->view_h);
+}
+
+int compositor_draw(Compositor* c, VideoEngine* ve, const AppState* st)
+{
+    DrawItem items[COMP_MAX_ITEMS];
+    int total = collect_items(c, ve, items);
+    int n = cull_occluded(ve, items, total);
+
+    // Before any draw state is set: building switches framebuffer, program and viewport.
+    if (pyramid_enabled())
+        update_pyramids(c, items, n, st->H);
+
+    int draws = 0;
+    GLuint bound = 0;
+
+    for (int i = 0; i < n; ) {
+        int take = 1;
+        int out;
+
+        if (i == 0 && !c->underlay) {
+            // Over the cleared framebuffer the shader can resolve any modes.
+            take = (n >= 2 && c->max_per_pass >= 2 && !items[0].v2 && !items[1].v2) ? 2 : 1;
+            out = OUT_OVER_BLACK;
+        } else if (c->max_per_pass >= 2 && i + 1 < n &&
+                   item_is_scalar(&items[i]) && item_is_scalar(&items[i + 1])) {
+            take = 2;
+            out = OUT_SCALAR;
+        } else {
+            switch (items[i].mode) {
+            case BLEND_SCREEN:   out = OUT_SCREEN; break;
+            case BLEND_MULTIPLY: out = OUT_MULTIPLY; break;
+            default:             out = OUT_SCALAR; break;
+            }
+        }
+
+        if (items[i].v2) {
+            const TransProgram* p = &c->trans[items[i].trans];
+            if (p->prog != bound) {
+                use_program(c, p->prog, p->aPos, p->aTex);
+                bound = p->prog;
+            }
+            set_output(p->uOutput, out);
+            bind_trans_item(c, p, &items[i]);
+        } else {
+            const CompProgram* p = &c->progs[take - 1];
+            if (p->prog != bound) {
+                use_program(c, p->prog, p->aPos, p->aTex);
+                bound = p->prog;
+                if (pyramid_enabled()) {
+                    glUniformMatrix3fv(p->uWarp, 1, GL_FALSE, st->H);
+                    glUniform2f(p->uHalfView, 0.5f * c->view_w, 0.5f * c->view_h);
+                }
+            }
+            set_output(p->uOutput, out);
+            for (int s = 0; s < take; s++)
+                bind_item(c, p, s, &items[i + s]);
+        }
+
+        glDrawElements(GL_TRIANGLES, (GLsizei)st->numIndices, GL_UNSIGNED_SHORT, 0);
+        draws++;
+        i += take;
+    }
+
+    if (total != c->last_items || draws != c->last_draws) {
+        log_info("[COMP] %d layer source(s), %d culled, %d draw(s)", total, total - n, draws);
+        c->last_items = total;
+        c->last_draws = draws;
+    }
+    return draws;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "common.h"
+#include "video_engine.h"
+#include "app_state.h"
+
+/*
+   Draws the VideoEngine layer stack onto the warp mesh with as few draws
+   as possible: layers hidden under an opaque full-surface layer are
+   skipped (and their decoders paused), and neighbouring layers are packed
+   two per pass into a multi-sampler program when texture units allow.
+   Layers mid-transition use the single-pass program of their style.
+*/
+
+#define COMP_MAX_PER_PASS 2
+#define COMP_UNITS_PER_LAYER 4   // Y, U, V, A (+ the pyramid atlas when MAPPER_PYRAMID=1)
+
+typedef struct {
+    GLuint prog;
+    GLint aPos, aTex;
+    GLint uOutput;
+    GLint uTexY[COMP_MAX_PER_PASS];
+    GLint uTexU[COMP_MAX_PER_PASS];
+    GLint uTexV[COMP_MAX_PER_PASS];
+    GLint uTexA[COMP_MAX_PER_PASS];
+    GLint uAlphaMode[COMP_MAX_PER_PASS];
+    GLint uRange[COMP_MAX_PER_PASS];
+    GLint uBT709[COMP_MAX_PER_PASS];
+    GLint uDepth[COMP_MAX_PER_PASS];
+    GLint uSize[COMP_MAX_PER_PASS];
+    GLint uDeint[COMP_MAX_PER_PASS];
+    GLint uPyr[COMP_MAX_PER_PASS];
+    GLint uPyrSize[COMP_MAX_PER_PASS];
+    GLint uPyrScale[COMP_MAX_PER_PASS];
+    GLint uMode[COMP_MAX_PER_PASS];
+    GLint uAlpha[COMP_MAX_PER_PASS];
+    GLint uRect[COMP_MAX_PER_PASS];
+    GLint uWarp, uHalfView;    // pyramid level selection
+} CompProgram;
+
+/* One layer mid-transition: outgoing (A) and incoming (B) in one pass. */
+typedef struct {
+    GLuint prog;
+    GLint aPos, aTex;
+    GLint uOutput, uMode, uAlpha, uRect;
+    GLint uProgress, uSoftness, uMask;
+    GLint uTex[2][3];          // [A/B][Y/U/V]
+    GLint uAlphaMode[2];
+    GLint uRange[2];
+    GLint uBT709[2];
+    GLint uDepth[2];
+    GLint uSize[2];
+    GLint uDeint[2];
+} TransProgram;
+
+typedef struct {
+    CompProgram progs[COMP_MAX_PER_PASS];   // [n-1] samples n layers
+    TransProgram trans[TRANS_COUNT];        // [TRANS_FADE]: blend cadence only
+    GLuint mask_tex;
+    int max_per_pass;
+    int units_per_layer;
+    int view_w, view_h;
+    GLuint vbo, ebo;
+    int underlay;           // something (the splash) is drawn under the stack: blend every pass
+
+    int last_items;
+    int last_draws;
+} Compositor;
+
+int  compositor_init(Compositor* c, GLuint vbo, GLuint ebo);
+
+/* Mask for luma-key transitions (BMP); NULL selects the built-in gradient. */
+void compositor_set_mask(Compositor* c, const char* bmp_path);
+
+/* Draws onto st's warp mesh; returns the number of draw calls submitted. */
+int  compositor_draw(Compositor* c, VideoEngine* ve, const AppState* st);
+
+void compositor_shutdown(Compositor* c);
@@ -0,0 +1,302 @@
+#include "control.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef struct {
+    int fd;
+    Uint32 id;          // reply target; 0 = free slot
+    char buf[2048];
+    size_t len;
+} Client;
+
+typedef struct {
+    GThread* thread;
+    int listen_fd;
+    int stop_fd;        // pipe: a byte here ends the thread
+    int stop_wr;
+    char path[108];
+    CmdChannel ch;
+    Client clients[CONTROL_MAX_CLIENTS];
+    Uint32 next_id;
+} Control;
+
+static Control ctl = { .listen_fd = -1, .stop_fd = -1, .stop_wr = -1 };
+
+/* ================= Minimal JSON field lookup ================= */
+
+/* Points at the value of "key" in a flat JSON object, or NULL. */
+static const char* json_value(const char* js, const char* key)
+{
+    size_t klen = strlen(key);
+    for (const char* p = strchr(js, '"'); p; p = strchr(p + 1, '"')) {
+        if (strncmp(p + 1, key, klen) != 0 || p[1 + klen] != '"') continue;
+        const char* v = p + 2 + klen;
+        while (*v == ' ' || *v == '\t') v++;
+        if (*v != ':') continue;
+        v++;
+        while (*v == ' ' || *v == '\t') v++;
+        return v;
+    }
+    return NULL;
+}
+
+static int json_string(const char* js, const char* key, char* out, size_t n)
+{
+    const char* v = json_value(js, key);
+    if (!v || *v != '"') return 0;
+    v++;
+
+    size_t i = 0;
+    while (*v && *v != '"' && i + 1 < n) {
+        if (*v == '\\' && v[1]) v++;
+        out[i++] = *v++;
+    }
+    out[i] = '\0';
+    return *v == '"';
+}
+
+static int json_number(const char* js, const char* key, double* out)
+{
+    const char* v = json_value(js, key);
+    if (!v) return 0;
+    char* end;
+    *out = strtod(v, &end);
+    return end != v;
+}
+
+/* ================= Requests ================= */
+
+static CmdType cmd_from_name(const char* s)
+{
+    static const struct { const char* name; CmdType type; } map[] = {
+        { "transition", CMD_TRANSITION }, { "random", CMD_RANDOM },
+        { "load", CMD_LOAD }, { "unload", CMD_UNLOAD },
+        { "set_corner", CMD_SET_CORNER }, { "get_corners", CMD_GET_CORNERS },
+        { "xfade", CMD_SET_XFADE }, { "opacity", CMD_SET_OPACITY },
+        { "stats", CMD_STATS }, { "frames", CMD_FRAMES },
+    };
+    for (size_t i = 0; i < sizeof(map) / sizeof(map[0]); i++)
+        if (strcmp(s, map[i].name) == 0) return map[i].type;
+    return CMD_NONE;
+}
+
+static void send_text(Client* cl, const char* text)
+{
+    // Replies are small; a client that can't take one line is dropped.
+    size_t len = strlen(text);
+    if (send(cl->fd, text, len, MSG_NOSIGNAL | MSG_DONTWAIT) != (ssize_t)len ||
+        send(cl->fd, "\n", 1, MSG_NOSIGNAL | MSG_DONTWAIT) != 1) {
+        close(cl->fd);
+        cl->fd = -1;
+        cl->id = 0;
+    }
+}
+
+static void handle_line(Client* cl, const char* line)
+{
+    Command c;
+    memset(&c, 0, sizeof(c));
+    c.recv_us = time_now_us();
+    c.client = cl->id;
+
+    double num;
+    if (json_number(line, "id", &num)) c.id = (Uint32)num;
+
+    char name[32];
+    if (!json_string(line, "cmd", name, sizeof(name)) || (c.type = cmd_from_name(name)) == CMD_NONE) {
+        char err[96];
+        snprintf(err, sizeof(err), "{\"id\":%u,\"ok\":false,\"error\":\"unknown command\"}", c.id);
+        send_text(cl, err);
+        return;
+    }
+
+    if (json_number(line, "layer", &num)) c.layer = (int)num;
+    json_string(line, "path", c.path, sizeof(c.path));
+    if (json_number(line, "x", &num)) c.f[0] = (float)num;
+    if (json_number(line, "y", &num)) c.f[1] = (float)num;
+    if (json_number(line, "seconds", &num)) c.f[0] = (float)num;
+    if (json_number(line, "value", &num)) c.f[0] = (float)num;
+
+    char corner[8];
+    c.index = json_string(line, "corner", corner, sizeof(corner)) ? cmd_corner_from_name(corner) : -1;
+
+    if (!cmd_submit(&ctl.ch, &c)) {
+        char err[96];
+        snprintf(err, sizeof(err), "{\"id\":%u,\"ok\":false,\"error\":\"busy\"}", c.id);
+        send_text(cl, err);
+    }
+}
+
+static void read_client(Client* cl)
+{
+    ssize_t n = recv(cl->fd, cl->buf + cl->len, sizeof(cl->buf) - 1 - cl->len, 0);
+    if (n <= 0) {
+        close(cl->fd);
+        cl->fd = -1;
+        cl->id = 0;
+        return;
+    }
+    cl->len += (size_t)n;
+    cl->buf[cl->len] = '\0';
+
+    char* start = cl->buf;
+    char* nl;
+    while (cl->fd >= 0 && (nl = strchr(start, '\n'))) {
+        *nl = '\0';
+        if (nl > start) handle_line(cl, start);
+        start = nl + 1;
+    }
+    if (cl->fd < 0) return;
+
+    cl->len = strlen(start);
+    memmove(cl->buf, start, cl->len + 1);
+    if (cl->len >= sizeof(cl->buf) - 1) cl->len = 0;  // over-long line: discard
+}
+
+static void flush_replies(void)
+{
+    uint64_t cnt;
+    if (read(ctl.ch.wake_fd, &cnt, sizeof(cnt)) < 0) { /* nothing pending */ }
+
+    CmdReply r;
+    while (spsc_pop(&ctl.ch.replies, &r)) {
+        for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+            if (ctl.clients[i].id == r.client) {
+                send_text(&ctl.clients[i], r.text);
+                break;
+            }
+        }
+    }
+}
+
+static void accept_client(void)
+{
+    int fd = accept(ctl.listen_fd, NULL, NULL);
+    if (fd < 0) return;
+
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+        Client* cl = &ctl.clients[i];
+        if (cl->id) continue;
+        if (++ctl.next_id == 0) ++ctl.next_id;
+        cl->fd = fd;
+        cl->id = ctl.next_id;
+        cl->len = 0;
+        return;
+    }
+    close(fd);
+}
+
+static gpointer control_thread(gpointer data)
+{
+    (void)data;
+    struct pollfd pfd[3 + CONTROL_MAX_CLIENTS];
+
+    for (;;) {
+        int n = 0;
+        pfd[n++] = (struct pollfd){ .fd = ctl.stop_fd, .events = POLLIN };
+        pfd[n++] = (struct pollfd){ .fd = ctl.listen_fd, .events = POLLIN };
+        pfd[n++] = (struct pollfd){ .fd = ctl.ch.wake_fd, .events = POLLIN };
+        int first_client = n;
+        int map[CONTROL_MAX_CLIENTS];
+        for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+            if (!ctl.clients[i].id) continue;
+            map[n - first_client] = i;
+            pfd[n++] = (struct pollfd){ .fd = ctl.clients[i].fd, .events = POLLIN };
+        }
+
+        if (poll(pfd, (nfds_t)n, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (pfd[0].revents) break;
+        if (pfd[2].revents & POLLIN) flush_replies();
+        for (int k = first_client; k < n; k++)
+            if (pfd[k].revents & (POLLIN | POLLHUP | POLLERR))
+                read_client(&ctl.clients[map[k - first_client]]);
+        if (pfd[1].revents & POLLIN) accept_client();
+    }
+
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++)
+        if (ctl.clients[i].id) close(ctl.clients[i].fd);
+    return NULL;
+}
+
+/* ================= Lifecycle ================= */
+
+int control_start(const char* spec)
+{
+    if (!spec || !spec[0] || strcmp(spec, "off") == 0 || strcmp(spec, "0") == 0)
+        return 1;
+
+    const char* path = (strcmp(spec, "on") == 0 || strcmp(spec, "1") == 0) ? CONTROL_DEFAULT_PATH : spec;
+    if (strlen(path) >= sizeof(ctl.path)) {
+        log_error("[CTL] socket path too long: %s", path);
+        return 0;
+    }
+    snprintf(ctl.path, sizeof(ctl.path), "%s", path);
+
+    if (!cmd_channel_init(&ctl.ch, "control", STAGE_CMD_TO_FRAME)) goto fail;
+
+    int pipefd[2];
+    if (pipe(pipefd) != 0) goto fail;
+    ctl.stop_fd = pipefd[0];
+    ctl.stop_wr = pipefd[1];
+
+    ctl.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (ctl.listen_fd < 0) goto fail;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", ctl.path);
+
+    // Only a stale socket from a previous run is removed, never some other file.
+    struct stat st;
+    if (lstat(ctl.path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            log_error("[CTL] %s exists and is not a socket", ctl.path);
+            control_stop();
+            return 0;
+        }
+        unlink(ctl.path);
+    }
+
+    // Listening starts after the chmod, so no other user can connect in between.
+    if (bind(ctl.listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        chmod(ctl.path, CONTROL_SOCKET_MODE) != 0 ||
+        listen(ctl.listen_fd, 4) != 0)
+        goto fail;
+
+    commands_register(&ctl.ch);
+    ctl.thread = g_thread_new("control", control_thread, NULL);
+
+    log_info("[CTL] listening on %s", ctl.path);
+    return 1;
+
+fail:
+    log_error("[CTL] cannot listen on %s: %s", ctl.path, strerror(errno));
+    control_stop();
+    return 0;
+}
+
+void control_stop(void)
+{
+    if (ctl.thread) {
+        if (write(ctl.stop_wr, "x", 1) < 0) { /* thread exits on close below */ }
+        g_thread_join(ctl.thread);
+        ctl.thread = NULL;
+        commands_unregister(&ctl.ch);
+        unlink(ctl.path);
+    }
+    if (ctl.listen_fd >= 0) close(ctl.listen_fd);
+    if (ctl.stop_fd >= 0) close(ctl.stop_fd);
+    if (ctl.stop_wr >= 0) close(ctl.stop_wr);
+    if (ctl.ch.name) cmd_channel_destroy(&ctl.ch);
+    ctl.ch.name = NULL;
+    ctl.listen_fd = ctl.stop_fd = ctl.stop_wr = -1;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "common.h"
+#include "commands.h"
+
+/*
+  Local control socket (Unix domain, JSON lines). A dedicated thread
+  accepts clients and parses one request per line into Commands; replies
+  come back from the render thread through the channel and are written
+  by the same thread. Example session:
+
+    {"cmd":"transition","path":"clip2.mp4","id":1}
+    {"cmd":"set_corner","corner":"TL","x":-0.95,"y":0.97}
+    {"cmd":"get_corners"}
+    {"cmd":"stats"}
+
+  Commands: transition, random, load, unload (layer, path), set_corner,
+  get_corners, xfade (seconds), opacity (layer, value), stats.
+
+  MAPPER_CONTROL=on | <socket path>   (on = /tmp/mapping_video_keystone.sock)
+
+  The socket is created mode 0660. An existing file at the path is only
+  replaced if it is a socket (left by a previous run).
+*/
+
+#define CONTROL_DEFAULT_PATH "/tmp/mapping_video_keystone.sock"
+#define CONTROL_MAX_CLIENTS  8
+#define CONTROL_SOCKET_MODE  0660   // owner and group may connect
+
+int  control_start(const char* spec);
+void control_stop(void);
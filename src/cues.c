@@ -0,0 +1,294 @@
+#include "cues.h"
+#include "netsync.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define CUE_MAGIC "MCUE1"
+#define ACK_MAGIC "MACK1"
+
+typedef struct {
+    int fd;
+    struct sockaddr_in group;
+    Uint32 node;
+    Uint32 seq;
+
+    // Last applied cue (dedupe + ack)
+    Uint32 last_node, last_seq;
+    int ack_layer;                 // -1 = nothing to ack
+    GstClockTime ack_at;
+
+    // Our own last cue until it loops back (applied locally if it doesn't)
+    char self_line[512];
+    Uint64 self_due_us;
+
+    // Originator: skew over the acks for our own last cue
+    Uint32 report_seq;
+    GstClockTime report_at;
+    Uint64 report_due_us;
+    gint64 late_min, late_max;
+    int acks;
+} Cues;
+
+static Cues cq = { .fd = -1, .ack_layer = -1 };
+
+static Uint32 make_node_id(void)
+{
+    Uint32 h = 2166136261u;
+    Uint64 t = time_now_us();
+    Uint32 pid = (Uint32)getpid();
+    for (int i = 0; i < 8; i++) { h ^= (Uint8)(t >> (i * 8)); h *= 16777619u; }
+    for (int i = 0; i < 4; i++) { h ^= (Uint8)(pid >> (i * 8)); h *= 16777619u; }
+    return h ? h : 1;
+}
+
+static int parse_spec(const char* spec, char* group, size_t gsz, int* port, char* ifaddr, size_t isz)
+{
+    snprintf(group, gsz, "%s", CUE_DEFAULT_GROUP);
+    *port = CUE_DEFAULT_PORT;
+    ifaddr[0] = '\0';
+
+    if (strcmp(spec, "on") == 0 || strcmp(spec, "1") == 0)
+        return 1;
+
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    char* at = strchr(buf, '@');
+    if (at) {
+        *at++ = '\0';
+        snprintf(ifaddr, isz, "%s", at);
+    }
+    char* colon = strchr(buf, ':');
+    if (colon) {
+        *colon++ = '\0';
+        *port = atoi(colon);
+    }
+    if (buf[0]) snprintf(group, gsz, "%s", buf);
+    return *port > 0;
+}
+
+int cues_init(const char* spec)
+{
+    if (!spec || !spec[0] || strcmp(spec, "off") == 0 || strcmp(spec, "0") == 0)
+        return 1;
+
+    char group[64], ifaddr[64];
+    int port;
+    if (!parse_spec(spec, group, sizeof(group), &port, ifaddr, sizeof(ifaddr))) {
+        log_error("[CUE] bad MAPPER_CUES \"%s\" (on | group:port[@ifaddr])", spec);
+        return 0;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) goto fail;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#ifdef SO_REUSEPORT
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+#endif
+
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_port = htons((uint16_t)port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (struct sockaddr*)&local, sizeof(local)) != 0) goto fail;
+
+    struct ip_mreq mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    if (inet_pton(AF_INET, group, &mreq.imr_multiaddr) != 1) goto fail;
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (ifaddr[0] && inet_pton(AF_INET, ifaddr, &mreq.imr_interface) != 1) goto fail;
+    if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) goto fail;
+    if (ifaddr[0])
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &mreq.imr_interface, sizeof(mreq.imr_interface));
+
+    unsigned char loop = 1, ttl = 1;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    cq.fd = fd;
+    cq.group.sin_family = AF_INET;
+    cq.group.sin_port = htons((uint16_t)port);
+    cq.group.sin_addr = mreq.imr_multiaddr;
+    cq.node = make_node_id();
+
+    log_info("[CUE] node %08x on %s:%d%s%s", cq.node, group, port,
+             ifaddr[0] ? " via " : "", ifaddr);
+    if (netsync_role() == SYNC_OFF)
+        log_info("[CUE] MAPPER_SYNC is off: cues apply on arrival, not on a shared time");
+    return 1;
+
+fail:
+    log_error("[CUE] cannot join %s:%d: %s", group, port, strerror(errno));
+    if (fd >= 0) close(fd);
+    return 0;
+}
+
+int cues_enabled(void)
+{
+    return cq.fd >= 0;
+}
+
+void cues_shutdown(void)
+{
+    if (cq.fd >= 0) close(cq.fd);
+    cq.fd = -1;
+}
+
+static int send_line(const char* line)
+{
+    if (sendto(cq.fd, line, strlen(line), 0, (struct sockaddr*)&cq.group, sizeof(cq.group)) < 0) {
+        log_error("[CUE] send failed: %s", strerror(errno));
+        return 0;
+    }
+    return 1;
+}
+
+int cues_send_transition(int layer, const char* path)
+{
+    if (cq.fd < 0 || !path) return 0;
+
+    const char* name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+
+    GstClockTime now = netsync_now();
+    GstClockTime at = GST_CLOCK_TIME_IS_VALID(now) ? now + (GstClockTime)CUE_LEAD_MS * GST_MSECOND : 0;
+
+    char line[512];
+    cq.seq++;
+    snprintf(line, sizeof(line), CUE_MAGIC " %08x %u %" G_GUINT64_FORMAT " %d %s",
+             cq.node, cq.seq, (guint64)at, layer, name);
+    if (!send_line(line)) return 0;
+
+    snprintf(cq.self_line, sizeof(cq.self_line), "%s", line);
+    cq.self_due_us = time_now_us() + (Uint64)CUE_SELF_WAIT_MS * 1000ull;
+
+    cq.report_seq = cq.seq;
+    cq.report_at = at;
+    cq.report_due_us = time_now_us() + (Uint64)(CUE_LEAD_MS + CUE_REPORT_MS) * 1000ull;
+    cq.acks = 0;
+    return 1;
+}
+
+static void handle_cue(VideoEngine* ve, const Playlist* pl, const char* msg)
+{
+    Uint32 node, seq;
+    guint64 at;
+    int layer;
+    int off = 0;
+    if (sscanf(msg, CUE_MAGIC " %x %u %" G_GUINT64_FORMAT " %d %n", &node, &seq, &at, &layer, &off) != 4 ||
+        off == 0)
+        return;
+    if (node == cq.last_node && seq == cq.last_seq) return;
+    if (layer < 0 || layer >= VE_MAX_LAYERS) return;
+    cq.last_node = node;
+    cq.last_seq = seq;
+    if (node == cq.node && seq == cq.seq)
+        cq.self_line[0] = '\0';
+
+    // The name is the rest of the line: file names may contain spaces.
+    char name[256];
+    snprintf(name, sizeof(name), "%s", msg + off);
+    size_t len = strlen(name);
+    while (len > 0 && (name[len - 1] == '\n' || name[len - 1] == '\r'))
+        name[--len] = '\0';
+    if (len == 0) return;
+
+    const char* path = playlist_find_name(pl, name);
+    if (!path) {
+        log_warn("[CUE] %08x#%u: %s is not in the local playlist", node, seq, name);
+        return;
+    }
+
+    GstClockTime now = netsync_now();
+    if (at == 0 || !GST_CLOCK_TIME_IS_VALID(now)) {
+        ve_layer_request_transition(ve, layer, path);
+        cq.ack_layer = -1;
+        return;
+    }
+
+    if (now >= at) {
+        log_warn("[CUE] %08x#%u arrived %.1f ms after its start time",
+                 node, seq, (now - at) / 1e6);
+    }
+    ve_layer_schedule_transition(ve, layer, path, at);
+    cq.ack_layer = layer;
+    cq.ack_at = at;
+}
+
+static void handle_ack(const char* msg)
+{
+    Uint32 origin, seq, from;
+    gint64 late;
+    if (sscanf(msg, ACK_MAGIC " %x %u %x %" G_GINT64_FORMAT, &origin, &seq, &from, &late) != 4)
+        return;
+    if (origin != cq.node || seq != cq.report_seq || cq.report_due_us == 0)
+        return;
+
+    if (cq.acks == 0 || late < cq.late_min) cq.late_min = late;
+    if (cq.acks == 0 || late > cq.late_max) cq.late_max = late;
+    cq.acks++;
+}
+
+void cues_poll(VideoEngine* ve, const Playlist* pl)
+{
+    if (cq.fd < 0) return;
+
+    char buf[600];
+    for (;;) {
+        ssize_t n = recv(cq.fd, buf, sizeof(buf) - 1, 0);
+        if (n <= 0) break;
+        buf[n] = '\0';
+
+        if (strncmp(buf, CUE_MAGIC " ", 6) == 0) handle_cue(ve, pl, buf);
+        else if (strncmp(buf, ACK_MAGIC " ", 6) == 0) handle_ack(buf);
+    }
+
+    // Multicast loopback off or not routed: don't leave the sender behind.
+    if (cq.self_line[0] && time_now_us() >= cq.self_due_us) {
+        log_warn("[CUE] #%u did not loop back, applying it locally", cq.seq);
+        char line[512];
+        snprintf(line, sizeof(line), "%s", cq.self_line);
+        cq.self_line[0] = '\0';
+        handle_cue(ve, pl, line);
+    }
+
+    if (cq.report_due_us && time_now_us() >= cq.report_due_us) {
+        if (cq.acks > 0)
+            log_info("[CUE] #%u switch skew %.2f ms across %d node(s) (late %.2f .. %.2f ms)",
+                     cq.report_seq, (cq.late_max - cq.late_min) / 1e6, cq.acks,
+                     cq.late_min / 1e6, cq.late_max / 1e6);
+        else
+            log_info("[CUE] #%u no switch acks received", cq.report_seq);
+        cq.report_due_us = 0;
+    }
+}
+
+void cues_after_swap(VideoEngine* ve)
+{
+    if (cq.fd < 0 || cq.ack_layer < 0) return;
+
+    // Hard cuts may already be complete here, so match on the start time instead.
+    if (ve->layers[cq.ack_layer].started_at != cq.ack_at) return;
+
+    GstClockTime now = netsync_now();
+    if (!GST_CLOCK_TIME_IS_VALID(now)) return;
+
+    gint64 late = (gint64)(now - cq.ack_at);
+    cq.ack_layer = -1;
+
+    char line[128];
+    snprintf(line, sizeof(line), ACK_MAGIC " %08x %u %08x %" G_GINT64_FORMAT,
+             cq.last_node, cq.last_seq, cq.node, late);
+    send_line(line);
+
+    log_info("[CUE] %08x#%u on screen %.2f ms after its start time", cq.last_node, cq.last_seq, late / 1e6);
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "common.h"
+#include "playlist.h"
+#include "video_engine.h"
+
+/*
+  Cue channel: clip changes broadcast over UDP multicast so every node
+  switches together. A cue names a clip (by file name) and a start time
+  on the shared clock (netsync.h) CUE_LEAD_MS in the future; each node
+  prerolls the clip right away and starts the transition on its first
+  vsync past that time. The sender is looped back and handles its own
+  cue like everyone else, or applies it directly when it doesn't come
+  back; a cue that can't be sent at all becomes a local transition.
+
+  After switching, every node multicasts how late its switch landed;
+  the originating node logs the worst-case skew across the acks.
+
+  MAPPER_CUES=on | group:port[@ifaddr]   (default 239.255.42.99:5638)
+  On one machine use @127.0.0.1 so the group is joined on loopback.
+*/
+
+#define CUE_DEFAULT_GROUP "239.255.42.99"
+#define CUE_DEFAULT_PORT  5638
+#define CUE_LEAD_MS       500     // covers pipeline start + first decoded frame
+#define CUE_REPORT_MS     2000    // ack window after the switch time
+#define CUE_SELF_WAIT_MS  100     // own cue not looped back by then: apply it directly
+
+/* Returns 0 on a bad spec or socket failure (cues stay off). */
+int  cues_init(const char* spec);
+int  cues_enabled(void);
+void cues_shutdown(void);
+
+/* Broadcasts a transition of `layer` to `path` (sent as its file name).
+   Returns 0 when the cue could not be sent; the caller applies it locally. */
+int  cues_send_transition(int layer, const char* path);
+
+/* Render loop, before ve_update: applies cues that arrived. */
+void cues_poll(VideoEngine* ve, const Playlist* pl);
+
+/* Render loop, after the swap: acks switches that just went on screen. */
+void cues_after_swap(VideoEngine* ve);
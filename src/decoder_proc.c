@@ -0,0 +1,600 @@
+#define _GNU_SOURCE
+#include "decoder_proc.h"
+#include "gst_plugins.h"
+#include "rt_profile.h"
+#include "stats.h"
+#include "video.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+#define DPROC_CHILD_FD 3     // child end of the socket in the child
+#define DPROC_PULL_MS  20    // child: appsink wait between control checks
+#define DPROC_MAX_DIM  8192  // widest / tallest frame the parent accepts
+
+enum { MSG_FORMAT = 1, MSG_FRAME, MSG_RELEASE, MSG_PAUSE, MSG_RESUME };
+
+/* One datagram per message; FORMAT carries the ring memfd as SCM_RIGHTS. */
+typedef struct {
+    Uint32 type;
+    Uint32 gen;
+    Uint32 slot;
+    Uint32 copy_us;           // FRAME: child-side copy time
+    Uint32 flags;             // FRAME: DPROC_INTERLACED, DPROC_TFF
+    guint64 pts;              // FRAME: stream time, or GST_CLOCK_TIME_NONE
+    DprocFormat fmt;          // FORMAT
+    Uint32 offset[4];         // FORMAT: plane offsets within a slot
+    Sint32 stride[4];
+    guint64 slot_size;
+} DprocMsg;
+
+static int g_in_child;
+
+int dproc_enabled(void)
+{
+    if (g_in_child) return 0;
+    const char* e = getenv("MAPPER_ISOLATE");
+    return e && e[0] == '1';
+}
+
+/* ================= Socket ================= */
+
+static int send_msg(int sock, const DprocMsg* m, int fd)
+{
+    struct iovec iov = { .iov_base = (void*)m, .iov_len = sizeof(*m) };
+    union { char buf[CMSG_SPACE(sizeof(int))]; struct cmsghdr align; } ctl;
+    struct msghdr h = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+    if (fd >= 0) {
+        memset(&ctl, 0, sizeof(ctl));
+        h.msg_control = ctl.buf;
+        h.msg_controllen = sizeof(ctl.buf);
+        struct cmsghdr* c = CMSG_FIRSTHDR(&h);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(c), &fd, sizeof(int));
+    }
+    // The peer may be gone: report it instead of taking SIGPIPE.
+    return sendmsg(sock, &h, MSG_NOSIGNAL) == (ssize_t)sizeof(*m);
+}
+
+/* Returns recvmsg's result; *fd receives a passed descriptor (else -1). */
+static ssize_t recv_msg(int sock, DprocMsg* m, int* fd, int flags)
+{
+    struct iovec iov = { .iov_base = m, .iov_len = sizeof(*m) };
+    union { char buf[CMSG_SPACE(sizeof(int))]; struct cmsghdr align; } ctl;
+    struct msghdr h = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = ctl.buf, .msg_controllen = sizeof(ctl.buf),
+    };
+
+    *fd = -1;
+    ssize_t n = recvmsg(sock, &h, flags | MSG_CMSG_CLOEXEC);
+    if (n <= 0) return n;
+
+    for (struct cmsghdr* c = CMSG_FIRSTHDR(&h); c; c = CMSG_NXTHDR(&h, c))
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS)
+            memcpy(fd, CMSG_DATA(c), sizeof(int));
+
+    if (n != (ssize_t)sizeof(*m)) {
+        if (*fd >= 0) close(*fd);
+        *fd = -1;
+        errno = EAGAIN;  // short datagram: ignore it
+        return -1;
+    }
+    return n;
+}
+
+/* ================= Layout ================= */
+
+/* Bytes per row and rows of plane i in a slot; 0 when the format has no such plane. */
+static int plane_size(const DprocFormat* f, int i, int* rows)
+{
+    int bpp = f->depth ? 2 : 1;
+    *rows = (i == 1 || i == 2) ? f->height / 2 : f->height;
+    switch (i) {
+    case 0:  return f->width * bpp;
+    case 1:  return (f->depth == VIDEO_DEPTH_P010) ? f->width * 2 : f->width / 2 * bpp;
+    case 2:  return (f->depth == VIDEO_DEPTH_P010) ? 0 : f->width / 2 * bpp;
+    default: return f->has_alpha ? f->width : 0;
+    }
+}
+
+/*
+   The parent only trusts a ring it has checked: a format it can upload,
+   every plane inside its slot and the memfd as large as all slots.
+   Returns why not, or NULL.
+*/
+static const char* check_layout(const DprocMsg* m, int fd)
+{
+    const DprocFormat* f = &m->fmt;
+    if (fd < 0) return "no ring fd";
+    if (f->width <= 0 || f->height <= 0 || f->width > DPROC_MAX_DIM || f->height > DPROC_MAX_DIM)
+        return "bad frame size";
+    if (f->depth < VIDEO_DEPTH_8 || f->depth > VIDEO_DEPTH_P010) return "bad depth";
+    if (f->has_alpha != 0 && (f->has_alpha != 1 || f->depth != VIDEO_DEPTH_8)) return "bad alpha plane";
+    if (m->slot_size == 0 || m->slot_size > SIZE_MAX / DPROC_SLOTS) return "bad slot size";
+
+    for (int i = 0; i < 4; i++) {
+        int rows;
+        int row = plane_size(f, i, &rows);
+        if (row == 0) continue;
+        if (m->stride[i] < row) return "plane stride too small";
+        if ((guint64)m->offset[i] + (guint64)m->stride[i] * (guint64)rows > m->slot_size)
+            return "plane outside its slot";
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0 || (guint64)st.st_size < m->slot_size * DPROC_SLOTS)
+        return "ring fd smaller than its slots";
+    return NULL;
+}
+
+/* ================= Parent ================= */
+
+int dproc_start(DecoderProc* d, const char* path, GstClockTime start)
+{
+    memset(d, 0, sizeof(*d));
+    d->sock = -1;
+
+    char exe[1024];
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (n <= 0) {
+        log_error("[DPROC] /proc/self/exe: %s", strerror(errno));
+        return 0;
+    }
+    exe[n] = '\0';
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) {
+        log_error("[DPROC] socketpair: %s", strerror(errno));
+        return 0;
+    }
+    // dup2 onto itself would keep close-on-exec set.
+    if (sv[1] == DPROC_CHILD_FD) {
+        int moved = fcntl(sv[1], F_DUPFD_CLOEXEC, DPROC_CHILD_FD + 1);
+        close(sv[1]);
+        sv[1] = moved;
+    }
+
+    char start_s[32];
+    snprintf(start_s, sizeof(start_s), "%llu",
+             (unsigned long long)(GST_CLOCK_TIME_IS_VALID(start) ? start : 0));
+    char* argv[] = { exe, "--decoder", (char*)path, start_s, NULL };
+
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, sv[1], DPROC_CHILD_FD);
+
+    // Spawned from the render thread, which may be SCHED_FIFO: decoders run as normal tasks.
+    posix_spawnattr_t sa;
+    struct sched_param sp = { .sched_priority = 0 };
+    posix_spawnattr_init(&sa);
+    posix_spawnattr_setschedpolicy(&sa, SCHED_OTHER);
+    posix_spawnattr_setschedparam(&sa, &sp);
+    posix_spawnattr_setflags(&sa, POSIX_SPAWN_SETSCHEDULER | POSIX_SPAWN_SETSCHEDPARAM);
+
+    int err = (sv[1] >= 0) ? posix_spawn(&d->pid, exe, &fa, &sa, argv, environ) : errno;
+    posix_spawnattr_destroy(&sa);
+    posix_spawn_file_actions_destroy(&fa);
+    if (sv[1] >= 0) close(sv[1]);
+
+    if (err != 0) {
+        log_error("[DPROC] spawn failed: %s", strerror(err));
+        close(sv[0]);
+        d->pid = 0;
+        return 0;
+    }
+
+    d->sock = sv[0];
+    log_info("[DPROC] decoder %d started at %.3f s: %s", (int)d->pid,
+             GST_CLOCK_TIME_IS_VALID(start) ? start / 1e9 : 0.0, path);
+    return 1;
+}
+
+void dproc_stop(DecoderProc* d)
+{
+    if (!d) return;
+
+    if (d->sock >= 0) close(d->sock);
+    d->sock = -1;
+
+    // Nothing to flush in a decoder: don't wait for it to notice the socket.
+    if (d->pid > 0) {
+        kill(d->pid, SIGKILL);
+        waitpid(d->pid, NULL, 0);
+    }
+    d->pid = 0;
+
+    if (d->map) munmap(d->map, d->map_size);
+    d->map = NULL;
+    d->map_size = 0;
+    d->held = 0;
+
+    for (int i = 0; i < DPROC_SLOTS; i++)
+        if (d->retired[i].map) munmap(d->retired[i].map, d->retired[i].size);
+    memset(d->retired, 0, sizeof(d->retired));
+}
+
+void dproc_set_paused(DecoderProc* d, int paused)
+{
+    if (!d || d->sock < 0) return;
+    DprocMsg m = { .type = paused ? MSG_PAUSE : MSG_RESUME };
+    send_msg(d->sock, &m, -1);
+}
+
+/* Socket closed by the child: reap it and say why it went. */
+static void reap(DecoderProc* d)
+{
+    int status = 0;
+    if (d->pid > 0 && waitpid(d->pid, &status, 0) == d->pid) {
+        if (WIFSIGNALED(status))
+            log_error("[DPROC] decoder %d killed by signal %d", (int)d->pid, WTERMSIG(status));
+        else
+            log_warn("[DPROC] decoder %d exited with status %d", (int)d->pid, WEXITSTATUS(status));
+    }
+    d->pid = 0;
+}
+
+/* Keeps a replaced ring mapped while frames from it are held; 0 when there's no room. */
+static int retire(DecoderProc* d)
+{
+    if (!d->map) return 1;
+    if (d->held == 0) {
+        munmap(d->map, d->map_size);
+        return 1;
+    }
+    for (int i = 0; i < DPROC_SLOTS; i++) {
+        DprocRetired* r = &d->retired[i];
+        if (r->map) continue;
+        r->map = d->map;
+        r->size = d->map_size;
+        r->gen = d->gen;
+        r->held = d->held;
+        return 1;
+    }
+    return 0;
+}
+
+/* Maps the ring a FORMAT message announces; 0 drops it and the child must be restarted. */
+static int remap(DecoderProc* d, const DprocMsg* m, int fd)
+{
+    int kept = retire(d);
+    d->map = NULL;
+    d->map_size = 0;
+    d->held = 0;
+
+    const char* bad = check_layout(m, fd);
+    if (bad || !kept) {
+        log_error("[DPROC] decoder %d: %s, restarting it", (int)d->pid, bad ? bad : "too many rings held");
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+
+    size_t size = (size_t)m->slot_size * DPROC_SLOTS;
+    void* p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        log_error("[DPROC] ring map failed: %s", strerror(errno));
+        return 0;
+    }
+
+    d->map = (guint8*)p;
+    d->map_size = size;
+    d->gen = m->gen;
+    d->slot_size = (size_t)m->slot_size;
+    d->fmt = m->fmt;
+    for (int i = 0; i < 4; i++) {
+        int rows;
+        // Planes the format doesn't have stay absent whatever the child sent.
+        int present = plane_size(&d->fmt, i, &rows) > 0;
+        d->offset[i] = present ? m->offset[i] : 0;
+        d->stride[i] = present ? m->stride[i] : 0;
+    }
+    static const char* depth[] = { "", " 10-bit", " P010" };
+    log_info("[DPROC] ring %u: %dx%d %s%s, %d x %zu bytes", m->gen, d->fmt.width, d->fmt.height,
+             d->fmt.has_alpha ? "A420" : "I420", depth[d->fmt.depth], DPROC_SLOTS, d->slot_size);
+    return 1;
+}
+
+int dproc_next_frame(DecoderProc* d, DprocFrame* f)
+{
+    if (!d || d->sock < 0) return -1;
+
+    Uint64 t0 = time_now_us();
+    for (;;) {
+        DprocMsg m;
+        int fd;
+        ssize_t n = recv_msg(d->sock, &m, &fd, MSG_DONTWAIT);
+        if (n == 0) {
+            reap(d);
+            return -1;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+            reap(d);
+            return -1;
+        }
+
+        if (m.type == MSG_FORMAT) {
+            if (!remap(d, &m, fd)) return -1;
+            continue;
+        }
+        if (fd >= 0) close(fd);
+
+        // Frames from a ring that was replaced (or never mapped) are stale.
+        if (m.type != MSG_FRAME || m.gen != d->gen || !d->map || m.slot >= DPROC_SLOTS)
+            continue;
+
+        const guint8* base = d->map + (size_t)m.slot * d->slot_size;
+        memset(f, 0, sizeof(*f));
+        for (int i = 0; i < 4; i++) {
+            if (!d->stride[i]) continue;
+            f->plane[i] = base + d->offset[i];
+            f->stride[i] = d->stride[i];
+        }
+        f->pts = m.pts;
+        f->flags = m.flags;
+        f->slot = m.slot;
+        f->gen = m.gen;
+        d->held++;
+
+        // Transport overhead per frame: the child's copy in, our receive here.
+        stats_stage_add(STAGE_DPROC_COPY, time_now_us() - m.copy_us, d->slot_size);
+        stats_stage_add(STAGE_DPROC_RECV, t0, 0);
+        return 1;
+    }
+}
+
+void dproc_release(DecoderProc* d, const DprocFrame* f)
+{
+    if (!d) return;
+
+    if (f->gen == d->gen) {
+        if (d->held > 0) d->held--;
+    } else {
+        for (int i = 0; i < DPROC_SLOTS; i++) {
+            DprocRetired* r = &d->retired[i];
+            if (!r->map || r->gen != f->gen) continue;
+            if (--r->held <= 0) {
+                munmap(r->map, r->size);
+                memset(r, 0, sizeof(*r));
+            }
+            break;
+        }
+    }
+
+    // The child ignores releases for a ring it has already replaced.
+    if (d->sock < 0) return;
+    DprocMsg m = { .type = MSG_RELEASE, .gen = f->gen, .slot = f->slot };
+    send_msg(d->sock, &m, -1);
+}
+
+/* ================= Child ================= */
+
+typedef struct {
+    int sock;
+    Video* v;
+    guint8* map;
+    size_t map_size;
+    Uint32 gen;
+    int busy[DPROC_SLOTS];
+    DprocMsg fmt;             // layout of the current ring
+} Child;
+
+/* Handles parent messages, waiting up to wait_ms for the first; -1 when the parent is gone. */
+static int child_poll(Child* c, int wait_ms)
+{
+    struct pollfd pfd = { .fd = c->sock, .events = POLLIN };
+    if (wait_ms > 0 && poll(&pfd, 1, wait_ms) < 0 && errno != EINTR)
+        return -1;
+
+    for (;;) {
+        DprocMsg m;
+        int fd;
+        ssize_t n = recv_msg(c->sock, &m, &fd, MSG_DONTWAIT);
+        if (n == 0) return -1;
+        if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+        if (fd >= 0) close(fd);
+
+        switch (m.type) {
+        case MSG_RELEASE:
+            if (m.gen == c->gen && m.slot < DPROC_SLOTS)
+                c->busy[m.slot] = 0;
+            break;
+        case MSG_PAUSE:
+        case MSG_RESUME:
+            video_set_paused(c->v, m.type == MSG_PAUSE);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/* (Re)creates the ring for this frame layout and hands it to the parent. */
+static int child_ring(Child* c, const DprocFormat* f)
+{
+    DprocMsg m = { .type = MSG_FORMAT, .gen = c->gen + 1, .fmt = *f };
+    size_t off = 0;
+    for (int i = 0; i < 4; i++) {
+        int rows;
+        m.offset[i] = (Uint32)off;
+        m.stride[i] = plane_size(f, i, &rows);
+        off += (size_t)m.stride[i] * (size_t)rows;
+    }
+    m.slot_size = (off + 63) & ~(guint64)63;
+
+    size_t size = (size_t)m.slot_size * DPROC_SLOTS;
+    int fd = memfd_create("mapper-frames", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, (off_t)size) < 0) {
+        log_error("[DPROC] memfd: %s", strerror(errno));
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        log_error("[DPROC] ring map failed: %s", strerror(errno));
+        close(fd);
+        return 0;
+    }
+
+    int sent = send_msg(c->sock, &m, fd);
+    close(fd);
+    if (!sent) {
+        munmap(p, size);
+        return 0;
+    }
+
+    if (c->map) munmap(c->map, c->map_size);
+    c->map = (guint8*)p;
+    c->map_size = size;
+    c->gen = m.gen;
+    c->fmt = m;
+    memset(c->busy, 0, sizeof(c->busy));
+    return 1;
+}
+
+static void copy_plane(guint8* dst, int dst_stride, const guint8* src, int src_stride, int w, int h)
+{
+    if (src_stride == dst_stride) {
+        memcpy(dst, src, (size_t)dst_stride * (size_t)h);
+        return;
+    }
+    for (int y = 0; y < h; y++)
+        memcpy(dst + (size_t)y * dst_stride, src + (size_t)y * src_stride, (size_t)w);
+}
+
+/* Copies one sample into a free slot and announces it; -1 when the parent is gone. */
+static int child_send(Child* c, GstSample* s)
+{
+    static int warned;
+
+    GstCaps* caps = gst_sample_get_caps(s);
+    GstBuffer* b = gst_sample_get_buffer(s);
+    GstVideoInfo info;
+    if (!caps || !b || !gst_video_info_from_caps(&info, caps)) return 0;
+
+    GstVideoFormat vf = GST_VIDEO_INFO_FORMAT(&info);
+    if (!video_format_supported(vf)) {
+        if (!warned++) log_warn("[DPROC] unexpected sink format: %s", gst_video_format_to_string(vf));
+        return 0;
+    }
+
+    DprocFormat f = {
+        .width = GST_VIDEO_INFO_WIDTH(&info),
+        .height = GST_VIDEO_INFO_HEIGHT(&info),
+        .has_alpha = (vf == GST_VIDEO_FORMAT_A420),
+        .depth = (int)video_depth_of(vf),
+        .video_range = (info.colorimetry.range == GST_VIDEO_COLOR_RANGE_16_235),
+        .bt709 = (info.colorimetry.matrix == GST_VIDEO_COLOR_MATRIX_BT709),
+    };
+    if (GST_VIDEO_INFO_FPS_N(&info) > 0)
+        f.frame_ns = gst_util_uint64_scale(GST_SECOND, GST_VIDEO_INFO_FPS_D(&info),
+                                           GST_VIDEO_INFO_FPS_N(&info));
+
+    if (!c->map || memcmp(&f, &c->fmt.fmt, sizeof(f)) != 0) {
+        if (!child_ring(c, &f)) return -1;
+    }
+
+    int slot = -1;
+    while (slot < 0) {
+        for (int i = 0; i < DPROC_SLOTS && slot < 0; i++)
+            if (!c->busy[i]) slot = i;
+        if (slot < 0 && child_poll(c, 100) < 0) return -1;
+    }
+
+    GstVideoFrame frame;
+    if (!gst_video_frame_map(&frame, &info, b, GST_MAP_READ)) return 0;
+
+    Uint64 t0 = time_now_us();
+    guint8* base = c->map + (size_t)slot * (size_t)c->fmt.slot_size;
+    for (guint i = 0; i < GST_VIDEO_FRAME_N_PLANES(&frame) && i < 4; i++) {
+        int rows;
+        int row = plane_size(&f, (int)i, &rows);
+        if (row > 0)
+            copy_plane(base + c->fmt.offset[i], c->fmt.stride[i],
+                       GST_VIDEO_FRAME_PLANE_DATA(&frame, i), GST_VIDEO_FRAME_PLANE_STRIDE(&frame, i), row, rows);
+    }
+    gst_video_frame_unmap(&frame);
+
+    const GstSegment* seg = gst_sample_get_segment(s);
+    GstClockTime pts = GST_BUFFER_PTS(b);
+    if (seg && GST_CLOCK_TIME_IS_VALID(pts))
+        pts = gst_segment_to_stream_time(seg, GST_FORMAT_TIME, pts);
+
+    DprocMsg m = {
+        .type = MSG_FRAME, .gen = c->gen, .slot = (Uint32)slot,
+        .copy_us = (Uint32)(time_now_us() - t0), .pts = pts,
+    };
+    GstVideoInterlaceMode im = GST_VIDEO_INFO_INTERLACE_MODE(&info);
+    if (im == GST_VIDEO_INTERLACE_MODE_INTERLEAVED ||
+        (im == GST_VIDEO_INTERLACE_MODE_MIXED && GST_BUFFER_FLAG_IS_SET(b, GST_VIDEO_BUFFER_FLAG_INTERLACED)))
+        m.flags |= DPROC_INTERLACED;
+    if (GST_BUFFER_FLAG_IS_SET(b, GST_VIDEO_BUFFER_FLAG_TFF) ||
+        GST_VIDEO_INFO_FIELD_ORDER(&info) == GST_VIDEO_FIELD_ORDER_TOP_FIELD_FIRST)
+        m.flags |= DPROC_TFF;
+    c->busy[slot] = 1;
+    return send_msg(c->sock, &m, -1) ? 1 : -1;
+}
+
+int dproc_child_main(int argc, char** argv)
+{
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s --decoder /path/to/video.mp4 start_ns\n", argv[0]);
+        return 2;
+    }
+    g_in_child = 1;
+    rt_enter_decoder_process();
+
+    const char* path = argv[2];
+    GstClockTime start = strtoull(argv[3], NULL, 10);
+
+    gst_plugins_prepare();
+    gst_init(NULL, NULL);
+
+    Video v;
+    if (!video_start(&v, path)) return 3;
+
+    if (start > 0) {
+        gst_element_get_state(v.pipeline, NULL, NULL, 5 * GST_SECOND);
+        gst_element_seek_simple(v.pipeline, GST_FORMAT_TIME,
+            (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT), (gint64)start);
+    }
+
+    Child c = { .sock = DPROC_CHILD_FD, .v = &v };
+    int rc = 0;
+    for (;;) {
+        if (child_poll(&c, 0) < 0) break;   // parent closed its end
+
+        // Any error the bus can't recover from ends the child; the parent respawns it.
+        int errors = v.errors;
+        video_poll_bus(&v);
+        if (!v.pipeline || v.errors > errors) {
+            rc = 3;
+            break;
+        }
+
+        GstSample* s = gst_app_sink_try_pull_sample((GstAppSink*)v.appsink,
+                                                    DPROC_PULL_MS * GST_MSECOND);
+        if (!s) continue;
+        v.first_sample_seen = 1;
+
+        int r = child_send(&c, s);
+        gst_sample_unref(s);
+        if (r < 0) break;
+    }
+
+    video_stop(&v);
+    return rc;
+}
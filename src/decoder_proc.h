@@ -0,0 +1,84 @@
+#pragma once
+#include "common.h"
+
+/*
+  Decoder-process isolation (MAPPER_ISOLATE=1).
+
+  Each source decodes in a child process (this binary re-run with
+  --decoder), so a corrupt file or a crashing plugin only takes down that
+  child. Frames come back through a memfd ring of DPROC_SLOTS tightly
+  packed I420/A420 (or 10-bit) slots mapped by both sides; the Unix socket carries only
+  the ring fd and small slot-ready / slot-released messages.
+
+  The child copies each decoded frame into a free slot once (decoder
+  buffers can't be shared across processes without DMABUF export); the
+  parent uploads straight from the mapping. Parent side is render-thread
+  only.
+*/
+
+#define DPROC_SLOTS 4
+
+typedef struct {
+    int width;
+    int height;
+    int has_alpha;      // A420: 4th plane
+    int depth;          // VideoDepth: 10-bit planes keep their 16-bit samples
+    int video_range;
+    int bt709;
+    guint64 frame_ns;   // 0 when the caps carry no rate
+} DprocFormat;
+
+#define DPROC_INTERLACED 1u   // DprocFrame.flags
+#define DPROC_TFF        2u
+
+/* One ready slot; plane pointers stay valid until dproc_release, even across
+   a format change. Once f.gen != d->gen the frame no longer matches d->fmt. */
+typedef struct {
+    const guint8* plane[4];
+    int stride[4];
+    GstClockTime pts;
+    Uint32 flags;       // DPROC_INTERLACED, DPROC_TFF
+    Uint32 slot;
+    Uint32 gen;
+} DprocFrame;
+
+/* A ring replaced while frames from it were held; unmapped when the last is released. */
+typedef struct {
+    guint8* map;
+    size_t size;
+    Uint32 gen;
+    int held;
+} DprocRetired;
+
+typedef struct {
+    pid_t pid;
+    int sock;
+
+    guint8* map;        // current ring, read-only
+    size_t map_size;
+    Uint32 gen;         // bumped by the child on every format change
+    int held;           // frames from the current ring not yet released
+
+    DprocRetired retired[DPROC_SLOTS];   // at most one per held frame
+
+    Uint32 offset[4];   // plane offsets within a slot
+    int stride[4];
+    size_t slot_size;
+    DprocFormat fmt;
+} DecoderProc;
+
+/* 1 when sources should decode out of process (never inside a child). */
+int  dproc_enabled(void);
+
+/* Spawns a child decoding `path` from stream position `start` (ns). */
+int  dproc_start(DecoderProc* d, const char* path, GstClockTime start);
+void dproc_stop(DecoderProc* d);
+void dproc_set_paused(DecoderProc* d, int paused);
+
+/* Non-blocking: 1 = frame ready, 0 = nothing yet, -1 = the child is gone or sent a
+   ring layout that doesn't fit its memfd (restart it). */
+int  dproc_next_frame(DecoderProc* d, DprocFrame* f);
+void dproc_release(DecoderProc* d, const DprocFrame* f);
+
+/* main() hands over when argv[1] is "--decoder"; returns the exit code. */
+int  dproc_child_main(int argc, char** argv);
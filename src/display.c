@@ -0,0 +1,202 @@
+#include "display.h"
+#include "governor.h"
+
+typedef struct {
+    SDL_Window* window;
+    SDL_DisplayMode native;   // start-up mode
+    SDL_DisplayMode current;
+    int have_native;
+    int match;                // MAPPER_DISPLAY_MATCH
+
+    char matched[1024];       // clip the current mode was chosen for
+
+    // Cadence: new-frame durations against the clip's frame period.
+    char clip[1024];
+    guint64 uploaded;
+    Uint64 last_new_us;
+    Uint64 err_us;
+    Uint64 worst_us;
+    Uint32 frames;
+    int after;                // measuring the first frames after a switch
+} Display;
+
+static Display dp;
+
+static Uint64 absdiff(Uint64 a, Uint64 b)
+{
+    return a > b ? a - b : b - a;
+}
+
+void display_init(int* w, int* h)
+{
+    *w = 1920;
+    *h = 1080;
+
+    const char* e = getenv("MAPPER_DISPLAY_MATCH");
+    dp.match = e && e[0] == '1';
+
+    if (SDL_GetDesktopDisplayMode(0, &dp.native) != 0) {
+        log_warn("[DISPLAY] no desktop mode (%s), using %dx%d", SDL_GetError(), *w, *h);
+        return;
+    }
+    dp.have_native = 1;
+    dp.current = dp.native;
+    *w = dp.native.w;
+    *h = dp.native.h;
+
+    int n = SDL_GetNumDisplayModes(0);
+    for (int i = 0; i < n; i++) {
+        SDL_DisplayMode m;
+        if (SDL_GetDisplayMode(0, i, &m) == 0)
+            log_debug("[DISPLAY] mode %d: %dx%d@%d", i, m.w, m.h, m.refresh_rate);
+    }
+    log_info("[DISPLAY] native %dx%d@%d Hz, %d modes, refresh matching %s",
+             dp.native.w, dp.native.h, dp.native.refresh_rate, n, dp.match ? "on" : "off");
+}
+
+void display_attach(SDL_Window* window)
+{
+    dp.window = window;
+    SDL_DisplayMode m;
+    if (SDL_GetWindowDisplayMode(window, &m) == 0)
+        dp.current = m;
+    video_set_display_rate(dp.current.refresh_rate);
+}
+
+int display_refresh_hz(void)
+{
+    return dp.current.refresh_rate;
+}
+
+/* ================= Cadence ================= */
+
+static void cadence_log(const char* when)
+{
+    if (!dp.frames) return;
+    log_info("[DISPLAY] cadence %s at %d Hz: mean error %.2f ms, worst %.2f ms over %u frames",
+             when, dp.current.refresh_rate, dp.err_us / 1000.0 / dp.frames,
+             dp.worst_us / 1000.0, dp.frames);
+}
+
+static void cadence_reset(void)
+{
+    dp.err_us = 0;
+    dp.worst_us = 0;
+    dp.frames = 0;
+}
+
+static void cadence_note(const Video* v, Uint64 now)
+{
+    if (strcmp(v->path, dp.clip) != 0) {
+        // After a switch only the new clip counts (not the tail of the crossfade).
+        if (!dp.after)
+            cadence_log("for the last clip");
+        cadence_reset();
+        snprintf(dp.clip, sizeof(dp.clip), "%s", v->path);
+        dp.uploaded = v->frames.uploaded;
+        dp.last_new_us = 0;
+        return;
+    }
+    if (v->frames.uploaded == dp.uploaded) return;
+    dp.uploaded = v->frames.uploaded;
+
+    Uint64 prev = dp.last_new_us;
+    dp.last_new_us = now;
+    if (!prev || !v->frame_ns || v->paused) return;
+
+    // Stalls and loops aren't cadence.
+    Uint64 period_us = v->frame_ns / 1000;
+    Uint64 held_us = now - prev;
+    if (held_us > 4 * period_us) return;
+
+    Uint64 err = absdiff(held_us, period_us);
+    dp.err_us += err;
+    if (err > dp.worst_us) dp.worst_us = err;
+    dp.frames++;
+
+    if (dp.after && dp.frames >= DISPLAY_CADENCE_FRAMES) {
+        cadence_log("after switch");
+        cadence_reset();
+        dp.after = 0;
+    }
+}
+
+/* ================= Mode matching ================= */
+
+/* Native-size mode with a rate that's a whole multiple of fps, nearest the start-up rate. */
+static int pick_mode(double fps, SDL_DisplayMode* out)
+{
+    int found = 0;
+    int best = 0;
+
+    int n = SDL_GetNumDisplayModes(0);
+    for (int i = 0; i < n; i++) {
+        SDL_DisplayMode m;
+        if (SDL_GetDisplayMode(0, i, &m) != 0) continue;
+        if (m.w != dp.native.w || m.h != dp.native.h || m.refresh_rate <= 0) continue;
+
+        int k = (int)(m.refresh_rate / fps + 0.5);
+        if (k < 1) continue;
+        // SDL reports whole Hz: 59.94 shows up as 59 or 60.
+        double off = m.refresh_rate - k * fps;
+        if (off > 0.6 || off < -0.6) continue;
+
+        int dist = m.refresh_rate - dp.native.refresh_rate;
+        if (dist < 0) dist = -dist;
+        if (!found || dist < best) {
+            *out = m;
+            best = dist;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+static void switch_mode(const SDL_DisplayMode* m, const char* clip, double fps)
+{
+    if (m->refresh_rate == dp.current.refresh_rate && m->w == dp.current.w && m->h == dp.current.h)
+        return;
+
+    cadence_log("before switch");
+
+    Uint64 t0 = time_now_us();
+    // SDL applies it to the fullscreen window; KMS modesets on the next flip.
+    if (SDL_SetWindowDisplayMode(dp.window, m) != 0) {
+        log_warn("[DISPLAY] %dx%d@%d refused: %s", m->w, m->h, m->refresh_rate, SDL_GetError());
+        return;
+    }
+    int from = dp.current.refresh_rate;
+    dp.current = *m;
+    governor_set_refresh(m->refresh_rate);
+    video_set_display_rate(m->refresh_rate);
+
+    log_info("[DISPLAY] %d -> %d Hz for %.3f fps (%.1f ms): %s",
+             from, m->refresh_rate, fps, (time_now_us() - t0) / 1000.0, clip);
+
+    cadence_reset();
+    dp.after = 1;
+    dp.last_new_us = 0;
+}
+
+static void match_clip(const Video* v)
+{
+    if (!v->tex_inited || !v->frame_ns || strcmp(v->path, dp.matched) == 0) return;
+    snprintf(dp.matched, sizeof(dp.matched), "%s", v->path);
+
+    double fps = 1e9 / (double)v->frame_ns;
+    SDL_DisplayMode m;
+    if (!pick_mode(fps, &m))
+        m = dp.native;
+    switch_mode(&m, v->path, fps);
+}
+
+void display_frame_end(const Video* cur)
+{
+    if (!dp.window) return;
+
+    cadence_note(cur, time_now_us());
+
+    // The incoming clip decides once its transition is over: the modeset blank falls between clips.
+    if (dp.match && dp.have_native)
+        match_clip(cur);
+}
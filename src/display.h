@@ -0,0 +1,32 @@
+#pragma once
+#include "common.h"
+#include "video.h"
+
+/*
+  Output mode management.
+
+  The window is created at the display's native (preferred) resolution.
+  With MAPPER_DISPLAY_MATCH=1 the refresh rate follows the base layer:
+  once a new clip has the screen to itself (its transition has finished,
+  or it is the first clip) the display switches to the native-resolution
+  mode whose rate is an integer multiple of the clip's frame rate, closest
+  to the start-up rate (25p -> 50 Hz, 23.976p -> 48 Hz). Clips with no such
+  mode go back to the start-up mode. Never switches later in a clip.
+
+  Presentation cadence is measured either way: for every new frame on
+  screen, how far its time on screen was from the clip's frame period.
+  The mean error is logged before and after each switch.
+
+  Render thread only.
+*/
+
+#define DISPLAY_CADENCE_FRAMES 300   // new frames measured after a switch
+
+/* After SDL_Init, before the window: native size (falls back to 1920x1080). */
+void display_init(int* w, int* h);
+void display_attach(SDL_Window* window);
+
+/* Once per presented frame, after the swap, with the base layer's current clip. */
+void display_frame_end(const Video* cur);
+
+int  display_refresh_hz(void);
@@ -0,0 +1,235 @@
+#include "governor.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define HIST_BUCKET_US 250
+#define HIST_BUCKETS 400            // 0 .. 100 ms
+
+typedef struct {
+    int on;
+    VideoEngine* ve;
+    AppState* st;
+    Uint64 frame_us;                // display period
+
+    GovLevel level;
+    int hot_secs;
+    int calm_secs;
+
+    // What the steps replaced, restored on the way back up.
+    VeMode saved_mode;
+    TransitionKind saved_transition;
+    int cut_applied;
+
+    // Frame times over the current second
+    Uint16 hist[HIST_BUCKETS + 1];
+    Uint32 frames;
+    Uint64 last_frame_us;
+    Uint64 window_start_us;
+
+    // Kept open; re-read with pread once a second
+    int fd_temp;
+    int fd_freq_cap;
+    int fd_freq_max;
+    int fd_throttled;
+} Governor;
+
+static Governor gv = { .fd_temp = -1, .fd_freq_cap = -1, .fd_freq_max = -1, .fd_throttled = -1 };
+
+static const char* level_name(GovLevel l)
+{
+    switch (l) {
+    case GOV_FULL:        return "full quality";
+    case GOV_COARSE_MESH: return "coarse mesh";
+    case GOV_HALF_UPLOAD: return "half-resolution uploads";
+    case GOV_HARD_CUTS:   return "hard cuts";
+    case GOV_PLAIN_FADES: return "plain fades";
+    default:              return "?";
+    }
+}
+
+static int read_fd_long(int fd, long* out)
+{
+    char buf[32];
+    if (fd < 0) return 0;
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return 0;
+    buf[n] = '\0';
+    char* end;
+    *out = strtol(buf, &end, 0);
+    return end != buf;
+}
+
+/* ================= Steps ================= */
+
+static void apply_level(GovLevel l, int on)
+{
+    switch (l) {
+    case GOV_COARSE_MESH:
+        if (on) app_state_set_grid(gv.st, GRID_COARSE_X, GRID_COARSE_Y);
+        else    app_state_set_grid(gv.st, GRID_X, GRID_Y);
+        break;
+    case GOV_HALF_UPLOAD:
+        video_set_upload_shift(on ? 1 : 0);
+        break;
+    case GOV_HARD_CUTS:
+        // Gapless and hard-cut modes never overlap two decoders anyway.
+        if (on && gv.ve->mode == VE_MODE_CROSSFADE) {
+            gv.saved_mode = gv.ve->mode;
+            gv.cut_applied = 1;
+            ve_set_mode(gv.ve, VE_MODE_HARDCUT);
+        } else if (!on && gv.cut_applied) {
+            gv.cut_applied = 0;
+            ve_set_mode(gv.ve, gv.saved_mode);
+        }
+        break;
+    case GOV_PLAIN_FADES:
+        if (on) {
+            gv.saved_transition = gv.ve->transition;
+            ve_set_transition(gv.ve, TRANS_FADE, gv.ve->easing);
+        } else {
+            ve_set_transition(gv.ve, gv.saved_transition, gv.ve->easing);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void step(int down, const char* reason)
+{
+    GovLevel from = gv.level;
+    if (down) {
+        gv.level++;
+        apply_level(gv.level, 1);
+    } else {
+        apply_level(gv.level, 0);
+        gv.level--;
+    }
+    log_warn("[GOV] %s -> %s: %s", level_name(from), level_name(gv.level), reason);
+
+    gv.hot_secs = 0;
+    gv.calm_secs = 0;
+}
+
+/* ================= Sampling ================= */
+
+static Uint64 hist_p95(void)
+{
+    Uint32 want = gv.frames - gv.frames / 20;
+    Uint32 seen = 0;
+    for (int i = 0; i <= HIST_BUCKETS; i++) {
+        seen += gv.hist[i];
+        if (seen >= want) return (Uint64)(i + 1) * HIST_BUCKET_US;
+    }
+    return (Uint64)(HIST_BUCKETS + 1) * HIST_BUCKET_US;
+}
+
+static void evaluate(void)
+{
+    Uint64 p95 = hist_p95();
+
+    long milli = 0, cap = 0, max = 0, thr = 0;
+    int have_temp = read_fd_long(gv.fd_temp, &milli);
+    double temp = milli / 1000.0;
+    int freq_capped = read_fd_long(gv.fd_freq_cap, &cap) && read_fd_long(gv.fd_freq_max, &max) &&
+                      cap > 0 && cap < max;
+    // Pi firmware: bit 1 frequency capped, bit 2 throttled (now)
+    int fw_throttled = read_fd_long(gv.fd_throttled, &thr) && (thr & 0x6);
+
+    char reason[128];
+    int hot = 1;
+    if (p95 > gv.frame_us * GOV_SLOW_RATIO)
+        snprintf(reason, sizeof(reason), "frame p95 %.1f ms > %.1f ms",
+                 p95 / 1000.0, gv.frame_us * GOV_SLOW_RATIO / 1000.0);
+    else if (have_temp && temp >= GOV_TEMP_HOT_C)
+        snprintf(reason, sizeof(reason), "SoC at %.1f C", temp);
+    else if (freq_capped)
+        snprintf(reason, sizeof(reason), "CPU capped at %ld of %ld MHz", cap / 1000, max / 1000);
+    else if (fw_throttled)
+        snprintf(reason, sizeof(reason), "firmware throttling (0x%lx)", thr);
+    else
+        hot = 0;
+
+    int calm = !hot && p95 < gv.frame_us * GOV_FAST_RATIO &&
+               (!have_temp || temp < GOV_TEMP_COOL_C);
+
+    gv.hot_secs = hot ? gv.hot_secs + 1 : 0;
+    gv.calm_secs = calm ? gv.calm_secs + 1 : 0;
+
+    if (gv.hot_secs >= GOV_DOWN_SECS && gv.level < GOV_LEVEL_COUNT - 1) {
+        step(1, reason);
+    } else if (gv.calm_secs >= GOV_UP_SECS && gv.level > GOV_FULL) {
+        if (have_temp)
+            snprintf(reason, sizeof(reason), "calm for %d s (p95 %.1f ms, %.1f C)",
+                     GOV_UP_SECS, p95 / 1000.0, temp);
+        else
+            snprintf(reason, sizeof(reason), "calm for %d s (p95 %.1f ms)", GOV_UP_SECS, p95 / 1000.0);
+        step(0, reason);
+    }
+}
+
+void governor_frame_end(void)
+{
+    if (!gv.on) return;
+
+    Uint64 now = time_now_us();
+    if (gv.last_frame_us) {
+        Uint64 b = (now - gv.last_frame_us) / HIST_BUCKET_US;
+        gv.hist[b > HIST_BUCKETS ? HIST_BUCKETS : b]++;
+        gv.frames++;
+    }
+    gv.last_frame_us = now;
+
+    if (gv.window_start_us == 0) gv.window_start_us = now;
+    if (now - gv.window_start_us < 1000000ull) return;
+
+    if (gv.frames > 0) evaluate();
+    memset(gv.hist, 0, sizeof(gv.hist));
+    gv.frames = 0;
+    gv.window_start_us = now;
+}
+
+/* ================= Lifecycle ================= */
+
+void governor_set_refresh(int refresh_hz)
+{
+    if (refresh_hz > 0)
+        gv.frame_us = 1000000ull / (Uint64)refresh_hz;
+}
+
+int governor_init(VideoEngine* ve, AppState* st, int refresh_hz)
+{
+    if (!env_flag("MAPPER_GOVERNOR", 0)) return 0;
+
+    gv.on = 1;
+    gv.ve = ve;
+    gv.st = st;
+    gv.frame_us = 1000000ull / (Uint64)(refresh_hz > 0 ? refresh_hz : 60);
+    gv.level = GOV_FULL;
+
+    gv.fd_temp = open("/sys/class/thermal/thermal_zone0/temp", O_RDONLY | O_CLOEXEC);
+    gv.fd_freq_cap = open("/sys/devices/system/cpu/cpu0/cpufreq/scaling_max_freq", O_RDONLY | O_CLOEXEC);
+    gv.fd_freq_max = open("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq", O_RDONLY | O_CLOEXEC);
+    gv.fd_throttled = open("/sys/devices/platform/soc/soc:firmware/get_throttled", O_RDONLY | O_CLOEXEC);
+
+    log_info("[GOV] on: %.2f ms frame budget, thermal %s, cpufreq %s, firmware flags %s",
+             gv.frame_us / 1000.0, gv.fd_temp >= 0 ? "yes" : "no",
+             gv.fd_freq_cap >= 0 ? "yes" : "no", gv.fd_throttled >= 0 ? "yes" : "no");
+    return 1;
+}
+
+void governor_shutdown(void)
+{
+    if (gv.fd_temp >= 0) close(gv.fd_temp);
+    if (gv.fd_freq_cap >= 0) close(gv.fd_freq_cap);
+    if (gv.fd_freq_max >= 0) close(gv.fd_freq_max);
+    if (gv.fd_throttled >= 0) close(gv.fd_throttled);
+    gv.fd_temp = gv.fd_freq_cap = gv.fd_freq_max = gv.fd_throttled = -1;
+    gv.on = 0;
+}
+
+GovLevel governor_level(void)
+{
+    return gv.level;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "common.h"
+#include "app_state.h"
+#include "video_engine.h"
+
+/*
+  Adaptive quality governor. Once a second it looks at the frame-time
+  p95, the SoC temperature and CPU frequency capping. After GOV_DOWN_SECS
+  of sustained pressure it steps quality down one level. It steps back up
+  only after GOV_UP_SECS calm against stricter thresholds, so it doesn't
+  flap around the limit. Levels are cumulative:
+
+    0  full quality
+    1  coarse warp mesh
+    2  half-resolution texture uploads
+    3  hard cuts instead of crossfades (crossfade mode only)
+    4  plain fades instead of shaped transitions
+
+  MAPPER_GOVERNOR=1 to enable (render thread only).
+*/
+
+#define GOV_DOWN_SECS 5
+#define GOV_UP_SECS 60
+#define GOV_TEMP_HOT_C 80.0      // Pi firmware soft limit
+#define GOV_TEMP_COOL_C 72.0
+#define GOV_SLOW_RATIO 1.20      // p95 over this many frame periods is pressure ...
+#define GOV_FAST_RATIO 1.05      // ... and under this one is calm
+
+#define GRID_COARSE_X 5
+#define GRID_COARSE_Y 3
+
+typedef enum {
+    GOV_FULL = 0,
+    GOV_COARSE_MESH,
+    GOV_HALF_UPLOAD,
+    GOV_HARD_CUTS,
+    GOV_PLAIN_FADES,
+    GOV_LEVEL_COUNT
+} GovLevel;
+
+int  governor_init(VideoEngine* ve, AppState* st, int refresh_hz);
+void governor_shutdown(void);
+
+/* The display mode changed (display.h): frame budget follows the new refresh. */
+void governor_set_refresh(int refresh_hz);
+
+/* Once per presented frame, after the swap. */
+void governor_frame_end(void);
+
+GovLevel governor_level(void);
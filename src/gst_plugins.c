@@ -0,0 +1,161 @@
+#include "gst_plugins.h"
+
+#include <stdint.h>
+#include <unistd.h>
+
+// Everything the player can autoplug or build explicitly.
+static const char* PINNED_PLUGINS[] = {
+    "coreelements",      // filesrc, queue, capsfilter
+    "typefindfunctions",
+    "app",               // appsink
+    "playback",          // decodebin fallback
+    "isomp4",            // qtdemux (.mp4/.mov/.m4v)
+    "matroska",          // .mkv
+    "mpegtsdemux",       // .ts
+    "videoparsersbad",   // h264parse, h265parse, vp9parse ...
+    "video4linux2",      // v4l2 stateful HW decoders
+    "v4l2codecs",        // v4l2 stateless HW decoders
+    "libav",             // software fallback decoders
+    "vpx",
+    "codecalpha",        // vp8/vp9 alpha side streams -> A420
+    "videoconvertscale", // >= 1.22
+    "videoconvert",      // < 1.22
+    "videoscale",
+};
+
+static const char* SYSTEM_PLUGIN_DIRS[] = {
+    "/usr/lib/aarch64-linux-gnu/gstreamer-1.0",
+    "/usr/lib/arm-linux-gnueabihf/gstreamer-1.0",
+    "/usr/lib/x86_64-linux-gnu/gstreamer-1.0",
+    "/usr/lib/gstreamer-1.0",
+    "/usr/local/lib/gstreamer-1.0",
+};
+
+#define N_PINNED (sizeof(PINNED_PLUGINS) / sizeof(PINNED_PLUGINS[0]))
+#define N_SYSDIRS (sizeof(SYSTEM_PLUGIN_DIRS) / sizeof(SYSTEM_PLUGIN_DIRS[0]))
+
+static const char* find_system_plugin_dir(void)
+{
+    for (size_t i = 0; i < N_SYSDIRS; i++) {
+        char probe[512];
+        snprintf(probe, sizeof(probe), "%s/libgstcoreelements.so", SYSTEM_PLUGIN_DIRS[i]);
+        if (access(probe, R_OK) == 0)
+            return SYSTEM_PLUGIN_DIRS[i];
+    }
+    return NULL;
+}
+
+static uint64_t hash_u64(uint64_t h, uint64_t v)
+{
+    for (int i = 0; i < 8; i++) {
+        h ^= (v >> (i * 8)) & 0xff;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+/* Signature over every pinned plugin file present (name, size, mtime). */
+static uint64_t pinned_signature(const char* sysdir)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < N_PINNED; i++) {
+        char so[512];
+        snprintf(so, sizeof(so), "%s/libgst%s.so", sysdir, PINNED_PLUGINS[i]);
+
+        struct stat st;
+        if (stat(so, &st) != 0) continue;
+
+        h = hash_u64(h, (uint64_t)i);
+        h = hash_u64(h, (uint64_t)st.st_size);
+        h = hash_u64(h, (uint64_t)st.st_mtime);
+    }
+    return h;
+}
+
+static int relink_plugins(const char* sysdir, const char* plugdir)
+{
+    if (mkdir(plugdir, 0755) != 0 && errno != EEXIST)
+        return 0;
+
+    DIR* d = opendir(plugdir);
+    if (d) {
+        struct dirent* de;
+        while ((de = readdir(d)) != NULL) {
+            if (de->d_name[0] == '.') continue;
+            char old[1024];
+            snprintf(old, sizeof(old), "%s/%s", plugdir, de->d_name);
+            unlink(old);
+        }
+        closedir(d);
+    }
+
+    int linked = 0;
+    for (size_t i = 0; i < N_PINNED; i++) {
+        char so[512], link[1024];
+        snprintf(so, sizeof(so), "%s/libgst%s.so", sysdir, PINNED_PLUGINS[i]);
+        snprintf(link, sizeof(link), "%s/libgst%s.so", plugdir, PINNED_PLUGINS[i]);
+        if (access(so, R_OK) != 0) continue;
+        if (symlink(so, link) == 0) linked++;
+    }
+    return linked > 0;
+}
+
+int gst_plugins_prepare(void)
+{
+    if (!env_flag("MAPPER_GST_PINNED", GST_PINNED_DEFAULT))
+        return 0;
+
+    // Respect an explicit plugin environment (development, custom builds).
+    if (getenv("GST_PLUGIN_PATH") || getenv("GST_PLUGIN_PATH_1_0") ||
+        getenv("GST_PLUGIN_SYSTEM_PATH") || getenv("GST_PLUGIN_SYSTEM_PATH_1_0")) {
+        log_warn("[GST] plugin path set in environment, pinned set disabled");
+        return 0;
+    }
+
+    const char* cache = app_cache_dir();
+    const char* sysdir = find_system_plugin_dir();
+    if (!cache || !sysdir) {
+        log_warn("[GST] pinned set unavailable (cache=%s, plugins=%s)",
+                 cache ? cache : "-", sysdir ? sysdir : "-");
+        return 0;
+    }
+
+    char base[600], plugdir[700], registry[700], stamp_path[700];
+    snprintf(base, sizeof(base), "%s/gst-pinned", cache);
+    snprintf(plugdir, sizeof(plugdir), "%s/plugins", base);
+    snprintf(registry, sizeof(registry), "%s/registry.bin", base);
+    snprintf(stamp_path, sizeof(stamp_path), "%s/stamp", base);
+
+    if (mkdir(base, 0755) != 0 && errno != EEXIST)
+        return 0;
+
+    uint64_t sig = pinned_signature(sysdir);
+    unsigned long long stored = 0;
+
+    FILE* f = fopen(stamp_path, "r");
+    if (f) {
+        if (fscanf(f, "%llx", &stored) != 1) stored = 0;
+        fclose(f);
+    }
+
+    int unchanged = (stored == sig) && access(registry, R_OK) == 0;
+    if (!unchanged) {
+        if (!relink_plugins(sysdir, plugdir))
+            return 0;
+        unlink(registry);
+
+        f = fopen(stamp_path, "w");
+        if (f) {
+            fprintf(f, "%016llx\n", (unsigned long long)sig);
+            fclose(f);
+        }
+    }
+
+    setenv("GST_PLUGIN_SYSTEM_PATH_1_0", plugdir, 1);
+    setenv("GST_REGISTRY_1_0", registry, 1);
+    setenv("GST_REGISTRY_UPDATE", unchanged ? "no" : "yes", 1);
+
+    log_info("[GST] pinned plugin set (%s registry) from %s",
+             unchanged ? "cached" : "rebuilding", sysdir);
+    return 1;
+}
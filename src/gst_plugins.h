@@ -0,0 +1,14 @@
+#pragma once
+#include "common.h"
+
+/*
+  Pinned plugin set for boot.
+
+  Call before gst_init(). Links only the plugins this player needs into a
+  private plugin dir, points GStreamer's system path and registry file at
+  the cache dir, and disables the registry rescan while the pinned set is
+  unchanged (plugin files keep the same size and mtime).
+
+  Returns 1 if the pinned mode is active.
+*/
+int gst_plugins_prepare(void);
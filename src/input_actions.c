@@ -8,7 +8,7 @@ void on_btn3_toggle_edit(void* u)
     s->edit_mode = !s->edit_mode;
     if (s->edit_mode) s->select_mode = 1;
 
-    printf("[BTN3] EDIT %s\n", s->edit_mode ? "ON" : "OFF");
+    log_info("[BTN3] EDIT %s", s->edit_mode ? "ON" : "OFF");
     print_status(s);
 }
 
@@ -19,7 +19,7 @@ void on_btn2_toggle_select_move(void* u)
     if (!s->edit_mode) return;
 
     s->select_mode = !s->select_mode;
-    printf("[BTN2] MODE %s\n", s->select_mode ? "SELECT" : "MOVE");
+    log_info("[BTN2] MODE %s", s->select_mode ? "SELECT" : "MOVE");
     print_status(s);
 }
 
@@ -30,7 +30,7 @@ void on_btn1_cycle_corner_only(void* u)
     if (!s->edit_mode || !s->select_mode) return;
 
     s->selected_ui = (s->selected_ui + 1) % 4;
-    printf("[BTN1] SELECT %s\n", corner_name_ui(s->selected_ui));
+    log_info("[BTN1] SELECT %s", corner_name_ui(s->selected_ui));
     print_status(s);
 }
 
@@ -41,7 +41,7 @@ void move_selected_corner(AppState* s, float dx, float dy)
     s->corners[sq][1] += dy;
     rebuild_mesh_from_corners(s);
 
-    printf("[MOVE] %s dx=%.3f dy=%.3f\n", corner_name_ui(s->selected_ui), dx, dy);
+    log_debug("[MOVE] %s dx=%.3f dy=%.3f", corner_name_ui(s->selected_ui), dx, dy);
     print_status(s);
 }
 
@@ -0,0 +1,242 @@
+#include "common.h"
+#include "metrics.h"
+
+#include <poll.h>
+#include <stdarg.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/*
+  Bounded MPSC ring (Vyukov): each slot carries a sequence number that
+  says whose turn it is. Producers claim a position with a CAS on head,
+  format in place, then publish by bumping the slot's sequence; the
+  drain thread is the only consumer.
+*/
+
+typedef struct {
+    atomic_size_t seq;
+    Uint64 t_us;
+    unsigned char level;
+    char text[LOG_LINE_MAX];
+} LogSlot;
+
+typedef struct {
+    LogSlot slots[LOG_RING_CAP];
+    atomic_size_t head;
+    size_t tail;                    // drain thread only
+
+    atomic_int running;
+    atomic_int sleeping;            // drain thread is (about to be) blocked on wake_fd
+    int wake_fd;
+    GThread* thread;
+
+    atomic_ullong dropped;
+    unsigned long long dropped_reported;
+    LogLevel level;
+    Uint64 t0_us;
+} Logger;
+
+static Logger lg = { .wake_fd = -1, .level = LL_INFO };
+
+static const char LEVEL_TAG[] = { 'E', 'W', 'I', 'D' };
+
+static LogLevel level_from_string(const char* s)
+{
+    if (!s || !s[0]) return LL_INFO;
+    if (strcmp(s, "error") == 0) return LL_ERROR;
+    if (strcmp(s, "warn") == 0 || strcmp(s, "warning") == 0) return LL_WARN;
+    if (strcmp(s, "debug") == 0) return LL_DEBUG;
+    return LL_INFO;
+}
+
+static void write_line(LogLevel lvl, Uint64 t_us, const char* text)
+{
+    FILE* f = (lvl <= LL_WARN) ? stderr : stdout;
+    double t = (t_us - lg.t0_us) / 1e6;
+    fprintf(f, "%9.3f %c %s\n", t, LEVEL_TAG[lvl], text);
+}
+
+/* ================= Drain thread ================= */
+
+static int drain(void)
+{
+    int n = 0;
+    for (;;) {
+        LogSlot* s = &lg.slots[lg.tail & (LOG_RING_CAP - 1)];
+        if (atomic_load_explicit(&s->seq, memory_order_acquire) != lg.tail + 1)
+            break;
+
+        write_line((LogLevel)s->level, s->t_us, s->text);
+        atomic_store_explicit(&s->seq, lg.tail + LOG_RING_CAP, memory_order_release);
+        lg.tail++;
+        n++;
+    }
+
+    unsigned long long d = atomic_load_explicit(&lg.dropped, memory_order_relaxed);
+    if (d != lg.dropped_reported) {
+        char line[80];
+        snprintf(line, sizeof(line), "[LOG] %llu message(s) dropped, ring full", d - lg.dropped_reported);
+        write_line(LL_WARN, time_now_us(), line);
+        lg.dropped_reported = d;
+        n++;
+    }
+
+    if (n) {
+        fflush(stdout);
+        fflush(stderr);
+    }
+    return n;
+}
+
+static int ring_empty(void)
+{
+    LogSlot* s = &lg.slots[lg.tail & (LOG_RING_CAP - 1)];
+    return atomic_load_explicit(&s->seq, memory_order_acquire) != lg.tail + 1;
+}
+
+static gpointer log_thread(gpointer data)
+{
+    (void)data;
+    while (atomic_load(&lg.running)) {
+        if (drain()) continue;
+
+        // Announce the sleep, then re-check: a producer that published before
+        // seeing `sleeping` is caught here, one after it writes wake_fd.
+        atomic_store(&lg.sleeping, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (ring_empty()) {
+            struct pollfd p = { .fd = lg.wake_fd, .events = POLLIN };
+            poll(&p, 1, 200);
+            uint64_t v;
+            if (read(lg.wake_fd, &v, sizeof(v)) < 0) { /* EAGAIN: timeout */ }
+        }
+        atomic_store(&lg.sleeping, 0);
+    }
+    drain();
+    return NULL;
+}
+
+void log_init(void)
+{
+    lg.t0_us = time_now_us();
+    lg.level = level_from_string(getenv("MAPPER_LOG_LEVEL"));
+
+    for (size_t i = 0; i < LOG_RING_CAP; i++)
+        atomic_init(&lg.slots[i].seq, i);
+    atomic_init(&lg.head, 0);
+    lg.tail = 0;
+
+    lg.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (lg.wake_fd < 0) return;     // stays synchronous
+
+    atomic_store(&lg.running, 1);
+    lg.thread = g_thread_new("log", log_thread, NULL);
+}
+
+void log_shutdown(void)
+{
+    if (!lg.thread) return;
+
+    atomic_store(&lg.running, 0);
+    uint64_t one = 1;
+    if (write(lg.wake_fd, &one, sizeof(one)) < 0) { /* poll times out anyway */ }
+    g_thread_join(lg.thread);
+    lg.thread = NULL;
+
+    close(lg.wake_fd);
+    lg.wake_fd = -1;
+}
+
+/* ================= Producers ================= */
+
+int log_enabled(LogLevel lvl)
+{
+    return lvl <= lg.level;
+}
+
+unsigned long long log_dropped(void)
+{
+    return atomic_load_explicit(&lg.dropped, memory_order_relaxed);
+}
+
+static void log_vmsg(LogLevel lvl, const char* suffix, const char* fmt, va_list ap)
+{
+    Uint64 t = time_now_us();
+
+    if (!atomic_load_explicit(&lg.running, memory_order_relaxed)) {
+        char line[LOG_LINE_MAX];
+        int w = vsnprintf(line, sizeof(line), fmt, ap);
+        if (suffix && w >= 0 && (size_t)w < sizeof(line))
+            snprintf(line + w, sizeof(line) - (size_t)w, "%s", suffix);
+        write_line(lvl, t, line);
+        return;
+    }
+
+    size_t pos = atomic_load_explicit(&lg.head, memory_order_relaxed);
+    LogSlot* s;
+    for (;;) {
+        s = &lg.slots[pos & (LOG_RING_CAP - 1)];
+        size_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+        if (seq == pos) {
+            if (atomic_compare_exchange_weak_explicit(&lg.head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if ((ptrdiff_t)(seq - pos) < 0) {
+            atomic_fetch_add_explicit(&lg.dropped, 1, memory_order_relaxed);
+            metrics_add(M_LOG_DROPPED, 1);
+            return;
+        } else {
+            pos = atomic_load_explicit(&lg.head, memory_order_relaxed);
+        }
+    }
+
+    s->t_us = t;
+    s->level = (unsigned char)lvl;
+    int w = vsnprintf(s->text, sizeof(s->text), fmt, ap);
+    if (suffix && w >= 0 && (size_t)w < sizeof(s->text))
+        snprintf(s->text + w, sizeof(s->text) - (size_t)w, "%s", suffix);
+    atomic_store_explicit(&s->seq, pos + 1, memory_order_release);
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&lg.sleeping, memory_order_relaxed) &&
+        atomic_exchange(&lg.sleeping, 0)) {
+        uint64_t one = 1;
+        if (write(lg.wake_fd, &one, sizeof(one)) < 0) { /* poll times out anyway */ }
+    }
+}
+
+void log_msg(LogLevel lvl, const char* fmt, ...)
+{
+    if (!log_enabled(lvl)) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    log_vmsg(lvl, NULL, fmt, ap);
+    va_end(ap);
+}
+
+void log_msg_rate(LogRate* r, LogLevel lvl, const char* fmt, ...)
+{
+    if (!log_enabled(lvl)) return;
+
+    Uint64 now_ms = time_now_us() / 1000;
+    Uint64 start = atomic_load_explicit(&r->window_ms, memory_order_relaxed);
+    if (start == 0 || now_ms - start >= LOG_RATE_PERIOD_MS) {
+        atomic_store_explicit(&r->window_ms, now_ms, memory_order_relaxed);
+        atomic_store_explicit(&r->count, 0, memory_order_relaxed);
+    }
+    if (atomic_fetch_add_explicit(&r->count, 1, memory_order_relaxed) >= LOG_RATE_BURST) {
+        atomic_fetch_add_explicit(&r->suppressed, 1, memory_order_relaxed);
+        return;
+    }
+
+    char suffix[48] = "";
+    unsigned sup = atomic_exchange_explicit(&r->suppressed, 0, memory_order_relaxed);
+    if (sup)
+        snprintf(suffix, sizeof(suffix), " (%u similar suppressed)", sup);
+
+    va_list ap;
+    va_start(ap, fmt);
+    log_vmsg(lvl, sup ? suffix : NULL, fmt, ap);
+    va_end(ap);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <stdatomic.h>
+
+/*
+  Asynchronous logger. Callers format straight into a slot of a lock-free
+  multi-producer ring and return; a background thread writes the lines
+  out (errors and warnings to stderr, the rest to stdout). A full ring
+  drops the message and counts it instead of blocking the caller.
+
+  MAPPER_LOG_LEVEL=error | warn | info | debug   (default info)
+
+  Before log_init() and after log_shutdown() messages are written
+  synchronously, so start-up and exit paths lose nothing.
+*/
+
+#define LOG_LINE_MAX 256          // longer messages are truncated
+#define LOG_RING_CAP 512          // power of two
+#define LOG_RATE_PERIOD_MS 5000   // log_ratelimited: window ...
+#define LOG_RATE_BURST 3          // ... and messages allowed per window
+
+typedef enum {
+    LL_ERROR = 0,
+    LL_WARN,
+    LL_INFO,
+    LL_DEBUG
+} LogLevel;
+
+/* Per-call-site state for log_ratelimited(). */
+typedef struct {
+    atomic_ullong window_ms;
+    atomic_uint count;
+    atomic_uint suppressed;
+} LogRate;
+
+void log_init(void);
+void log_shutdown(void);
+
+int  log_enabled(LogLevel lvl);
+void log_msg(LogLevel lvl, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+void log_msg_rate(LogRate* r, LogLevel lvl, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+/* Messages lost to a full ring since start. */
+unsigned long long log_dropped(void);
+
+#define log_error(...) log_msg(LL_ERROR, __VA_ARGS__)
+#define log_warn(...)  log_msg(LL_WARN, __VA_ARGS__)
+#define log_info(...)  log_msg(LL_INFO, __VA_ARGS__)
+#define log_debug(...) log_msg(LL_DEBUG, __VA_ARGS__)
+
+/* At most LOG_RATE_BURST lines per LOG_RATE_PERIOD_MS from this call site;
+   the next line that gets through reports how many were suppressed. */
+#define log_ratelimited(lvl, ...) \
+    do { static LogRate log_rate_; log_msg_rate(&log_rate_, (lvl), __VA_ARGS__); } while (0)
@@ -1,9 +1,25 @@
 #include "common.h"
 #include "app_state.h"
+#include "boot.h"
+#include "commands.h"
+#include "compositor.h"
+#include "control.h"
+#include "cues.h"
+#include "decoder_proc.h"
+#include "display.h"
 #include "gpio_helpers.h"
+#include "governor.h"
 #include "input_actions.h"
+#include "metrics.h"
+#include "netsync.h"
+#include "osc.h"
+#include "perf_counters.h"
 #include "playlist.h"
+#include "program_cache.h"
+#include "rt_profile.h"
 #include "shaders.h"
+#include "splash.h"
+#include "stats.h"
 #include "video_engine.h"
 
 #include <SDL2/SDL.h>
@@ -25,11 +41,55 @@ static void gl_check(const char* where)
 {
     GLenum e = glGetError();
     if (e != GL_NO_ERROR) {
-        fprintf(stderr, "[GL] error 0x%x at %s\n", (unsigned)e, where);
-        fflush(stderr);
+        log_error("[GL] error 0x%x at %s", (unsigned)e, where);
     }
 }
 
+static const char* next_in_playlist(void* user, const char* current)
+{
+    return playlist_next((const Playlist*)user, current);
+}
+
+/* MAPPER_OVERLAY=path[,blend[,opacity]] loads a looping clip into layer 1. */
+static void load_overlay_from_env(VideoEngine* ve)
+{
+    const char* spec = getenv("MAPPER_OVERLAY");
+    if (!spec || !spec[0]) return;
+
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    char* blend = strchr(buf, ',');
+    char* opacity = NULL;
+    if (blend) {
+        *blend++ = '\0';
+        opacity = strchr(blend, ',');
+        if (opacity) *opacity++ = '\0';
+    }
+
+    const int idx = VE_BASE_LAYER + 1;
+    ve_layer_set_blend(ve, idx, ve_blend_from_string(blend));
+    ve_layer_set_opacity(ve, idx, opacity ? (float)atof(opacity) : 1.0f);
+    if (!ve_layer_load(ve, idx, buf)) {
+        log_error("Failed to start overlay: %s", buf);
+    }
+}
+
+/* MAPPER_TRANSITION=kind[,easing], e.g. "wipe,inout". */
+static void set_transition_from_env(VideoEngine* ve)
+{
+    const char* spec = getenv("MAPPER_TRANSITION");
+    if (!spec || !spec[0]) return;
+
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    char* easing = strchr(buf, ',');
+    if (easing) *easing++ = '\0';
+
+    ve_set_transition(ve, transition_from_string(buf), easing_from_string(easing));
+}
+
 static void on_btn1_edit_or_random(void* u)
 {
     Btn1Context* ctx = (Btn1Context*)u;
@@ -43,33 +103,38 @@ static void on_btn1_edit_or_random(void* u)
     if (st->edit_mode) {
         if (st->select_mode) {
             st->selected_ui = (st->selected_ui + 1) % 4;
-            printf("[BTN1] SELECT %s\n", corner_name_ui(st->selected_ui));
+            log_info("[BTN1] SELECT %s", corner_name_ui(st->selected_ui));
             print_status(st);
         }
         return;
     }
 
     if (pl->count <= 0) {
-        printf("[BTN1] RANDOM requested, but playlist is empty\n");
-        fflush(stdout);
+        log_info("[BTN1] RANDOM requested, but playlist is empty");
         return;
     }
 
-    const char* next = playlist_random(pl, ve->cur.path[0] ? ve->cur.path : NULL);
-    printf("[BTN1] RANDOM -> %s\n", next ? next : "(null)");
-    fflush(stdout);
+    const char* cur = ve_base(ve)->cur.path;
+    const char* next = playlist_random(pl, cur[0] ? cur : NULL);
+    log_info("[BTN1] RANDOM -> %s", next ? next : "(null)");
 
-    if (next)
+    if (next && !(cues_enabled() && cues_send_transition(VE_BASE_LAYER, next)))
         ve_request_transition(ve, next);
 }
 
 int main(int argc, char** argv)
 {
-    setvbuf(stdout, NULL, _IONBF, 0);
-    setvbuf(stderr, NULL, _IONBF, 0);
+    // Logging is drained off-thread; atexit flushes it on every return path.
+    log_init();
+    atexit(log_shutdown);
 
-    fprintf(stderr, "[BOOT] mapping_video_keystone starting\n");
-    fflush(stderr);
+    // Isolated decoders are this binary re-run per source (decoder_proc.h).
+    if (argc > 1 && strcmp(argv[1], "--decoder") == 0)
+        return dproc_child_main(argc, argv);
+
+    rt_init();
+
+    boot_mark("mapping_video_keystone starting");
 
     if (argc < 2) {
         fprintf(stderr, "Usage: %s /path/to/video.mp4\n", argv[0]);
@@ -80,12 +145,15 @@ int main(int argc, char** argv)
     srand((unsigned int)time(NULL));
 
     const char* initial_video = argv[1];
+    VeMode play_mode = ve_mode_from_string(getenv("MAPPER_PLAY_MODE"));
 
-    gst_init(NULL, NULL);
+    // gst_init + first pipeline preroll overlap with display/GL bring-up.
+    BootTask boot;
+    boot_start(&boot, initial_video, play_mode == VE_MODE_GAPLESS);
 
     SDL_SetHint(SDL_HINT_VIDEODRIVER, "kmsdrm");
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        fprintf(stderr, "SDL init failed: %s\n", SDL_GetError());
+        log_error("SDL init failed: %s", SDL_GetError());
         return 1;
     }
 
@@ -93,130 +161,86 @@ int main(int argc, char** argv)
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
 
+    int ww = 0, wh = 0;
+    display_init(&ww, &wh);
+
     SDL_Window* window = SDL_CreateWindow(
         "Mapping Video Keystone",
-        0, 0, 1920, 1080,
+        0, 0, ww, wh,
         SDL_WINDOW_OPENGL | SDL_WINDOW_FULLSCREEN
     );
     if (!window) {
-        fprintf(stderr, "Window creation failed: %s\n", SDL_GetError());
+        log_error("Window creation failed: %s", SDL_GetError());
         return 1;
     }
+    display_attach(window);
 
     SDL_ShowCursor(SDL_DISABLE);
 
     SDL_GLContext ctx = SDL_GL_CreateContext(window);
     if (!ctx) {
-        fprintf(stderr, "GL context creation failed: %s\n", SDL_GetError());
+        log_error("GL context creation failed: %s", SDL_GetError());
         return 1;
     }
 
     int dw = 0, dh = 0;
     SDL_GL_GetDrawableSize(window, &dw, &dh);
     if (dw <= 0 || dh <= 0) {
-        dw = 1920;
-        dh = 1080;
+        dw = ww;
+        dh = wh;
     }
     glViewport(0, 0, dw, dh);
 
-    fprintf(stderr, "Renderer: %s\n", glGetString(GL_RENDERER));
-    fprintf(stderr, "Version : %s\n", glGetString(GL_VERSION));
-    fprintf(stderr, "Viewport: %dx%d\n", dw, dh);
-    fflush(stderr);
-
-    GLuint vs = compile_shader(GL_VERTEX_SHADER, vertex_shader_src);
-    GLuint fs = compile_shader(GL_FRAGMENT_SHADER, fragment_shader_src);
-
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vs);
-    glAttachShader(program, fs);
-    glLinkProgram(program);
-
-    GLint linked = 0;
-    glGetProgramiv(program, GL_LINK_STATUS, &linked);
-    if (!linked) {
-        char log[1024];
-        glGetProgramInfoLog(program, sizeof(log), NULL, log);
-        fprintf(stderr, "Program link error: %s\n", log);
-        fflush(stderr);
-        return 1;
-    }
-
-    glUseProgram(program);
-    gl_check("after glUseProgram");
+    log_info("Renderer: %s", glGetString(GL_RENDERER));
+    log_info("Version : %s", glGetString(GL_VERSION));
+    log_info("Viewport: %dx%d", dw, dh);
+    boot_mark("display ready");
 
-    const int numVerts = GRID_X * GRID_Y;
-    const int numIndices = (GRID_X - 1) * (GRID_Y - 1) * 6;
+    program_cache_init();
 
-    float* vertices = (float*)malloc((size_t)numVerts * 4 * sizeof(float));
-    GLushort* indices = (GLushort*)malloc((size_t)numIndices * sizeof(GLushort));
-    if (!vertices || !indices) {
-        fprintf(stderr, "Out of memory\n");
-        return 1;
+    Splash splash;
+    if (splash_load(&splash)) {
+        glClearColor(0.f, 0.f, 0.f, 1.f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        splash_draw(&splash);
+        SDL_GL_SwapWindow(window);
+        boot_mark("splash shown");
     }
 
-    int ii = 0;
-    for (int y = 0; y < GRID_Y - 1; y++) {
-        for (int x = 0; x < GRID_X - 1; x++) {
-            int tl = y * GRID_X + x;
-            int tr = tl + 1;
-            int bl = tl + GRID_X;
-            int br = bl + 1;
-
-            indices[ii++] = (GLushort)tl;
-            indices[ii++] = (GLushort)bl;
-            indices[ii++] = (GLushort)tr;
-
-            indices[ii++] = (GLushort)tr;
-            indices[ii++] = (GLushort)bl;
-            indices[ii++] = (GLushort)br;
-        }
+    // Sized for the densest mesh; app_state_set_grid fills them.
+    const int maxVerts = GRID_X * GRID_Y;
+    const int maxIndices = (GRID_X - 1) * (GRID_Y - 1) * 6;
+
+    float* vertices = (float*)malloc((size_t)maxVerts * 4 * sizeof(float));
+    if (!vertices) {
+        log_error("Out of memory");
+        return 1;
     }
 
     GLuint vbo = 0, ebo = 0;
     glGenBuffers(1, &vbo);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, (size_t)numVerts * 4 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, (size_t)maxVerts * 4 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
 
     glGenBuffers(1, &ebo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 (size_t)numIndices * sizeof(GLushort),
-                 indices,
-                 GL_STATIC_DRAW);
-
-    GLint aPos = glGetAttribLocation(program, "aPos");
-    GLint aTex = glGetAttribLocation(program, "aTex");
-    if (aPos < 0 || aTex < 0) {
-        fprintf(stderr, "Shader attributes missing: aPos=%d aTex=%d\n", aPos, aTex);
-        return 1;
-    }
+                 (size_t)maxIndices * sizeof(GLushort),
+                 NULL,
+                 GL_DYNAMIC_DRAW);
 
-    glEnableVertexAttribArray((GLuint)aPos);
-    glVertexAttribPointer((GLuint)aPos, 2, GL_FLOAT, GL_FALSE,
-                          4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray((GLuint)aTex);
-    glVertexAttribPointer((GLuint)aTex, 2, GL_FLOAT, GL_FALSE,
-                          4 * sizeof(float), (void*)(2 * sizeof(float)));
-
-    GLint uTexY = glGetUniformLocation(program, "uTexY");
-    GLint uTexU = glGetUniformLocation(program, "uTexU");
-    GLint uTexV = glGetUniformLocation(program, "uTexV");
-    GLint uRange = glGetUniformLocation(program, "uVideoRange");
-    GLint u709 = glGetUniformLocation(program, "uBT709");
-    GLint uAlpha = glGetUniformLocation(program, "uAlpha");
-
-    if (uTexY >= 0) glUniform1i(uTexY, 0);
-    if (uTexU >= 0) glUniform1i(uTexU, 1);
-    if (uTexV >= 0) glUniform1i(uTexV, 2);
-    if (uAlpha >= 0) glUniform1f(uAlpha, 1.0f);
+    Compositor comp;
+    if (!compositor_init(&comp, vbo, ebo))
+        return 1;
+    if (getenv("MAPPER_TRANSITION_MASK"))
+        compositor_set_mask(&comp, getenv("MAPPER_TRANSITION_MASK"));
+    gl_check("after compositor_init");
 
     AppState st;
     memset(&st, 0, sizeof(st));
     st.vertices = vertices;
-    st.numVerts = numVerts;
-    st.numIndices = numIndices;
     st.vbo = vbo;
+    st.ebo = ebo;
     st.edit_mode = 0;
     st.select_mode = 1;
     st.selected_ui = 0;
@@ -226,21 +250,40 @@ int main(int argc, char** argv)
     st.corners[C_BR][0] =  1.0f; st.corners[C_BR][1] = -1.0f;
     st.corners[C_TR][0] =  1.0f; st.corners[C_TR][1] =  1.0f;
     st.corners[C_TL][0] = -1.0f; st.corners[C_TL][1] =  1.0f;
-    rebuild_mesh_from_corners(&st);
+    app_state_set_grid(&st, GRID_X, GRID_Y);
     print_status(&st);
 
+    // Filled in by the boot worker once the directory scan is done.
     Playlist pl;
-    char videos_dir[512];
-    if (!playlist_load_from_home_videos(&pl, videos_dir, sizeof(videos_dir))) {
-        memset(&pl, 0, sizeof(pl));
-    }
+    memset(&pl, 0, sizeof(pl));
+    int playlist_ready = 0;
 
     VideoEngine ve;
     ve_init(&ve);
-    if (!ve_start_current(&ve, initial_video)) {
-        fprintf(stderr, "Failed to start video: %s\n", initial_video);
-        fflush(stderr);
+    ve_set_mode(&ve, play_mode);
+    ve_set_next_provider(&ve, next_in_playlist, &pl);
+    set_transition_from_env(&ve);
+
+    Video first;
+    if (boot_wait_pipeline(&boot, &first)) {
+        ve_adopt_current(&ve, &first);
+    } else {
+        log_error("Failed to start video: %s", initial_video);
     }
+    boot_mark("first pipeline adopted");
+
+    // Needs gst_init, which the boot worker has finished by now.
+    netsync_init(getenv("MAPPER_SYNC"));
+    cues_init(getenv("MAPPER_CUES"));
+    control_start(getenv("MAPPER_CONTROL"));
+    osc_start(getenv("MAPPER_OSC"));
+    metrics_start(getenv("MAPPER_METRICS"));
+    perf_init();
+
+    governor_init(&ve, &st, display_refresh_hz());
+
+    CmdTarget cmd_target = { &ve, &st, &pl };
+    load_overlay_from_env(&ve);
 
     const char* consumer = "mapping_video_keystone";
     GpioLine* line_btn1 = gpio_request_line(GPIO_BTN1, consumer);
@@ -258,17 +301,28 @@ int main(int argc, char** argv)
     };
 
     glClearColor(0.f, 0.f, 0.f, 1.f);
-    fprintf(stderr, "[BOOT] entering main loop\n");
-    fflush(stderr);
+    rt_enter_render_thread();
+    log_info("[BOOT] entering main loop");
+
+    int first_frame_shown = 0;
 
     while (keepRunning) {
+        if (!playlist_ready)
+            playlist_ready = boot_take_playlist(&boot, &pl);
+
         SDL_Event e;
         while (SDL_PollEvent(&e)) {
             if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)
                 keepRunning = 0;
         }
 
+        cues_poll(&ve, &pl);
+        commands_apply(&cmd_target);
+
+        StageMark m;
+        stats_stage_begin(&m);
         ve_update(&ve);
+        stats_stage_end(STAGE_VE_UPDATE, &m, 0);
 
         gpio_process_events(line_btn3, on_btn3_toggle_edit, &st);
         gpio_process_events(line_btn2, on_btn2_toggle_select_move, &st);
@@ -278,33 +332,37 @@ int main(int argc, char** argv)
         gpio_process_events(line_left, on_left, &st);
         gpio_process_events(line_right, on_right, &st);
 
-        glUseProgram(program);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        if (ve.cur.tex_inited) {
-            glDisable(GL_BLEND);
-            if (uAlpha >= 0) glUniform1f(uAlpha, 1.0f);
-            if (uRange >= 0) glUniform1i(uRange, ve.cur.video_range);
-            if (u709 >= 0) glUniform1i(u709, ve.cur.bt709);
-            ve_bind_video_textures(&ve.cur, uTexY, uTexU, uTexV);
-            glDrawElements(GL_TRIANGLES, (GLsizei)st.numIndices, GL_UNSIGNED_SHORT, 0);
+        Layer* base = ve_base(&ve);
+        comp.underlay = !base->cur.tex_inited && splash.loaded;
+        if (comp.underlay) {
+            // Hold the splash until the first decoded frame replaces it.
+            splash_draw(&splash);
         }
 
-        if (ve.transitioning && ve.nxt.tex_inited) {
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        stats_stage_begin(&m);
+        compositor_draw(&comp, &ve, &st);
+        stats_stage_end(STAGE_DRAW, &m, 0);
 
-            if (uAlpha >= 0) glUniform1f(uAlpha, ve.blend);
-            if (uRange >= 0) glUniform1i(uRange, ve.nxt.video_range);
-            if (u709 >= 0) glUniform1i(u709, ve.nxt.bt709);
-
-            ve_bind_video_textures(&ve.nxt, uTexY, uTexU, uTexV);
-            glDrawElements(GL_TRIANGLES, (GLsizei)st.numIndices, GL_UNSIGNED_SHORT, 0);
-        }
+        // ESC / SIGINT during this frame: keep it as next boot's splash.
+        if (!keepRunning)
+            splash_capture(dw, dh);
 
         SDL_GL_SwapWindow(window);
+        stats_frame_end();
+        governor_frame_end();
+        display_frame_end(&base->cur);
+        rt_frame_end();
+        netsync_tick();
+        cues_after_swap(&ve);
+        commands_after_swap();
+
+        if (!first_frame_shown && base->cur.tex_inited) {
+            first_frame_shown = 1;
+            boot_mark("first video frame presented (time-to-first-frame)");
+            splash_free(&splash);
+        }
     }
 
     gpio_release_line(line_btn1);
@@ -315,21 +373,28 @@ int main(int argc, char** argv)
     gpio_release_line(line_left);
     gpio_release_line(line_right);
 
+    splash_free(&splash);
     ve_shutdown(&ve);
+    governor_shutdown();
+    perf_shutdown();
+    metrics_stop();
+    osc_stop();
+    control_stop();
+    cues_shutdown();
+    netsync_shutdown();
+    boot_join(&boot);
+    playlist_free(&boot.pl);
     playlist_free(&pl);
 
     glDeleteBuffers(1, &vbo);
     glDeleteBuffers(1, &ebo);
-    glDeleteProgram(program);
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+    compositor_shutdown(&comp);
 
     SDL_GL_DeleteContext(ctx);
     SDL_DestroyWindow(window);
     SDL_Quit();
 
     free(vertices);
-    free(indices);
 
     return 0;
 }
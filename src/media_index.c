@@ -0,0 +1,159 @@
+#include "media_index.h"
+
+#include <unistd.h>
+
+typedef struct {
+    char* path;
+    long long size;
+    long long mtime;
+    MediaChain chain;
+} MediaEntry;
+
+static GMutex g_lock;
+static MediaEntry* g_entries = NULL;
+static int g_count = 0;
+static int g_cap = 0;
+static int g_loaded = 0;
+
+static void index_path(char* out, size_t out_sz)
+{
+    const char* dir = app_cache_dir();
+    snprintf(out, out_sz, "%s/media_index.txt", dir ? dir : "/tmp");
+}
+
+static MediaEntry* find_entry(const char* path)
+{
+    for (int i = 0; i < g_count; i++)
+        if (strcmp(g_entries[i].path, path) == 0) return &g_entries[i];
+    return NULL;
+}
+
+static MediaEntry* add_entry(const char* path)
+{
+    if (g_count >= g_cap) {
+        int ncap = (g_cap == 0) ? 16 : g_cap * 2;
+        MediaEntry* n = (MediaEntry*)realloc(g_entries, (size_t)ncap * sizeof(MediaEntry));
+        if (!n) return NULL;
+        g_entries = n;
+        g_cap = ncap;
+    }
+    MediaEntry* e = &g_entries[g_count++];
+    memset(e, 0, sizeof(*e));
+    e->path = strdup(path);
+    return e;
+}
+
+static void field_copy(char* dst, size_t dst_sz, const char* src)
+{
+    // "-" marks an empty field on disk
+    snprintf(dst, dst_sz, "%s", strcmp(src, "-") == 0 ? "" : src);
+}
+
+/* Line format: size mtime caps demux parser decoder path */
+static void load_locked(void)
+{
+    if (g_loaded) return;
+    g_loaded = 1;
+
+    char file[600];
+    index_path(file, sizeof(file));
+    FILE* f = fopen(file, "r");
+    if (!f) return;
+
+    char line[1400];
+    while (fgets(line, sizeof(line), f)) {
+        long long size, mtime;
+        char caps[64], demux[64], parser[64], decoder[64];
+        int off = 0;
+        if (sscanf(line, "%lld %lld %63s %63s %63s %63s %n",
+                   &size, &mtime, caps, demux, parser, decoder, &off) != 6 || off <= 0)
+            continue;
+
+        char* path = line + off;
+        path[strcspn(path, "\n")] = '\0';
+        if (!path[0]) continue;
+
+        MediaEntry* e = add_entry(path);
+        if (!e) break;
+        e->size = size;
+        e->mtime = mtime;
+        field_copy(e->chain.caps, sizeof(e->chain.caps), caps);
+        field_copy(e->chain.demux, sizeof(e->chain.demux), demux);
+        field_copy(e->chain.parser, sizeof(e->chain.parser), parser);
+        field_copy(e->chain.decoder, sizeof(e->chain.decoder), decoder);
+    }
+    fclose(f);
+}
+
+static void save_locked(void)
+{
+    char file[600], tmp[640];
+    index_path(file, sizeof(file));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", file);
+
+    FILE* f = fopen(tmp, "w");
+    if (!f) return;
+    for (int i = 0; i < g_count; i++) {
+        const MediaEntry* e = &g_entries[i];
+        if (!e->chain.decoder[0]) continue;
+        fprintf(f, "%lld %lld %s %s %s %s %s\n", e->size, e->mtime,
+                e->chain.caps, e->chain.demux,
+                e->chain.parser[0] ? e->chain.parser : "-",
+                e->chain.decoder, e->path);
+    }
+    if (fclose(f) == 0) rename(tmp, file);
+    else                unlink(tmp);
+}
+
+int media_index_lookup(const char* path, MediaChain* out)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+
+    g_mutex_lock(&g_lock);
+    load_locked();
+
+    int ok = 0;
+    MediaEntry* e = find_entry(path);
+    if (e && e->size == (long long)st.st_size && e->mtime == (long long)st.st_mtime &&
+        e->chain.caps[0] && e->chain.demux[0] && e->chain.decoder[0]) {
+        *out = e->chain;
+        ok = 1;
+    }
+    g_mutex_unlock(&g_lock);
+    return ok;
+}
+
+void media_index_store(const char* path, const MediaChain* chain)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) return;
+    if (!chain->caps[0] || !chain->demux[0] || !chain->decoder[0]) return;
+
+    g_mutex_lock(&g_lock);
+    load_locked();
+
+    MediaEntry* e = find_entry(path);
+    if (!e) e = add_entry(path);
+    if (e) {
+        e->size = (long long)st.st_size;
+        e->mtime = (long long)st.st_mtime;
+        e->chain = *chain;
+        save_locked();
+    }
+    g_mutex_unlock(&g_lock);
+}
+
+void media_index_forget(const char* path)
+{
+    g_mutex_lock(&g_lock);
+    load_locked();
+
+    MediaEntry* e = find_entry(path);
+    if (e) {
+        free(e->path);
+        *e = g_entries[--g_count];
+        save_locked();
+    }
+    g_mutex_unlock(&g_lock);
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "common.h"
+
+/*
+  Per-file decode chain learned from decodebin on first play, persisted in
+  the cache dir. Entries are keyed by path and invalidated by size/mtime.
+*/
+typedef struct {
+    char caps[64];     // elementary stream caps name, e.g. "video/x-h264"
+    char demux[64];
+    char parser[64];   // may be empty
+    char decoder[64];
+} MediaChain;
+
+int  media_index_lookup(const char* path, MediaChain* out);
+void media_index_store(const char* path, const MediaChain* chain);
+void media_index_forget(const char* path);
@@ -0,0 +1,289 @@
+#include "metrics.h"
+
+#include <arpa/inet.h>
+#include <stdarg.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define METRICS_DEFAULT_ADDR "127.0.0.1"
+#define HIST_MAX_BUCKETS 12
+
+typedef struct {
+    const char* name;
+    const char* help;
+} MetricInfo;
+
+static const MetricInfo COUNTER_INFO[M_COUNTER_COUNT] = {
+    { "mapper_frames_presented_total",  "Frames swapped to the display" },
+    { "mapper_frames_dropped_total",    "Frames lost upstream or discarded without being shown" },
+    { "mapper_frames_repeated_total",   "Render frames where a visible clip had a frame due but none decoded" },
+    { "mapper_upload_bytes_total",      "Bytes uploaded to video textures" },
+    { "mapper_bus_errors_total",        "GStreamer bus errors" },
+    { "mapper_pipeline_restarts_total", "Decode pipelines rebuilt after a failure" },
+    { "mapper_transitions_total",       "Layer transitions started" },
+    { "mapper_log_dropped_total",       "Log messages lost to a full log ring" },
+    { "mapper_stalls_total",            "Decoder errors or stalls caught by the watchdog" },
+    { "mapper_stall_skips_total",       "Clips skipped after the watchdog gave up rebuilding them" },
+};
+
+typedef struct {
+    const char* name;
+    const char* help;
+    int n;
+    double le[HIST_MAX_BUCKETS];         // upper bounds, seconds
+} HistInfo;
+
+static const HistInfo HIST_INFO[H_COUNT] = {
+    { "mapper_frame_seconds", "Time between buffer swaps", 10,
+      { 0.008, 0.012, 0.0167, 0.020, 0.025, 0.0334, 0.050, 0.0667, 0.100, 0.250 } },
+    { "mapper_decoder_start_seconds", "Pipeline start to first decoded frame", 9,
+      { 0.025, 0.050, 0.100, 0.150, 0.250, 0.500, 1.0, 2.0, 5.0 } },
+    { "mapper_decode_interval_seconds", "Time between decoded frames leaving the decoder", 9,
+      { 0.005, 0.010, 0.0167, 0.020, 0.025, 0.0334, 0.040, 0.050, 0.100 } },
+    { "mapper_transition_latency_seconds", "Transition request to incoming clip on screen", 9,
+      { 0.025, 0.050, 0.100, 0.150, 0.250, 0.500, 1.0, 2.0, 5.0 } },
+    { "mapper_recovery_seconds", "Watchdog fault detected to new frames again", 9,
+      { 0.100, 0.250, 0.500, 1.0, 2.0, 5.0, 10.0, 30.0, 60.0 } },
+};
+
+typedef struct {
+    atomic_ullong bucket[HIST_MAX_BUCKETS + 1];   // last = +Inf
+    atomic_ullong sum_us;
+    atomic_ullong count;
+} Hist;
+
+static atomic_ullong counters[M_COUNTER_COUNT];
+static Hist hists[H_COUNT];
+
+void metrics_add(MetricCounter c, Uint64 n)
+{
+    atomic_fetch_add_explicit(&counters[c], n, memory_order_relaxed);
+}
+
+void metrics_observe_us(MetricHist h, Uint64 us)
+{
+    const HistInfo* info = &HIST_INFO[h];
+    double s = us / 1e6;
+    int b = 0;
+    while (b < info->n && s > info->le[b]) b++;
+
+    atomic_fetch_add_explicit(&hists[h].bucket[b], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hists[h].sum_us, us, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hists[h].count, 1, memory_order_relaxed);
+}
+
+/* ================= Exposition ================= */
+
+typedef struct {
+    char* buf;
+    size_t cap;
+    size_t len;
+} Out;
+
+static void emit(Out* o, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+static void emit(Out* o, const char* fmt, ...)
+{
+    if (o->len >= o->cap) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int w = vsnprintf(o->buf + o->len, o->cap - o->len, fmt, ap);
+    va_end(ap);
+    if (w > 0) o->len += (size_t)w;
+    if (o->len > o->cap) o->len = o->cap;
+}
+
+static int read_long(const char* path, long* out)
+{
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    int ok = fscanf(f, "%li", out) == 1;
+    fclose(f);
+    return ok;
+}
+
+static void emit_platform(Out* o)
+{
+    long milli;
+    if (read_long("/sys/class/thermal/thermal_zone0/temp", &milli)) {
+        emit(o, "# HELP mapper_soc_temperature_celsius SoC temperature\n"
+                "# TYPE mapper_soc_temperature_celsius gauge\n"
+                "mapper_soc_temperature_celsius %.1f\n", milli / 1000.0);
+    }
+
+    // Raspberry Pi firmware flags (same bits as `vcgencmd get_throttled`)
+    long t;
+    if (read_long("/sys/devices/platform/soc/soc:firmware/get_throttled", &t)) {
+        static const struct { int bit; const char* flag; } F[] = {
+            { 0, "under_voltage" }, { 1, "freq_capped" }, { 2, "throttled" }, { 3, "soft_temp_limit" },
+            { 16, "under_voltage_occurred" }, { 17, "freq_capped_occurred" },
+            { 18, "throttled_occurred" }, { 19, "soft_temp_limit_occurred" },
+        };
+        emit(o, "# HELP mapper_throttled Firmware throttling flags\n# TYPE mapper_throttled gauge\n");
+        for (size_t i = 0; i < sizeof(F) / sizeof(F[0]); i++)
+            emit(o, "mapper_throttled{flag=\"%s\"} %ld\n", F[i].flag, (t >> F[i].bit) & 1);
+    }
+}
+
+static size_t render_metrics(char* buf, size_t cap)
+{
+    Out o = { buf, cap, 0 };
+
+    for (int i = 0; i < M_COUNTER_COUNT; i++) {
+        emit(&o, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+             COUNTER_INFO[i].name, COUNTER_INFO[i].help, COUNTER_INFO[i].name, COUNTER_INFO[i].name,
+             atomic_load_explicit(&counters[i], memory_order_relaxed));
+    }
+
+    for (int h = 0; h < H_COUNT; h++) {
+        const HistInfo* info = &HIST_INFO[h];
+        emit(&o, "# HELP %s %s\n# TYPE %s histogram\n", info->name, info->help, info->name);
+
+        unsigned long long cum = 0;
+        for (int b = 0; b <= info->n; b++) {
+            cum += atomic_load_explicit(&hists[h].bucket[b], memory_order_relaxed);
+            if (b < info->n)
+                emit(&o, "%s_bucket{le=\"%g\"} %llu\n", info->name, info->le[b], cum);
+            else
+                emit(&o, "%s_bucket{le=\"+Inf\"} %llu\n", info->name, cum);
+        }
+        emit(&o, "%s_sum %.6f\n%s_count %llu\n",
+             info->name, atomic_load_explicit(&hists[h].sum_us, memory_order_relaxed) / 1e6,
+             info->name, cum);
+    }
+
+    emit_platform(&o);
+    return o.len;
+}
+
+/* ================= HTTP ================= */
+
+typedef struct {
+    GThread* thread;
+    int fd;
+    int stop_fd;
+    int stop_wr;
+} MetricsServer;
+
+static MetricsServer ms = { .fd = -1, .stop_fd = -1, .stop_wr = -1 };
+
+static void write_all(int fd, const char* p, size_t n)
+{
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w <= 0) return;
+        p += w;
+        n -= (size_t)w;
+    }
+}
+
+static void serve_client(int fd)
+{
+    static char body[16384];
+    char req[1024];
+
+    // One short request per connection; slow clients get a 1 s budget.
+    struct timeval tv = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ssize_t n = recv(fd, req, sizeof(req) - 1, 0);
+    if (n <= 0) return;
+    req[n] = '\0';
+
+    char head[160];
+    if (strncmp(req, "GET /metrics", 12) == 0 && (req[12] == ' ' || req[12] == '?')) {
+        size_t len = render_metrics(body, sizeof(body));
+        int hl = snprintf(head, sizeof(head),
+                          "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                          "Content-Length: %zu\r\nConnection: close\r\n\r\n", len);
+        write_all(fd, head, (size_t)hl);
+        write_all(fd, body, len);
+    } else {
+        static const char nf[] = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        write_all(fd, nf, sizeof(nf) - 1);
+    }
+}
+
+static gpointer metrics_thread(gpointer data)
+{
+    (void)data;
+    struct pollfd pfd[2] = {
+        { .fd = ms.stop_fd, .events = POLLIN },
+        { .fd = ms.fd, .events = POLLIN },
+    };
+
+    for (;;) {
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pfd[0].revents) break;
+        if (!(pfd[1].revents & POLLIN)) continue;
+
+        int c = accept(ms.fd, NULL, NULL);
+        if (c < 0) continue;
+        serve_client(c);
+        close(c);
+    }
+    return NULL;
+}
+
+int metrics_start(const char* spec)
+{
+    if (!spec || !spec[0] || strcmp(spec, "off") == 0 || strcmp(spec, "0") == 0)
+        return 1;
+
+    char host[64] = METRICS_DEFAULT_ADDR;
+    int port;
+    const char* colon = strrchr(spec, ':');
+    if (colon) {
+        snprintf(host, sizeof(host), "%.*s", (int)(colon - spec), spec);
+        port = atoi(colon + 1);
+    } else {
+        port = atoi(spec);
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (port <= 0 || inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        log_error("[METRICS] bad MAPPER_METRICS \"%s\" (port | addr:port)", spec);
+        return 0;
+    }
+
+    int pipefd[2];
+    if (pipe(pipefd) != 0) goto fail;
+    ms.stop_fd = pipefd[0];
+    ms.stop_wr = pipefd[1];
+
+    ms.fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (ms.fd < 0) goto fail;
+    int one = 1;
+    setsockopt(ms.fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(ms.fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(ms.fd, 4) != 0)
+        goto fail;
+
+    ms.thread = g_thread_new("metrics", metrics_thread, NULL);
+
+    log_info("[METRICS] serving http://%s:%d/metrics", host, port);
+    return 1;
+
+fail:
+    log_error("[METRICS] cannot listen on %s:%d: %s", host, port, strerror(errno));
+    metrics_stop();
+    return 0;
+}
+
+void metrics_stop(void)
+{
+    if (ms.thread) {
+        if (write(ms.stop_wr, "x", 1) < 0) { /* thread exits on close below */ }
+        g_thread_join(ms.thread);
+        ms.thread = NULL;
+    }
+    if (ms.fd >= 0) close(ms.fd);
+    if (ms.stop_fd >= 0) close(ms.stop_fd);
+    if (ms.stop_wr >= 0) close(ms.stop_wr);
+    ms.fd = ms.stop_fd = ms.stop_wr = -1;
+}
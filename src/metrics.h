@@ -0,0 +1,41 @@
+#pragma once
+#include "common.h"
+#include <stdatomic.h>
+
+/*
+  Process-wide metrics as lock-free atomics. The render and streaming
+  paths only do relaxed atomic adds; an optional HTTP thread serves them
+  in Prometheus text format on GET /metrics and reads the SoC
+  temperature and firmware throttling flags at scrape time.
+
+  MAPPER_METRICS=port | addr:port   (default address 127.0.0.1)
+*/
+
+typedef enum {
+    M_FRAMES_PRESENTED = 0,
+    M_FRAMES_DROPPED,        // frames lost upstream or discarded unshown
+    M_FRAMES_REPEATED,       // a visible source had a frame due but no new sample
+    M_UPLOAD_BYTES,
+    M_BUS_ERRORS,
+    M_PIPELINE_RESTARTS,
+    M_TRANSITIONS,
+    M_LOG_DROPPED,
+    M_STALLS,                // decoder errors or stalls caught by the watchdog
+    M_STALL_SKIPS,           // ... given up on: the playlist moved past the clip
+    M_COUNTER_COUNT
+} MetricCounter;
+
+typedef enum {
+    H_FRAME_TIME = 0,        // swap to swap
+    H_DECODER_START,         // pipeline start -> first decoded sample
+    H_DECODE_INTERVAL,       // between decoded frames leaving the decoder
+    H_TRANSITION_LATENCY,    // transition requested -> incoming clip on screen
+    H_RECOVERY,              // watchdog fault detected -> new frames again
+    H_COUNT
+} MetricHist;
+
+void metrics_add(MetricCounter c, Uint64 n);
+void metrics_observe_us(MetricHist h, Uint64 us);
+
+int  metrics_start(const char* spec);
+void metrics_stop(void);
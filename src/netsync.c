@@ -0,0 +1,174 @@
+#include "netsync.h"
+#include <gst/net/gstnet.h>
+
+typedef struct {
+    SyncRole role;
+    GstClock* clock;               // leader: system clock, follower: net client clock
+    GstNetTimeProvider* provider;  // leader only
+    char host[128];
+    int port;
+    int synced_logged;
+
+    // Report window
+    Uint64 window_start_us;
+    GstClockTime last_internal;
+    double off_sum, off_sq, off_min, off_max;
+    Uint32 off_n;
+    double err_abs_sum, err_max;
+    Uint32 frames, dropped, resyncs;
+} NetSync;
+
+static NetSync ns;
+
+static int parse_spec(const char* spec)
+{
+    char buf[192];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    ns.port = NETSYNC_DEFAULT_PORT;
+
+    char* rest = strchr(buf, ':');
+    if (rest) *rest++ = '\0';
+
+    if (strcmp(buf, "leader") == 0) {
+        ns.role = SYNC_LEADER;
+        if (rest && rest[0]) ns.port = atoi(rest);
+        return ns.port > 0;
+    }
+
+    if (strcmp(buf, "follower") == 0 && rest && rest[0]) {
+        ns.role = SYNC_FOLLOWER;
+        char* port = strrchr(rest, ':');
+        if (port) {
+            *port++ = '\0';
+            ns.port = atoi(port);
+        }
+        snprintf(ns.host, sizeof(ns.host), "%s", rest);
+        return ns.port > 0 && ns.host[0];
+    }
+    return 0;
+}
+
+int netsync_init(const char* spec)
+{
+    memset(&ns, 0, sizeof(ns));
+    if (!spec || !spec[0] || strcmp(spec, "off") == 0)
+        return 1;
+
+    if (!parse_spec(spec)) {
+        log_error("[SYNC] bad MAPPER_SYNC \"%s\" (leader[:port] | follower:host[:port])", spec);
+        memset(&ns, 0, sizeof(ns));
+        return 0;
+    }
+
+    if (ns.role == SYNC_LEADER) {
+        ns.clock = gst_system_clock_obtain();
+        ns.provider = gst_net_time_provider_new(ns.clock, NULL, ns.port);
+        if (!ns.provider) {
+            log_error("[SYNC] cannot serve clock on port %d", ns.port);
+            netsync_shutdown();
+            return 0;
+        }
+        log_info("[SYNC] leader: serving clock on port %d", ns.port);
+    } else {
+        ns.clock = gst_net_client_clock_new("mapper-sync", ns.host, ns.port, 0);
+        if (!ns.clock) {
+            log_error("[SYNC] cannot create client clock for %s:%d", ns.host, ns.port);
+            netsync_shutdown();
+            return 0;
+        }
+        // Playback runs free until the first calibration arrives.
+        log_info("[SYNC] follower: slaving to %s:%d", ns.host, ns.port);
+    }
+    return 1;
+}
+
+void netsync_shutdown(void)
+{
+    if (ns.provider) gst_object_unref(ns.provider);
+    if (ns.clock) gst_object_unref(ns.clock);
+    memset(&ns, 0, sizeof(ns));
+}
+
+SyncRole netsync_role(void)
+{
+    return ns.role;
+}
+
+int netsync_active(void)
+{
+    if (!ns.clock) return 0;
+    if (ns.role == SYNC_LEADER) return 1;
+
+    if (!gst_clock_is_synced(ns.clock)) return 0;
+    if (!ns.synced_logged) {
+        ns.synced_logged = 1;
+        log_info("[SYNC] follower: clock synced");
+    }
+    return 1;
+}
+
+GstClockTime netsync_now(void)
+{
+    return netsync_active() ? gst_clock_get_time(ns.clock) : GST_CLOCK_TIME_NONE;
+}
+
+void netsync_note_frame(gint64 error_ns, int dropped, int resynced)
+{
+    double e = error_ns < 0 ? -(double)error_ns : (double)error_ns;
+    ns.err_abs_sum += e;
+    if (e > ns.err_max) ns.err_max = e;
+    ns.frames++;
+    ns.dropped += (Uint32)dropped;
+    ns.resyncs += (Uint32)resynced;
+}
+
+/* Followers: offset between the local and leader clock at each new calibration point. */
+static void sample_offset(void)
+{
+    if (ns.role != SYNC_FOLLOWER) return;
+
+    GstClockTime internal, external, num, den;
+    gst_clock_get_calibration(ns.clock, &internal, &external, &num, &den);
+    if (internal == ns.last_internal) return;
+    ns.last_internal = internal;
+
+    double off = (double)(gint64)(external - internal);
+    if (ns.off_n == 0 || off < ns.off_min) ns.off_min = off;
+    if (ns.off_n == 0 || off > ns.off_max) ns.off_max = off;
+    ns.off_sum += off;
+    ns.off_sq += off * off;
+    ns.off_n++;
+}
+
+void netsync_tick(void)
+{
+    if (!ns.clock) return;
+
+    sample_offset();
+
+    Uint64 now = time_now_us();
+    if (ns.window_start_us == 0) ns.window_start_us = now;
+    if (now - ns.window_start_us < (Uint64)NETSYNC_REPORT_MS * 1000ull) return;
+
+    if (ns.role == SYNC_FOLLOWER && ns.off_n > 0) {
+        double mean = ns.off_sum / ns.off_n;
+        double var = ns.off_sq / ns.off_n - mean * mean;
+        double jitter = var > 0.0 ? SDL_sqrt(var) : 0.0;
+        log_info("[SYNC] clock offset %+.3f ms (min %+.3f max %+.3f) jitter %.3f ms over %u calibration(s)",
+                 mean / 1e6, ns.off_min / 1e6, ns.off_max / 1e6, jitter / 1e6, ns.off_n);
+    } else if (ns.role == SYNC_FOLLOWER) {
+        log_info("[SYNC] no calibration from %s:%d yet", ns.host, ns.port);
+    }
+
+    if (ns.frames > 0) {
+        log_info("[SYNC] %s frame error avg %.2f ms max %.2f ms, %u dropped to catch up, %u reseek(s)",
+                 ns.role == SYNC_LEADER ? "leader" : "follower",
+                 ns.err_abs_sum / ns.frames / 1e6, ns.err_max / 1e6, ns.dropped, ns.resyncs);
+    }
+
+    ns.off_sum = ns.off_sq = ns.off_min = ns.off_max = 0.0;
+    ns.off_n = 0;
+    ns.err_abs_sum = ns.err_max = 0.0;
+    ns.frames = ns.dropped = ns.resyncs = 0;
+    ns.window_start_us = now;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "common.h"
+
+/*
+  Multi-node playback sync. One node (leader) serves its clock with a
+  GstNetTimeProvider; followers slave a GstNetClientClock to it. Every
+  node then presents the frame whose stream time matches the shared
+  timeline: position = (shared_now - sync_base) mod duration, so nodes
+  playing the same clip show the same frame without further messages.
+
+  MAPPER_SYNC=leader[:port] | follower:host[:port]   (default port 5637)
+
+  Several instances on one machine work too: start one leader and point
+  followers at 127.0.0.1 (with SDL_VIDEODRIVER=x11/wayland for windows).
+*/
+
+#define NETSYNC_DEFAULT_PORT 5637
+#define NETSYNC_REPORT_MS    5000
+
+// Beyond this a clip seeks instead of dropping/holding frames.
+#define NETSYNC_RESEEK_NS       ((gint64)(250 * GST_MSECOND))
+#define NETSYNC_RESEEK_LEAD_NS  ((gint64)(120 * GST_MSECOND))
+#define NETSYNC_RESEEK_MIN_US   2000000ull
+
+typedef enum { SYNC_OFF = 0, SYNC_LEADER, SYNC_FOLLOWER } SyncRole;
+
+/* Call after gst_init(). Returns 0 on a bad spec or socket failure (sync stays off). */
+int netsync_init(const char* spec);
+void netsync_shutdown(void);
+
+SyncRole netsync_role(void);
+
+/* True once the shared clock is usable (followers: after first calibration). */
+int netsync_active(void);
+
+/* Shared timeline in ns; GST_CLOCK_TIME_NONE when inactive. */
+GstClockTime netsync_now(void);
+
+/* Presented frame's stream time minus the shared target (signed ns). */
+void netsync_note_frame(gint64 error_ns, int dropped, int resynced);
+
+/* Once per presented frame: samples clock offset and logs every NETSYNC_REPORT_MS. */
+void netsync_tick(void);
@@ -0,0 +1,278 @@
+#include "osc.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define OSC_NTP_UNIX_OFFSET 2208988800ull   // 1900-01-01 -> 1970-01-01 in seconds
+#define OSC_MAX_DEPTH 4
+
+typedef struct {
+    GThread* thread;
+    int fd;
+    int stop_fd;
+    int stop_wr;
+    CmdChannel ch;
+    unsigned bad;       // malformed packets
+    unsigned unknown;   // well-formed, unmapped addresses
+} Osc;
+
+static Osc osc = { .fd = -1, .stop_fd = -1, .stop_wr = -1 };
+
+/* ================= In-place reader ================= */
+
+typedef struct {
+    const Uint8* p;
+    const Uint8* end;
+} Rd;
+
+static size_t pad4(size_t n) { return (n + 3) & ~(size_t)3; }
+
+static Uint32 be32(const Uint8* p)
+{
+    return ((Uint32)p[0] << 24) | ((Uint32)p[1] << 16) | ((Uint32)p[2] << 8) | p[3];
+}
+
+/* OSC string: NUL-terminated, padded to 4. Returns a pointer into the packet. */
+static const char* rd_string(Rd* r)
+{
+    const Uint8* s = r->p;
+    const Uint8* z = memchr(s, 0, (size_t)(r->end - s));
+    if (!z) return NULL;
+    size_t len = pad4((size_t)(z - s) + 1);
+    if ((size_t)(r->end - s) < len) return NULL;
+    r->p += len;
+    return (const char*)s;
+}
+
+static int rd_u32(Rd* r, Uint32* out)
+{
+    if (r->end - r->p < 4) return 0;
+    *out = be32(r->p);
+    r->p += 4;
+    return 1;
+}
+
+/* Next argument as a number (i or f); tags advances over the type tag. */
+static int rd_number(Rd* r, const char** tags, float* out)
+{
+    Uint32 raw;
+    char t = **tags;
+    if ((t != 'i' && t != 'f') || !rd_u32(r, &raw)) return 0;
+    (*tags)++;
+
+    if (t == 'i') {
+        *out = (float)(Sint32)raw;
+    } else {
+        union { Uint32 u; float f; } cv = { raw };
+        *out = cv.f;
+    }
+    return 1;
+}
+
+static const char* rd_str_arg(Rd* r, const char** tags)
+{
+    if (**tags != 's') return NULL;
+    (*tags)++;
+    return rd_string(r);
+}
+
+/* ================= Timetags ================= */
+
+/* NTP timetag -> monotonic microseconds; 0 for "immediately". */
+static Uint64 timetag_to_mono_us(Uint64 tt)
+{
+    if (tt <= 1) return 0;
+
+    Uint64 secs = tt >> 32;
+    if (secs < OSC_NTP_UNIX_OFFSET) return 0;
+    Uint64 frac_us = ((tt & 0xffffffffull) * 1000000ull) >> 32;
+    Uint64 unix_us = (secs - OSC_NTP_UNIX_OFFSET) * 1000000ull + frac_us;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    Uint64 now_unix_us = (Uint64)ts.tv_sec * 1000000ull + (Uint64)(ts.tv_nsec / 1000);
+    Uint64 now_mono_us = time_now_us();
+
+    if (unix_us <= now_unix_us) return 0;   // already due
+    return now_mono_us + (unix_us - now_unix_us);
+}
+
+/* ================= Dispatch ================= */
+
+static int handle_message(const Uint8* data, size_t len, Uint64 recv_us, Uint64 at_us)
+{
+    Rd r = { data, data + len };
+    const char* addr = rd_string(&r);
+    if (!addr || addr[0] != '/') return 0;
+
+    const char* tags = (r.p < r.end) ? rd_string(&r) : ",";
+    if (!tags || tags[0] != ',') return 0;
+    tags++;
+
+    Command c;
+    memset(&c, 0, sizeof(c));
+    c.recv_us = recv_us;
+    c.apply_at_us = at_us;
+
+    if (strncmp(addr, "/mapper/", 8) != 0) goto unknown;
+    const char* a = addr + 8;
+    float v;
+
+    if (strcmp(a, "transition") == 0) {
+        const char* path = rd_str_arg(&r, &tags);
+        if (!path) return 0;
+        c.type = CMD_TRANSITION;
+        snprintf(c.path, sizeof(c.path), "%s", path);
+        if (rd_number(&r, &tags, &v)) c.layer = (int)v;
+    } else if (strcmp(a, "random") == 0) {
+        c.type = CMD_RANDOM;
+    } else if (strcmp(a, "load") == 0) {
+        if (!rd_number(&r, &tags, &v)) return 0;
+        c.layer = (int)v;
+        const char* path = rd_str_arg(&r, &tags);
+        if (!path) return 0;
+        c.type = CMD_LOAD;
+        snprintf(c.path, sizeof(c.path), "%s", path);
+    } else if (strcmp(a, "xfade") == 0) {
+        if (!rd_number(&r, &tags, &c.f[0])) return 0;
+        c.type = CMD_SET_XFADE;
+    } else if (strncmp(a, "corner/", 7) == 0) {
+        c.index = cmd_corner_from_name(a + 7);
+        if (c.index < 0) goto unknown;
+        if (!rd_number(&r, &tags, &c.f[0]) || !rd_number(&r, &tags, &c.f[1])) return 0;
+        c.type = CMD_SET_CORNER;
+    } else if (strcmp(a, "opacity") == 0) {
+        if (!rd_number(&r, &tags, &v) || !rd_number(&r, &tags, &c.f[0])) return 0;
+        c.layer = (int)v;
+        c.type = CMD_SET_OPACITY;
+    } else {
+        goto unknown;
+    }
+
+    cmd_submit(&osc.ch, &c);
+    return 1;
+
+unknown:
+    osc.unknown++;
+    return 1;
+}
+
+static int handle_packet(const Uint8* data, size_t len, Uint64 recv_us, Uint64 at_us, int depth)
+{
+    if (len < 4 || (len & 3)) return 0;
+    if (data[0] != '#')
+        return handle_message(data, len, recv_us, at_us);
+
+    if (depth >= OSC_MAX_DEPTH || len < 16 || memcmp(data, "#bundle\0", 8) != 0) return 0;
+
+    Uint64 tt = ((Uint64)be32(data + 8) << 32) | be32(data + 12);
+    Uint64 bundle_at = timetag_to_mono_us(tt);
+    // A nested bundle never runs before its parent.
+    if (bundle_at < at_us) bundle_at = at_us;
+
+    Rd r = { data + 16, data + len };
+    while (r.p < r.end) {
+        Uint32 n;
+        if (!rd_u32(&r, &n) || n > (Uint32)(r.end - r.p)) return 0;
+        if (!handle_packet(r.p, n, recv_us, bundle_at, depth + 1)) return 0;
+        r.p += n;
+    }
+    return 1;
+}
+
+static gpointer osc_thread(gpointer data)
+{
+    (void)data;
+    static Uint8 buf[OSC_MAX_PACKET];
+    struct pollfd pfd[2] = {
+        { .fd = osc.stop_fd, .events = POLLIN },
+        { .fd = osc.fd, .events = POLLIN },
+    };
+
+    for (;;) {
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pfd[0].revents) break;
+        if (!(pfd[1].revents & POLLIN)) continue;
+
+        ssize_t n;
+        while ((n = recv(osc.fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+            Uint64 recv_us = time_now_us();
+            if (!handle_packet(buf, (size_t)n, recv_us, 0, 0))
+                osc.bad++;
+        }
+    }
+    return NULL;
+}
+
+/* ================= Lifecycle ================= */
+
+int osc_start(const char* spec)
+{
+    if (!spec || !spec[0] || strcmp(spec, "off") == 0 || strcmp(spec, "0") == 0)
+        return 1;
+
+    char host[64] = "0.0.0.0";
+    int port;
+    const char* colon = strrchr(spec, ':');
+    if (colon) {
+        snprintf(host, sizeof(host), "%.*s", (int)(colon - spec), spec);
+        port = atoi(colon + 1);
+    } else {
+        port = atoi(spec);
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (port <= 0 || inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        log_error("[OSC] bad MAPPER_OSC \"%s\" (port | addr:port)", spec);
+        return 0;
+    }
+
+    if (!cmd_channel_init(&osc.ch, "osc", STAGE_OSC_TO_FRAME)) goto fail;
+
+    int pipefd[2];
+    if (pipe(pipefd) != 0) goto fail;
+    osc.stop_fd = pipefd[0];
+    osc.stop_wr = pipefd[1];
+
+    osc.fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (osc.fd < 0 || bind(osc.fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) goto fail;
+
+    commands_register(&osc.ch);
+    osc.thread = g_thread_new("osc", osc_thread, NULL);
+
+    log_info("[OSC] listening on %s:%d", host, port);
+    return 1;
+
+fail:
+    log_error("[OSC] cannot listen on %s:%d: %s", host, port, strerror(errno));
+    osc_stop();
+    return 0;
+}
+
+void osc_stop(void)
+{
+    if (osc.thread) {
+        if (write(osc.stop_wr, "x", 1) < 0) { /* thread exits on close below */ }
+        g_thread_join(osc.thread);
+        osc.thread = NULL;
+        commands_unregister(&osc.ch);
+
+        log_info("[OSC] %u malformed packet(s), %u unmapped message(s), %u dropped command(s)",
+                 osc.bad, osc.unknown, atomic_load(&osc.ch.dropped));
+    }
+    if (osc.fd >= 0) close(osc.fd);
+    if (osc.stop_fd >= 0) close(osc.stop_fd);
+    if (osc.stop_wr >= 0) close(osc.stop_wr);
+    if (osc.ch.name) cmd_channel_destroy(&osc.ch);
+    osc.ch.name = NULL;
+    osc.fd = osc.stop_fd = osc.stop_wr = -1;
+}
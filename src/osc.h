@@ -0,0 +1,28 @@
+#pragma once
+#include "common.h"
+#include "commands.h"
+
+/*
+  OSC 1.0 server on UDP. A dedicated thread receives packets into a
+  fixed buffer and parses messages and (nested) bundles in place, with
+  no allocation; each recognised message becomes a Command on its own
+  channel. Bundle timetags are converted to the monotonic clock, and the
+  commands are applied on the frame presented at or after that time.
+  Immediate bundles and plain messages apply on the next frame.
+
+    /mapper/transition   s path [i layer]
+    /mapper/random
+    /mapper/load         i layer, s path
+    /mapper/xfade        f seconds
+    /mapper/corner/TL    f x, f y         (also TR, BL, BR)
+    /mapper/opacity      i layer, f value
+
+  Numeric arguments may be sent as i or f.
+
+  MAPPER_OSC=port | addr:port   (e.g. 8000 or 127.0.0.1:8000)
+*/
+
+#define OSC_MAX_PACKET 1536
+
+int  osc_start(const char* spec);
+void osc_stop(void);
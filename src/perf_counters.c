@@ -0,0 +1,117 @@
+#include "perf_counters.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+typedef struct {
+    int leader;                 // group fd, -1 when off
+    int fd[PERF_COUNT];
+    int slot[PERF_COUNT];       // position in the group read, -1 if unavailable
+    int n;
+} Perf;
+
+static Perf pf = { .leader = -1 };
+
+static const struct { Uint32 type; Uint64 config; const char* name; } EVENTS[PERF_COUNT] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,       "cycles" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,     "instructions" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,     "cache_misses" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, "ctx_switches" },
+};
+
+static int open_event(int i, int group)
+{
+    struct perf_event_attr a;
+    memset(&a, 0, sizeof(a));
+    a.size = sizeof(a);
+    a.type = EVENTS[i].type;
+    a.config = EVENTS[i].config;
+    a.disabled = (group < 0);       // the leader starts the whole group
+    a.exclude_kernel = 1;           // allowed at perf_event_paranoid=2
+    a.exclude_hv = 1;
+    a.read_format = PERF_FORMAT_GROUP;
+
+    // This thread, any CPU.
+    return (int)syscall(SYS_perf_event_open, &a, 0, -1, group, PERF_FLAG_FD_CLOEXEC);
+}
+
+int perf_init(void)
+{
+    if (!env_flag("MAPPER_PERF", 0)) return 0;
+
+    for (int i = 0; i < PERF_COUNT; i++) {
+        pf.fd[i] = -1;
+        pf.slot[i] = -1;
+    }
+
+    int err = 0;
+    for (int i = 0; i < PERF_COUNT; i++) {
+        int fd = open_event(i, pf.leader);
+        if (fd < 0) {
+            if (!err) err = errno;
+            continue;
+        }
+        if (pf.leader < 0) pf.leader = fd;
+        pf.fd[i] = fd;
+        pf.slot[i] = pf.n++;
+    }
+
+    if (pf.leader < 0) {
+        log_warn("[PERF] no counters available (%s); see /proc/sys/kernel/perf_event_paranoid",
+                 strerror(err));
+        return 0;
+    }
+
+    ioctl(pf.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(pf.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    char names[96] = "";
+    for (int i = 0; i < PERF_COUNT; i++)
+        if (pf.slot[i] >= 0)
+            snprintf(names + strlen(names), sizeof(names) - strlen(names), " %s", EVENTS[i].name);
+    log_info("[PERF] counting%s%s", names, pf.n < PERF_COUNT ? " (others unavailable)" : "");
+    return 1;
+}
+
+void perf_shutdown(void)
+{
+    for (int i = 0; i < PERF_COUNT; i++) {
+        if (pf.fd[i] >= 0 && pf.fd[i] != pf.leader) close(pf.fd[i]);
+        pf.fd[i] = -1;
+        pf.slot[i] = -1;
+    }
+    if (pf.leader >= 0) close(pf.leader);
+    pf.leader = -1;
+    pf.n = 0;
+}
+
+int perf_enabled(void)
+{
+    return pf.leader >= 0;
+}
+
+int perf_available(PerfCounter c)
+{
+    return pf.leader >= 0 && pf.slot[c] >= 0;
+}
+
+const char* perf_counter_name(PerfCounter c)
+{
+    return ((unsigned)c < PERF_COUNT) ? EVENTS[c].name : "?";
+}
+
+void perf_read(PerfSnap* s)
+{
+    memset(s, 0, sizeof(*s));
+    if (pf.leader < 0) return;
+
+    // PERF_FORMAT_GROUP: { nr, value[nr] } in the order the events joined.
+    Uint64 buf[1 + PERF_COUNT];
+    if (read(pf.leader, buf, sizeof(buf)) < (ssize_t)sizeof(Uint64)) return;
+
+    for (int i = 0; i < PERF_COUNT; i++)
+        if (pf.slot[i] >= 0 && (Uint64)pf.slot[i] < buf[0])
+            s->v[i] = buf[1 + pf.slot[i]];
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "common.h"
+
+/*
+  Optional CPU counters for the render thread (perf_event_open). Opened
+  as one group so a snapshot is a single read(). Counters the kernel
+  refuses (perf_event_paranoid, no PMU in a VM, ...) are left out and read
+  as 0; with none available the module stays off and costs nothing.
+
+  MAPPER_PERF=1 to enable.
+*/
+
+typedef enum {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_CTX_SWITCHES,
+    PERF_COUNT
+} PerfCounter;
+
+typedef struct {
+    Uint64 v[PERF_COUNT];
+} PerfSnap;
+
+/* Counts the calling thread from now on. Returns 1 if any counter opened. */
+int  perf_init(void);
+void perf_shutdown(void);
+
+int  perf_enabled(void);
+int  perf_available(PerfCounter c);
+const char* perf_counter_name(PerfCounter c);
+
+/* Current totals; all zero when disabled. */
+void perf_read(PerfSnap* s);
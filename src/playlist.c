@@ -41,6 +41,11 @@ static void playlist_add(Playlist* p, const char* fullpath)
     p->items[p->count++] = strdup(fullpath);
 }
 
+static int cmp_path(const void* a, const void* b)
+{
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
 int playlist_load_from_home_videos(Playlist* p, char* out_dir, size_t out_dir_sz)
 {
     memset(p, 0, sizeof(*p));
@@ -52,7 +57,7 @@ int playlist_load_from_home_videos(Playlist* p, char* out_dir, size_t out_dir_sz
 
     DIR* d = opendir(out_dir);
     if (!d) {
-        printf("Playlist: failed to open dir: %s\n", out_dir);
+        log_error("Playlist: failed to open dir: %s", out_dir);
         return 0;
     }
 
@@ -71,14 +76,17 @@ int playlist_load_from_home_videos(Playlist* p, char* out_dir, size_t out_dir_sz
     }
     closedir(d);
 
+    // Stable, predictable order for sequential (gapless) shows.
+    qsort(p->items, (size_t)p->count, sizeof(char*), cmp_path);
+
     if (p->count == 0) {
-        printf("Playlist: no videos found in %s\n", out_dir);
+        log_warn("Playlist: no videos found in %s", out_dir);
         return 0;
     }
 
-    printf("Playlist: loaded %d video(s) from %s\n", p->count, out_dir);
+    log_info("Playlist: loaded %d video(s) from %s", p->count, out_dir);
     for (int i = 0; i < p->count; i++) {
-        printf("  [%d] %s\n", i, p->items[i]);
+        log_debug("  [%d] %s", i, p->items[i]);
     }
     return 1;
 }
@@ -97,3 +105,27 @@ const char* playlist_random(const Playlist* p, const char* avoid_path)
     // fallback
     return p->items[rand() % p->count];
 }
+
+const char* playlist_next(const Playlist* p, const char* current)
+{
+    if (!p || p->count <= 0) return NULL;
+
+    // directory order; an unknown current restarts at the first entry
+    for (int i = 0; current && i < p->count; i++) {
+        if (strcmp(p->items[i], current) == 0)
+            return p->items[(i + 1) % p->count];
+    }
+    return p->items[0];
+}
+
+const char* playlist_find_name(const Playlist* p, const char* name)
+{
+    if (!p || !name || !name[0]) return NULL;
+
+    for (int i = 0; i < p->count; i++) {
+        const char* base = strrchr(p->items[i], '/');
+        base = base ? base + 1 : p->items[i];
+        if (strcmp(base, name) == 0) return p->items[i];
+    }
+    return NULL;
+}
@@ -10,3 +10,6 @@ typedef struct {
 void playlist_free(Playlist* p);
 int playlist_load_from_home_videos(Playlist* p, char* out_dir, size_t out_dir_sz);
 const char* playlist_random(const Playlist* p, const char* avoid_path);
+const char* playlist_next(const Playlist* p, const char* current);
+/* Entry whose file name (without directory) is `name`, or NULL. */
+const char* playlist_find_name(const Playlist* p, const char* name);
@@ -0,0 +1,167 @@
+#include "program_cache.h"
+#include "shaders.h"
+
+#include <GLES2/gl2ext.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#define PCACHE_MAGIC 0x31435050u  // "PPC1"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t format;
+    uint64_t key;
+    uint32_t length;
+    uint32_t reserved;
+} PCacheHeader;
+
+static PFNGLGETPROGRAMBINARYOESPROC p_glGetProgramBinaryOES = NULL;
+static PFNGLPROGRAMBINARYOESPROC    p_glProgramBinaryOES    = NULL;
+
+static int         g_supported = 0;
+static const char* g_dir = NULL;
+
+static uint64_t fnv1a64(uint64_t h, const char* s)
+{
+    if (!s) s = "";
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 0x100000001b3ull;
+    }
+    // separator so ("ab","c") and ("a","bc") hash differently
+    h ^= 0xff;
+    h *= 0x100000001b3ull;
+    return h;
+}
+
+void program_cache_init(void)
+{
+    g_dir = app_cache_dir();
+
+    const char* ext = (const char*)glGetString(GL_EXTENSIONS);
+    GLint nformats = 0;
+    if (ext && strstr(ext, "GL_OES_get_program_binary"))
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &nformats);
+
+    if (nformats > 0) {
+        p_glGetProgramBinaryOES =
+            (PFNGLGETPROGRAMBINARYOESPROC)SDL_GL_GetProcAddress("glGetProgramBinaryOES");
+        p_glProgramBinaryOES =
+            (PFNGLPROGRAMBINARYOESPROC)SDL_GL_GetProcAddress("glProgramBinaryOES");
+    }
+
+    g_supported = p_glGetProgramBinaryOES && p_glProgramBinaryOES && g_dir;
+
+    log_info("[PCACHE] %s (formats=%d, dir=%s)",
+             g_supported ? "enabled" : "disabled", nformats, g_dir ? g_dir : "(none)");
+}
+
+static uint64_t cache_key(const char* vs_src, const char* fs_src)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = fnv1a64(h, vs_src);
+    h = fnv1a64(h, fs_src);
+    h = fnv1a64(h, (const char*)glGetString(GL_VERSION));
+    h = fnv1a64(h, (const char*)glGetString(GL_RENDERER));
+    return h;
+}
+
+static void cache_path(char* out, size_t out_sz, const char* name, uint64_t key)
+{
+    snprintf(out, out_sz, "%s/%s-%016llx.bin", g_dir, name, (unsigned long long)key);
+}
+
+static GLuint try_load(const char* path, uint64_t key)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+
+    PCacheHeader hdr;
+    void* data = NULL;
+    GLuint prog = 0;
+
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1) goto out;
+    if (hdr.magic != PCACHE_MAGIC || hdr.key != key || hdr.length == 0) goto out;
+
+    data = malloc(hdr.length);
+    if (!data || fread(data, 1, hdr.length, f) != hdr.length) goto out;
+
+    prog = glCreateProgram();
+    p_glProgramBinaryOES(prog, hdr.format, data, (GLint)hdr.length);
+
+    GLint linked = 0;
+    glGetProgramiv(prog, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        glDeleteProgram(prog);
+        prog = 0;
+    }
+
+out:
+    free(data);
+    fclose(f);
+    return prog;
+}
+
+static void try_store(const char* path, uint64_t key, GLuint prog)
+{
+    GLint len = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH_OES, &len);
+    if (len <= 0) return;
+
+    void* data = malloc((size_t)len);
+    if (!data) return;
+
+    GLenum format = 0;
+    GLsizei got = 0;
+    p_glGetProgramBinaryOES(prog, len, &got, &format, data);
+    if (got <= 0) {
+        free(data);
+        return;
+    }
+
+    // Write to a temp file and rename so a crash never leaves a torn entry.
+    char tmp[600];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE* f = fopen(tmp, "wb");
+    if (f) {
+        PCacheHeader hdr = { PCACHE_MAGIC, format, key, (uint32_t)got, 0 };
+        int ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+                 fwrite(data, 1, (size_t)got, f) == (size_t)got;
+        ok = (fclose(f) == 0) && ok;
+        if (ok) rename(tmp, path);
+        else    unlink(tmp);
+    }
+    free(data);
+}
+
+GLuint program_cache_get(const char* name, const char* vs_src, const char* fs_src)
+{
+    Uint32 t0 = SDL_GetTicks();
+
+    uint64_t key = 0;
+    char path[600];
+
+    if (g_supported) {
+        key = cache_key(vs_src, fs_src);
+        cache_path(path, sizeof(path), name, key);
+
+        GLuint prog = try_load(path, key);
+        if (prog) {
+            log_info("[PCACHE] hit %s (%u ms)", name, SDL_GetTicks() - t0);
+            return prog;
+        }
+        // stale or rejected by the driver; it is rewritten below
+        unlink(path);
+    }
+
+    GLuint prog = build_program(vs_src, fs_src);
+    if (!prog) return 0;
+
+    if (g_supported)
+        try_store(path, key, prog);
+
+    log_info("[PCACHE] %s %s (%u ms)", g_supported ? "miss" : "compiled", name,
+             SDL_GetTicks() - t0);
+    return prog;
+}
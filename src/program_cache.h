@@ -0,0 +1,14 @@
+#pragma once
+#include "common.h"
+
+/*
+  On-disk cache of linked GL programs (GL_OES_get_program_binary).
+
+  Entries are keyed by a hash of both shader sources plus the GL_VERSION
+  and GL_RENDERER strings, so a driver update or a shader edit simply
+  misses. Without the extension, or when the driver rejects a stored
+  binary, programs are compiled from source as before.
+*/
+
+void   program_cache_init(void);
+GLuint program_cache_get(const char* name, const char* vs_src, const char* fs_src);
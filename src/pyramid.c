@@ -0,0 +1,265 @@
+#include "pyramid.h"
+#include "program_cache.h"
+#include "shaders.h"
+#include "stats.h"
+
+typedef struct {
+    int enabled;
+    GLuint prog;
+    GLuint vbo;
+    GLint aPos, aTex;
+    GLint uScale, uSize, uFirst, uDepth;
+    GLint uTexY, uTexU, uTexV, uPrev;
+} PyramidGL;
+
+static PyramidGL g;
+
+int pyramid_enabled(void)
+{
+    return g.enabled;
+}
+
+int pyramid_init(void)
+{
+    const char* e = getenv("MAPPER_PYRAMID");
+    if (!e || e[0] != '1') return 1;
+
+    g.prog = program_cache_get("pyramid", vertex_shader_src, pyramid_fragment_shader_src);
+    if (!g.prog) {
+        log_warn("[PYR] build program failed, minification pyramid off");
+        return 0;
+    }
+    g.aPos = glGetAttribLocation(g.prog, "aPos");
+    g.aTex = glGetAttribLocation(g.prog, "aTex");
+    g.uScale = glGetUniformLocation(g.prog, "uScale");
+    g.uSize = glGetUniformLocation(g.prog, "uSize");
+    g.uFirst = glGetUniformLocation(g.prog, "uFirst");
+    g.uDepth = glGetUniformLocation(g.prog, "uDepth");
+    g.uTexY = glGetUniformLocation(g.prog, "uTexY");
+    g.uTexU = glGetUniformLocation(g.prog, "uTexU");
+    g.uTexV = glGetUniformLocation(g.prog, "uTexV");
+    g.uPrev = glGetUniformLocation(g.prog, "uPrev");
+    if (g.aPos < 0 || g.aTex < 0) {
+        log_warn("[PYR] build program attributes missing, minification pyramid off");
+        return 0;
+    }
+
+    // One quad over the viewport; uScale maps it onto the source.
+    static const float quad[] = {
+        -1.f, -1.f, 0.f, 0.f,
+         1.f, -1.f, 1.f, 0.f,
+        -1.f,  1.f, 0.f, 1.f,
+         1.f,  1.f, 1.f, 1.f,
+    };
+    glGenBuffers(1, &g.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, g.vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+    g.enabled = 1;
+    log_info("[PYR] minification pyramid on, up to %d levels", PYR_MAX_LEVELS);
+    return 1;
+}
+
+void pyramid_shutdown(void)
+{
+    if (g.vbo) glDeleteBuffers(1, &g.vbo);
+    if (g.prog) glDeleteProgram(g.prog);
+    memset(&g, 0, sizeof(g));
+}
+
+/* ================= Warp ================= */
+
+int pyramid_levels_needed(const float H[9], int dw, int dh, float tw, float th)
+{
+    // A homography's local scale peaks at the quad's corners; the midpoints are cheap insurance.
+    // Squared throughout: texels^2 per pixel^2.
+    float worst = 0.0f;
+    for (int j = 0; j <= 2; j++) {
+        for (int i = 0; i <= 2; i++) {
+            float u = 0.5f * (float)i;
+            float v = 0.5f * (float)j;
+            float w = H[6] * u + H[7] * v + H[8];
+            if (w == 0.0f) continue;
+            float x = (H[0] * u + H[1] * v + H[2]) / w;
+            float y = (H[3] * u + H[4] * v + H[5]) / w;
+
+            float dux = (H[0] - H[6] * x) / w * (float)dw * 0.5f;
+            float duy = (H[3] - H[6] * y) / w * (float)dh * 0.5f;
+            float dvx = (H[1] - H[7] * x) / w * (float)dw * 0.5f;
+            float dvy = (H[4] - H[7] * y) / w * (float)dh * 0.5f;
+
+            float pu = dux * dux + duy * duy;
+            float pv = dvx * dvx + dvy * dvy;
+            if (pu > 0.0f && tw * tw / pu > worst) worst = tw * tw / pu;
+            if (pv > 0.0f && th * th / pv > worst) worst = th * th / pv;
+        }
+    }
+    if (worst <= PYR_MIN_SCALE * PYR_MIN_SCALE) return 0;
+
+    // ceil(log2(scale)): level k covers up to 2^k texels per pixel.
+    int k = 0;
+    while (worst > 1.0f && k < PYR_MAX_LEVELS) {
+        worst *= 0.25f;
+        k++;
+    }
+    return k;
+}
+
+/* ================= Build ================= */
+
+/* Level k's place in the atlas (x, y, w, h); mirrored by pyr_level in the layer shader. */
+static void level_rect(const VideoPyramid* p, int k, int r[4])
+{
+    r[0] = (k > 1) ? p->w1 : 0;
+    r[1] = 0;
+    for (int j = 2; j < k; j++)
+        r[1] += p->h1 >> (j - 1);
+    r[2] = p->w1 >> (k - 1);
+    r[3] = p->h1 >> (k - 1);
+}
+
+static GLuint new_rgba_tex(int w, int h)
+{
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    return tex;
+}
+
+static int alloc_pyramid(VideoPyramid* p, int w1, int h1)
+{
+    int wanted = p->wanted;
+    pyramid_free(p);
+    p->wanted = wanted;
+    p->w1 = w1;
+    p->h1 = h1;
+
+    // LUMINANCE isn't colour-renderable in GLES2: levels are RGBA (Y, U, V, 1).
+    p->atlas = new_rgba_tex(w1 + w1 / 2, h1);
+    p->scratch = new_rgba_tex(w1, h1);
+
+    glGenFramebuffers(1, &p->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, p->fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, p->atlas, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        log_warn("[PYR] atlas %dx%d not renderable (0x%x)", w1 + w1 / 2, h1, status);
+        pyramid_free(p);
+        p->wanted = wanted;
+        return 0;
+    }
+    return 1;
+}
+
+static void bind_unit(int unit, GLuint tex, GLint loc)
+{
+    glActiveTexture(GL_TEXTURE0 + (GLenum)unit);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glUniform1i(loc, unit);
+}
+
+/* Level 1 from the planes, then each level from a scratch copy of the one before. */
+static size_t build_levels(const Video* v, VideoPyramid* p, int levels)
+{
+    int tw = v->width >> v->upload_shift;
+    int th = v->height >> v->upload_shift;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, p->fbo);
+    glDisable(GL_BLEND);
+    glUseProgram(g.prog);
+    glBindBuffer(GL_ARRAY_BUFFER, g.vbo);
+    glEnableVertexAttribArray((GLuint)g.aPos);
+    glVertexAttribPointer((GLuint)g.aPos, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray((GLuint)g.aTex);
+    glVertexAttribPointer((GLuint)g.aTex, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float),
+                          (void*)(2 * sizeof(float)));
+
+    bind_unit(0, v->texY, g.uTexY);
+    bind_unit(1, v->texU, g.uTexU);
+    bind_unit(2, v->texV, g.uTexV);
+    bind_unit(3, p->scratch, g.uPrev);
+    glUniform1i(g.uDepth, (int)v->depth);
+    float sz[4];
+    video_plane_size(v, sz);
+    glUniform4f(g.uSize, sz[0], sz[1], sz[2], sz[3]);
+
+    size_t bytes = 0;
+    int r[4], prev[4];
+    for (int k = 1; k <= levels; k++) {
+        level_rect(p, k, r);
+        if (k == 1) {
+            glUniform1i(g.uFirst, 1);
+            glUniform2f(g.uScale, 2.0f * r[2] / tw, 2.0f * r[3] / th);
+        } else {
+            // Sampling the atlas while it's the render target is undefined: go through scratch.
+            glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, prev[0], prev[1], prev[2], prev[3]);
+            glUniform1i(g.uFirst, 0);
+            glUniform2f(g.uScale, 2.0f * r[2] / p->w1, 2.0f * r[3] / p->h1);
+            bytes += (size_t)prev[2] * (size_t)prev[3] * 4;
+        }
+        glViewport(r[0], r[1], r[2], r[3]);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        bytes += (size_t)r[2] * (size_t)r[3] * 4;
+        memcpy(prev, r, sizeof(r));
+    }
+
+    glDisableVertexAttribArray((GLuint)g.aPos);
+    glDisableVertexAttribArray((GLuint)g.aTex);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return bytes;
+}
+
+int pyramid_update(Video* v, int levels)
+{
+    VideoPyramid* p = &v->pyr;
+    if (!g.enabled || !v->tex_inited) return 0;
+
+    int w1 = (v->width >> v->upload_shift) / 2;
+    int h1 = (v->height >> v->upload_shift) / 2;
+    while (levels > 0 && ((w1 >> (levels - 1)) < 1 || (h1 >> (levels - 1)) < 1))
+        levels--;
+
+    if (levels != p->wanted) {
+        if (levels)
+            log_info("[PYR] warp minifies %s: %d level(s) from %dx%d", v->path, levels, w1, h1);
+        else if (p->wanted)
+            log_info("[PYR] warp no longer minifies %s: pyramid off", v->path);
+        p->wanted = levels;
+    }
+    // No minification: give the atlas, scratch and FBO back (wanted is 0 too).
+    if (!levels) {
+        pyramid_free(p);
+        return 0;
+    }
+
+    // Only a new frame (or a deeper warp) needs new levels.
+    if (p->atlas && p->w1 == w1 && p->h1 == h1 && p->frame == v->frames.uploaded && p->levels >= levels)
+        return p->levels;
+    if ((!p->atlas || p->w1 != w1 || p->h1 != h1) && !alloc_pyramid(p, w1, h1)) {
+        p->levels = 0;
+        return 0;
+    }
+
+    StageMark m;
+    stats_stage_begin(&m);
+    size_t bytes = build_levels(v, p, levels);
+    stats_stage_end(STAGE_PYRAMID, &m, bytes);
+
+    p->levels = levels;
+    p->frame = v->frames.uploaded;
+    return levels;
+}
+
+void pyramid_free(VideoPyramid* p)
+{
+    if (p->fbo) glDeleteFramebuffers(1, &p->fbo);
+    if (p->atlas) glDeleteTextures(1, &p->atlas);
+    if (p->scratch) glDeleteTextures(1, &p->scratch);
+    memset(p, 0, sizeof(*p));
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "common.h"
+#include "video.h"
+
+/*
+  Minification pyramid (MAPPER_PYRAMID=1).
+
+  When the warp pulls a clip in so that it covers less screen than it has
+  texels, plain GL_LINEAR sampling of the planes aliases (fine text
+  shimmers). With the pyramid on, each layer that the warp minifies gets
+  up to PYR_MAX_LEVELS half-size steps of its Y/U/V planes, rendered with
+  FBO passes into one RGBA atlas per source. Levels are built only when a
+  new frame has been uploaded, and only down to the level the warp's
+  Jacobian asks for at its most minified point. The layer shader works out
+  the level per fragment from the same Jacobian and blends between levels.
+
+  Layers the warp doesn't shrink by more than PYR_MIN_SCALE are left alone
+  and cost nothing. Transitions and the blend cadence draw without it (their
+  programs have no texture units to spare). Render thread only.
+*/
+
+#define PYR_MAX_LEVELS 4      // down to 1/16
+#define PYR_MIN_SCALE  1.1f   // texels per pixel below which nothing is built
+
+int  pyramid_init(void);
+int  pyramid_enabled(void);
+
+/* Levels the warp H needs for tw x th texels per unit of mesh on a dw x dh viewport (0 = no minification). */
+int  pyramid_levels_needed(const float H[9], int dw, int dh, float tw, float th);
+
+/* Builds v's levels for its newest frame (only when it's new); returns the levels usable. Leaves the viewport changed. */
+int  pyramid_update(Video* v, int levels);
+
+void pyramid_free(VideoPyramid* p);
+void pyramid_shutdown(void);
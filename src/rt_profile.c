@@ -0,0 +1,163 @@
+#define _GNU_SOURCE
+#include "rt_profile.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+typedef enum { RT_OFF = 0, RT_NICE_ONLY, RT_FIFO } RtMode;
+
+typedef struct {
+    RtMode mode;
+    int render_cpu;         // -1: no pinning (single core)
+    cpu_set_t render_set;
+    cpu_set_t others_set;
+    Uint32 frames;
+    int locked;
+} RtProfile;
+
+static RtProfile rt = { .render_cpu = -1 };
+
+void rt_init(void)
+{
+    const char* m = getenv("MAPPER_RT");
+    if (!m || !m[0] || strcmp(m, "off") == 0 || strcmp(m, "0") == 0) return;
+    rt.mode = (strcmp(m, "nice") == 0) ? RT_NICE_ONLY : RT_FIFO;
+
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    const char* c = getenv("MAPPER_RT_CPU");
+    int cpu = (c && c[0]) ? atoi(c) : (int)ncpu - 1;
+    if (ncpu < 2 || cpu < 0 || cpu >= ncpu) {
+        log_warn("[RT] %ld CPU(s), render core %d: not pinning", ncpu, cpu);
+        return;
+    }
+
+    rt.render_cpu = cpu;
+    CPU_ZERO(&rt.render_set);
+    CPU_ZERO(&rt.others_set);
+    CPU_SET(cpu, &rt.render_set);
+    for (int i = 0; i < ncpu; i++)
+        if (i != cpu) CPU_SET(i, &rt.others_set);
+}
+
+/* ================= Streaming threads ================= */
+
+static GstBusSyncReply on_sync_message(GstBus* bus, GstMessage* msg, gpointer user)
+{
+    (void)bus;
+    (void)user;
+    if (GST_MESSAGE_TYPE(msg) != GST_MESSAGE_STREAM_STATUS)
+        return GST_BUS_PASS;
+
+    // Posted from the streaming thread itself as it enters its loop.
+    GstStreamStatusType type;
+    GstElement* owner = NULL;
+    gst_message_parse_stream_status(msg, &type, &owner);
+    if (type != GST_STREAM_STATUS_TYPE_ENTER)
+        return GST_BUS_PASS;
+
+    // Started from the render thread, so it inherited its FIFO class or nice value.
+    struct sched_param sp = { .sched_priority = 0 };
+    int err = pthread_setschedparam(pthread_self(), SCHED_OTHER, &sp);
+    if (err || setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 0) != 0)
+        log_ratelimited(LL_WARN, "[RT] cannot reset streaming thread priority: %s",
+                        strerror(err ? err : errno));
+
+    if (rt.render_cpu < 0)
+        return GST_BUS_PASS;
+
+    err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &rt.others_set);
+    if (err)
+        log_ratelimited(LL_WARN, "[RT] cannot pin streaming thread: %s", strerror(err));
+    else
+        log_debug("[RT] streaming thread of %s off core %d",
+                  owner ? GST_ELEMENT_NAME(owner) : "?", rt.render_cpu);
+    return GST_BUS_PASS;
+}
+
+void rt_watch_bus(GstBus* bus)
+{
+    // Pooled pipelines come back with their bus; a second handler is refused.
+    if (!bus || rt.mode == RT_OFF || g_object_get_data(G_OBJECT(bus), "mapper-rt"))
+        return;
+    g_object_set_data(G_OBJECT(bus), "mapper-rt", GINT_TO_POINTER(1));
+    gst_bus_set_sync_handler(bus, on_sync_message, NULL, NULL);
+}
+
+/* ================= Render thread ================= */
+
+void rt_enter_render_thread(void)
+{
+    if (rt.mode == RT_OFF) return;
+
+    char how[64] = "normal priority";
+    int fifo = 0;
+    if (rt.mode == RT_FIFO) {
+        struct sched_param sp = { .sched_priority = RT_FIFO_PRIORITY };
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        if (err == 0) {
+            fifo = 1;
+            snprintf(how, sizeof(how), "SCHED_FIFO %d", RT_FIFO_PRIORITY);
+        } else {
+            log_warn("[RT] SCHED_FIFO refused (%s), falling back to nice", strerror(err));
+        }
+    }
+    if (!fifo) {
+        // Per-thread on Linux: the tid is a valid PRIO_PROCESS target.
+        if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), RT_NICE) == 0)
+            snprintf(how, sizeof(how), "nice %d", RT_NICE);
+        else
+            log_warn("[RT] cannot raise priority: %s", strerror(errno));
+    }
+
+    if (rt.render_cpu >= 0) {
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &rt.render_set);
+        if (err) {
+            log_warn("[RT] cannot pin render thread: %s", strerror(err));
+            rt.render_cpu = -1;
+        }
+    }
+
+    if (rt.render_cpu >= 0)
+        log_info("[RT] render thread %s on core %d, streaming threads on the others", how, rt.render_cpu);
+    else
+        log_info("[RT] render thread %s, unpinned", how);
+}
+
+/* ================= Decoder processes ================= */
+
+void rt_enter_decoder_process(void)
+{
+    rt_init();
+    if (rt.mode == RT_OFF) return;
+
+    // Spawned from the render thread: its nice value and core came along.
+    if (setpriority(PRIO_PROCESS, 0, 0) != 0)
+        log_warn("[RT] decoder %d: cannot reset nice: %s", (int)getpid(), strerror(errno));
+    if (rt.render_cpu >= 0 && sched_setaffinity(0, sizeof(cpu_set_t), &rt.others_set) != 0)
+        log_warn("[RT] decoder %d: cannot leave core %d: %s", (int)getpid(), rt.render_cpu,
+                 strerror(errno));
+}
+
+void rt_frame_end(void)
+{
+    if (rt.mode == RT_OFF || rt.locked || ++rt.frames < RT_WARMUP_FRAMES)
+        return;
+    rt.locked = 1;
+
+    // ONFAULT locks pages as they are touched, so new thread stacks aren't populated up front.
+#ifdef MCL_ONFAULT
+    int ok = mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) == 0 ||
+             mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+#else
+    int ok = mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+#endif
+    if (ok)
+        log_info("[RT] memory locked after %u frames", rt.frames);
+    else
+        log_warn("[RT] mlockall failed: %s (raise RLIMIT_MEMLOCK or run with CAP_IPC_LOCK)",
+                 strerror(errno));
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "common.h"
+
+/*
+  Real-time profile. The render thread gets SCHED_FIFO, or a high nice
+  value when the FIFO class is not allowed, and is pinned to its own core.
+  GStreamer streaming threads are dropped back to normal priority and
+  moved to the other cores as they start.
+  They report themselves with STREAM_STATUS on each pipeline bus and are
+  caught in a sync handler. Memory is locked once the first clips are
+  running, so later page-ins can't stall a frame.
+
+  MAPPER_RT=off | nice | fifo       (default off)
+  MAPPER_RT_CPU=n                   render core (default: the last one)
+*/
+
+#define RT_FIFO_PRIORITY 50
+#define RT_NICE -10
+#define RT_WARMUP_FRAMES 300    // frames before mlockall
+
+/* Early in main(), before any pipeline starts. */
+void rt_init(void);
+
+/* Every pipeline bus, so streaming threads are re-pinned when they (re)start. */
+void rt_watch_bus(GstBus* bus);
+
+/* From the render thread, right before the main loop. */
+void rt_enter_render_thread(void);
+
+/* First thing in a --decoder child: normal nice value, off the render core.
+   The scheduling class is reset by the parent at spawn. */
+void rt_enter_decoder_process(void);
+
+/* Once per presented frame; locks memory after RT_WARMUP_FRAMES. */
+void rt_frame_end(void);
@@ -1,4 +1,5 @@
 #include "shaders.h"
+#include "log.h"
 
 #include <stdio.h>
 #include <GLES2/gl2.h>
@@ -14,12 +15,37 @@ GLuint compile_shader(GLenum type, const char* src)
     if (!ok) {
         char log[1024];
         glGetShaderInfoLog(shader, sizeof(log), NULL, log);
-        fprintf(stderr, "Shader compile error: %s\n", log);
-        fflush(stderr);
+        log_error("Shader compile error: %s", log);
     }
     return shader;
 }
 
+GLuint build_program(const char* vs_src, const char* fs_src)
+{
+    GLuint vs = compile_shader(GL_VERTEX_SHADER, vs_src);
+    GLuint fs = compile_shader(GL_FRAGMENT_SHADER, fs_src);
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+
+    // The program keeps what it needs; shaders are only flagged for deletion.
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        log_error("Program link error: %s", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
 const char* vertex_shader_src =
     "attribute vec2 aPos;"
     "attribute vec2 aTex;"
@@ -29,36 +55,404 @@ const char* vertex_shader_src =
     "  gl_Position = vec4(aPos, 0.0, 1.0);"
     "}";
 
-const char* fragment_shader_src =
-    "precision mediump float;"
+/* GLSL pieces shared by the layer and transition programs. */
+#define YUV_TO_RGB_GLSL \
+    "vec3 yuv_to_rgb(float y, float u, float v, int range, int bt709) {" \
+    "  float Y = (range==1) ? (1.1643 * (y - 0.0625)) : y;" \
+    "  float R; float G; float B;" \
+    "  if (bt709==1) {" \
+    "    R = Y + 1.7927 * v;" \
+    "    G = Y - 0.2132 * u - 0.5329 * v;" \
+    "    B = Y + 2.1124 * u;" \
+    "  } else {" \
+    "    R = Y + 1.4020 * v;" \
+    "    G = Y - 0.3441 * u - 0.7141 * v;" \
+    "    B = Y + 1.7720 * u;" \
+    "  }" \
+    "  return clamp(vec3(R, G, B), 0.0, 1.0);" \
+    "}"
+
+/* Texel addressing wants highp where the GPU has it: mediump can't address 1080 rows. */
+#define HIGHP_GLSL \
+    "\n#ifdef GL_FRAGMENT_PRECISION_HIGH\n#define ROWP highp\n#else\n#define ROWP mediump\n#endif\n"
+
+/*
+   Sample depth (VideoDepth): 0 8-bit luminance, 1 I420_10LE and 2 P010
+   split across luminance (low byte) and alpha (high byte), P010 chroma as
+   RGBA = U lo, U hi, V lo, V hi. The constants fold the byte weights and
+   the 10-bit scale together so nothing overflows mediump. Split bytes
+   can't be filtered by the hardware (their textures are GL_NEAREST), so
+   10-bit planes are filtered here: four taps unpacked, then mixed
+   bilinearly. size = (luma width, height, chroma width, height) in
+   texels as uploaded. 10-bit output is dithered by half an 8-bit step
+   (interleaved gradient noise) to hide the banding the framebuffer would
+   otherwise add back.
+*/
+#define DEPTH_GLSL \
+    "float unpack10(vec2 lh, int depth) {" \
+    "  return (depth == 2) ? lh.y * 0.99611 + lh.x * 0.003891" \
+    "                      : lh.y * 63.812 + lh.x * 0.24927;" \
+    "}" \
+    "vec2 unpack_tap(vec4 s, int depth, bool pair) {" \
+    "  return pair ? vec2(unpack10(s.rg, 2), unpack10(s.ba, 2)) : vec2(unpack10(s.ra, depth), 0.0);" \
+    "}" \
+    "vec2 bilinear10(sampler2D t, vec2 tc, int depth, bool pair, ROWP vec2 size) {" \
+    "  ROWP vec2 p = tc * size - 0.5;" \
+    "  ROWP vec2 i = floor(p);" \
+    "  vec2 f = p - i;" \
+    "  ROWP vec2 t0 = (i + 0.5) / size;" \
+    "  ROWP vec2 d = 1.0 / size;" \
+    "  vec2 a = mix(unpack_tap(texture2D(t, t0), depth, pair)," \
+    "               unpack_tap(texture2D(t, t0 + vec2(d.x, 0.0)), depth, pair), f.x);" \
+    "  vec2 b = mix(unpack_tap(texture2D(t, t0 + vec2(0.0, d.y)), depth, pair)," \
+    "               unpack_tap(texture2D(t, t0 + d), depth, pair), f.x);" \
+    "  return mix(a, b, f.y);" \
+    "}" \
+    "float sample_y(sampler2D t, vec2 tc, int depth, vec4 size) {" \
+    "  return (depth == 0) ? texture2D(t, tc).r : bilinear10(t, tc, depth, false, size.xy).x;" \
+    "}" \
+    "vec2 sample_uv(sampler2D tu, sampler2D tv, vec2 tc, int depth, vec4 size) {" \
+    "  if (depth == 0) return vec2(texture2D(tu, tc).r, texture2D(tv, tc).r) - 0.5;" \
+    "  if (depth == 2) return bilinear10(tu, tc, 2, true, size.zw) - 0.5;" \
+    "  return vec2(bilinear10(tu, tc, 1, false, size.zw).x, bilinear10(tv, tc, 1, false, size.zw).x) - 0.5;" \
+    "}" \
+    "vec3 dither(vec3 c, int depth) {" \
+    "  if (depth == 0) return c;" \
+    "  vec2 p = mod(gl_FragCoord.xy, 64.0);" \
+    "  float n = fract(52.9829189 * fract(dot(p, vec2(0.06711056, 0.00583715)))) - 0.5;" \
+    "  return clamp(c + n / 255.0, 0.0, 1.0);" \
+    "}"
+
+/*
+   Field-aware sampling of one interlaced frame (video.h, DeinterlaceMode).
+   di = (mode 0 off / 1 bob / 2 adaptive, field parity 0 top / 1 bottom,
+   luma rows). Rows are addressed at their centres, luma and 4:2:0 chroma
+   each in their own row grid, so no tap mixes the two fields. Bob blends
+   the field's lines above and below; adaptive also reads the other field's
+   line between them and weaves it in unless it stands out from both (combing).
+*/
+#define DEINTERLACE_GLSL \
+    "vec3 fetch_yuv(sampler2D ty, sampler2D tu, sampler2D tv, float x, ROWP vec2 y, int depth, vec4 sz) {" \
+    "  return vec3(sample_y(ty, vec2(x, y.x), depth, sz), sample_uv(tu, tv, vec2(x, y.y), depth, sz));" \
+    "}" \
+    "vec3 field_yuv(sampler2D ty, sampler2D tu, sampler2D tv, vec2 tc, int depth, vec4 sz, vec3 di) {" \
+    "  if (di.x < 0.5) return fetch_yuv(ty, tu, tv, tc.x, tc.yy, depth, sz);" \
+    "  ROWP vec2 rows = vec2(di.z, di.z * 0.5);" \
+    "  ROWP vec2 r = tc.y * rows - 0.5;" \
+    "  ROWP vec2 r0 = floor((r - di.y) * 0.5) * 2.0 + di.y;" \
+    "  vec2 t = r - r0;" \
+    "  vec3 a = fetch_yuv(ty, tu, tv, tc.x, (r0 + 0.5) / rows, depth, sz);" \
+    "  vec3 b = fetch_yuv(ty, tu, tv, tc.x, (r0 + 2.5) / rows, depth, sz);" \
+    "  vec3 w = vec3(t.x, t.y, t.y);" \
+    "  vec3 bob = mix(a, b, w * 0.5);" \
+    "  if (di.x < 1.5) return bob;" \
+    "  vec3 c = fetch_yuv(ty, tu, tv, tc.x, (r0 + 1.5) / rows, depth, sz);" \
+    "  vec3 weave = mix(mix(a, c, clamp(w, 0.0, 1.0)), b, clamp(w - 1.0, 0.0, 1.0));" \
+    "  float comb = abs(c.x - 0.5 * (a.x + b.x));" \
+    "  return mix(weave, bob, smoothstep(0.02, 0.08, comb));" \
+    "}"
+
+/*
+   Minification pyramid (pyramid.h): levels 1..n of a layer's Y/U/V in one
+   RGBA atlas, level 1 on the left, 2, 3, 4 stacked to its right. ps =
+   (level 1 width, height, 1 / atlas width, height); pl = (source texels
+   per unit of vTex along u and v, levels built). The level of detail comes
+   from the warp's Jacobian at this fragment: d(pixels)/d(u, v) of the
+   homography uWarp (rows of H) scaled by uHalfView.
+*/
+#define PYRAMID_GLSL \
+    "float pyr_lod(vec2 texels) {" \
+    "  ROWP vec3 p = vec3(vTex, 1.0);" \
+    "  ROWP float w = dot(uWarp[2], p);" \
+    "  ROWP vec2 xy = vec2(dot(uWarp[0], p), dot(uWarp[1], p)) / w;" \
+    "  ROWP vec2 du = (vec2(uWarp[0].x, uWarp[1].x) - uWarp[2].x * xy) / w * uHalfView;" \
+    "  ROWP vec2 dv = (vec2(uWarp[0].y, uWarp[1].y) - uWarp[2].y * xy) / w * uHalfView;" \
+    "  return log2(max(texels.x / max(length(du), 1e-4), texels.y / max(length(dv), 1e-4)));" \
+    "}" \
+    "vec4 pyr_level(sampler2D t, vec2 tc, float k, vec4 s) {" \
+    "  ROWP vec2 size = floor(s.xy / exp2(k - 1.0));" \
+    "  ROWP vec2 o = vec2((k > 1.5) ? s.x : 0.0, 0.0);" \
+    "  if (k > 2.5) o.y += floor(s.y * 0.5);" \
+    "  if (k > 3.5) o.y += floor(s.y * 0.25);" \
+    "  ROWP vec2 px = o + clamp(tc * size, vec2(0.5), size - 0.5);" \
+    "  return texture2D(t, px * s.zw);" \
+    "}" \
+    "vec3 pyr_yuv(sampler2D t, vec2 tc, float lod, vec4 s, float levels) {" \
+    "  float k = clamp(floor(lod), 1.0, levels);" \
+    "  vec4 c = pyr_level(t, tc, k, s);" \
+    "  if (k < levels) c = mix(c, pyr_level(t, tc, k + 1.0, s), clamp(lod - k, 0.0, 1.0));" \
+    "  return c.rgb - vec3(0.0, 0.5, 0.5);" \
+    "}"
+
+#define APPLY_OP_GLSL \
+    "void apply_op(int mode, vec3 c, float a, inout vec3 S, inout vec3 F) {" \
+    "  vec3 s; vec3 f;" \
+    "  if (mode == 1)      { s = a * c;    f = vec3(1.0); }" \
+    "  else if (mode == 2) { s = vec3(0.0); f = vec3(1.0 - a) + a * c; }" \
+    "  else if (mode == 3) { s = a * c;    f = vec3(1.0) - a * c; }" \
+    "  else                { s = a * c;    f = vec3(1.0 - a); }" \
+    "  S = s + f * S;" \
+    "  F = f * F;" \
+    "}"
+
+#define OUTPUT_GLSL \
+    "  if (uOutput == 0)      gl_FragColor = vec4(S, 1.0);" \
+    "  else if (uOutput == 1) gl_FragColor = vec4(S, 1.0 - F.r);" \
+    "  else if (uOutput == 2) gl_FragColor = vec4(S, 1.0);" \
+    "  else                   gl_FragColor = vec4(F, 1.0);"
+
+/*
+   Layer compositing shader; prefixed with "#define LAYERS 1|2" at build.
+   Every layer is reduced to out = S + F * dst (per channel), and stacked
+   layers compose as S = S1 + F1*S0, F = F1*F0. uOutput selects how the
+   pass result is handed to fixed-function blending:
+     0: opaque over the cleared (black) framebuffer    blend off
+     1: scalar F (normal/add): rgb = S, a = 1 - F      ONE, ONE_MINUS_SRC_ALPHA
+     2: screen: rgb = S (= 1 - F)                      ONE, ONE_MINUS_SRC_COLOR
+     3: multiply: rgb = F                              ZERO, SRC_COLOR
+*/
+const char* layer_fragment_shader_src =
+    "precision mediump float;\n"
+    "varying vec2 vTex;"
+    "uniform int uOutput;"
+
+    "uniform sampler2D uTexY0;"
+    "uniform sampler2D uTexU0;"
+    "uniform sampler2D uTexV0;"
+    "uniform sampler2D uTexA0;"
+    "uniform int uAlphaMode0;"
+    "uniform int uVideoRange0;"
+    "uniform int uBT7090;"
+    "uniform int uDepth0;"
+    "uniform vec4 uSize0;"
+    "uniform vec3 uDeint0;"
+    "\n#if PYRAMID\n"
+    "uniform sampler2D uPyr0;"
+    "uniform vec4 uPyrSize0;"
+    "uniform vec3 uPyrScale0;"
+    "\n#endif\n"
+    "uniform int uMode0;"
+    "uniform float uAlpha0;"
+    "uniform vec4 uRect0;\n"
+
+    "#if LAYERS > 1\n"
+    "uniform sampler2D uTexY1;"
+    "uniform sampler2D uTexU1;"
+    "uniform sampler2D uTexV1;"
+    "uniform sampler2D uTexA1;"
+    "uniform int uAlphaMode1;"
+    "uniform int uVideoRange1;"
+    "uniform int uBT7091;"
+    "uniform int uDepth1;"
+    "uniform vec4 uSize1;"
+    "uniform vec3 uDeint1;"
+    "\n#if PYRAMID\n"
+    "uniform sampler2D uPyr1;"
+    "uniform vec4 uPyrSize1;"
+    "uniform vec3 uPyrScale1;"
+    "\n#endif\n"
+    "uniform int uMode1;"
+    "uniform float uAlpha1;"
+    "uniform vec4 uRect1;\n"
+    "#endif\n"
+
+    "#if PYRAMID\n"
+    "uniform mat3 uWarp;"
+    "uniform vec2 uHalfView;\n"
+    "#endif\n"
+
+    YUV_TO_RGB_GLSL
+    HIGHP_GLSL
+    DEPTH_GLSL
+    DEINTERLACE_GLSL
+    "\n#if PYRAMID\n"
+    PYRAMID_GLSL
+    "\n#endif\n"
+
+    // amode: 0 opaque, 1 alpha plane in ta, 2 alpha as luma in the right half
+    "vec3 sample_layer(sampler2D ty, sampler2D tu, sampler2D tv, sampler2D ta, int amode,"
+    "                  int range, int bt709, int depth, vec4 sz, vec3 di,\n"
+    "#if PYRAMID\n"
+    "                  sampler2D tp, vec4 ps, vec3 pl,\n"
+    "#endif\n"
+    "                  vec4 rect, float alpha, out float a) {"
+    "  vec2 lt = (vTex - rect.xy) / rect.zw;"
+    "  a = alpha * step(0.0, lt.x) * step(lt.x, 1.0) * step(0.0, lt.y) * step(lt.y, 1.0);"
+    "  vec2 tc = vec2(lt.x, 1.0 - lt.y);"
+    "  if (amode == 1) {"
+    "    a *= texture2D(ta, tc).r;"
+    "  } else if (amode == 2) {"
+    "    float m = sample_y(ty, vec2(0.5 + 0.5 * tc.x, tc.y), depth, sz);"
+    "    a *= (range==1) ? clamp(1.1643 * (m - 0.0625), 0.0, 1.0) : m;"
+    "    tc.x *= 0.5;"
+    "  }"
+    "  vec3 yuv = field_yuv(ty, tu, tv, tc, depth, sz, di);\n"
+    // Trilinear: full resolution blends into level 1 over lod 0..1, then level to level.
+    "#if PYRAMID\n"
+    "  float lod = (pl.z > 0.0) ? pyr_lod(pl.xy) : 0.0;"
+    "  if (lod > 0.0) yuv = mix(yuv, pyr_yuv(tp, tc, lod, ps, pl.z), min(lod, 1.0));\n"
+    "#endif\n"
+    "  return dither(yuv_to_rgb(yuv.x, yuv.y, yuv.z, range, bt709), depth);"
+    "}"
+
+    APPLY_OP_GLSL
+
+    "void main(){"
+    "  vec3 S = vec3(0.0);"
+    "  vec3 F = vec3(1.0);"
+    "  float a;"
+    "  vec3 c0 = sample_layer(uTexY0, uTexU0, uTexV0, uTexA0, uAlphaMode0, uVideoRange0, uBT7090, uDepth0, uSize0, uDeint0,\n"
+    "#if PYRAMID\n"
+    "                        uPyr0, uPyrSize0, uPyrScale0,\n"
+    "#endif\n"
+    "                        uRect0, uAlpha0, a);"
+    "  apply_op(uMode0, c0, a, S, F);\n"
+    "#if LAYERS > 1\n"
+    "  vec3 c1 = sample_layer(uTexY1, uTexU1, uTexV1, uTexA1, uAlphaMode1, uVideoRange1, uBT7091, uDepth1, uSize1, uDeint1,\n"
+    "#if PYRAMID\n"
+    "                        uPyr1, uPyrSize1, uPyrScale1,\n"
+    "#endif\n"
+    "                        uRect1, uAlpha1, a);"
+    "  apply_op(uMode1, c1, a, S, F);\n"
+    "#endif\n"
+    OUTPUT_GLSL
+    "}";
+
+/*
+   Single-layer transition shader: one pass mixes a layer's outgoing (A)
+   and incoming (B) clip, then composites like the layer shader. Prefixed
+   with "#define TRANSITION n" at build (see TransitionKind); uProgress is
+   already eased on the CPU. The fade variant mixes two frames of one clip
+   for the blend cadence (video.h). A420 plane alpha is not sampled here (units).
+*/
+const char* transition_fragment_shader_src =
+    "precision mediump float;\n"
     "varying vec2 vTex;"
+    "uniform int uOutput;"
+    "uniform int uMode;"
+    "uniform float uAlpha;"
+    "uniform vec4 uRect;"
+    "uniform float uProgress;"
+    "uniform float uSoftness;"
+    "uniform sampler2D uMask;"
+
+    "uniform sampler2D uTexYA;"
+    "uniform sampler2D uTexUA;"
+    "uniform sampler2D uTexVA;"
+    "uniform int uAlphaModeA;"
+    "uniform int uVideoRangeA;"
+    "uniform int uBT709A;"
+    "uniform int uDepthA;"
+    "uniform vec4 uSizeA;"
+    "uniform vec3 uDeintA;"
+
+    "uniform sampler2D uTexYB;"
+    "uniform sampler2D uTexUB;"
+    "uniform sampler2D uTexVB;"
+    "uniform int uAlphaModeB;"
+    "uniform int uVideoRangeB;"
+    "uniform int uBT709B;"
+    "uniform int uDepthB;"
+    "uniform vec4 uSizeB;"
+    "uniform vec3 uDeintB;"
+
+    YUV_TO_RGB_GLSL
+    HIGHP_GLSL
+    DEPTH_GLSL
+    DEINTERLACE_GLSL
+
+    // tc in clip space (0..1, top-left origin); a = 0 outside the clip.
+    "vec3 sample_video(sampler2D ty, sampler2D tu, sampler2D tv, int amode,"
+    "                  int range, int bt709, int depth, vec4 sz, vec3 di, vec2 tc, out float a) {"
+    "  a = step(0.0, tc.x) * step(tc.x, 1.0) * step(0.0, tc.y) * step(tc.y, 1.0);"
+    "  if (amode == 2) {"
+    "    float m = sample_y(ty, vec2(0.5 + 0.5 * tc.x, tc.y), depth, sz);"
+    "    a *= (range==1) ? clamp(1.1643 * (m - 0.0625), 0.0, 1.0) : m;"
+    "    tc.x *= 0.5;"
+    "  }"
+    "  vec3 yuv = field_yuv(ty, tu, tv, tc, depth, sz, di);"
+    "  return dither(yuv_to_rgb(yuv.x, yuv.y, yuv.z, range, bt709), depth);"
+    "}"
+
+    APPLY_OP_GLSL
+
+    "void main(){"
+    "  vec2 lt = (vTex - uRect.xy) / uRect.zw;"
+    "  float inside = step(0.0, lt.x) * step(lt.x, 1.0) * step(0.0, lt.y) * step(lt.y, 1.0);"
+    "  vec2 tc = vec2(lt.x, 1.0 - lt.y);"
+    "  float p = uProgress;"
+    "  float s = uSoftness;"
+    "  vec2 tcA = tc;"
+    "  vec2 tcB = tc;"
+    "  float k;\n"
+    "#if TRANSITION == 1\n"   // wipe, left to right with a soft edge
+    "  float e = p * (1.0 + s);"
+    "  k = 1.0 - smoothstep(e - s, e, tc.x);\n"
+    "#elif TRANSITION == 2\n" // luma key: dark mask areas switch first
+    "  float m = texture2D(uMask, tc).r;"
+    "  k = smoothstep(m, m + s, p * (1.0 + s));\n"
+    "#elif TRANSITION == 3\n" // push: B slides in from the right, A out to the left
+    "  tcA.x = tc.x + p;"
+    "  tcB.x = tc.x + p - 1.0;"
+    "  k = step(1.0 - p, tc.x);\n"
+    "#elif TRANSITION == 0\n" // plain mix: blend cadence (previous frame A, newest B)
+    "  k = p;\n"
+    "#else\n"                 // zoom: A scales up from the centre while B fades in
+    "  tcA = vec2(0.5) + (tc - vec2(0.5)) / (1.0 + p);"
+    "  k = p;\n"
+    "#endif\n"
+    "  float aA; float aB;"
+    "  vec3 cA = sample_video(uTexYA, uTexUA, uTexVA, uAlphaModeA, uVideoRangeA, uBT709A, uDepthA, uSizeA, uDeintA, tcA, aA);"
+    "  vec3 cB = sample_video(uTexYB, uTexUB, uTexVB, uAlphaModeB, uVideoRangeB, uBT709B, uDepthB, uSizeB, uDeintB, tcB, aB);"
+    "  vec3 pm = mix(cA * aA, cB * aB, k);"
+    "  float a = mix(aA, aB, k);"
+    "  vec3 c = (a > 0.0) ? pm / a : vec3(0.0);"
+    "  vec3 S = vec3(0.0);"
+    "  vec3 F = vec3(1.0);"
+    "  apply_op(uMode, c, a * uAlpha * inside, S, F);"
+    OUTPUT_GLSL
+    "}";
+
+/*
+   Pyramid build pass (pyramid.h). uFirst: level 1 straight from the
+   planes (uSize as in DEPTH_GLSL), 2x2 luma texels averaged per output
+   and chroma 1:1; otherwise one bilinear tap in
+   the middle of each 2x2 block of the previous level. Output is
+   (Y, U, V, 1) in 8 bits.
+*/
+const char* pyramid_fragment_shader_src =
+    "precision mediump float;\n"
+    "varying vec2 vTex;"
+    "uniform vec2 uScale;"
+    "uniform vec4 uSize;"
+    "uniform int uFirst;"
+    "uniform int uDepth;"
     "uniform sampler2D uTexY;"
     "uniform sampler2D uTexU;"
     "uniform sampler2D uTexV;"
-    "uniform int uVideoRange;"
-    "uniform int uBT709;"
-    "uniform float uAlpha;"
+    "uniform sampler2D uPrev;"
 
-    "vec3 yuv_to_rgb(float y, float u, float v) {"
-    "  float Y = (uVideoRange==1) ? (1.1643 * (y - 0.0625)) : y;"
-    "  float R; float G; float B;"
-    "  if (uBT709==1) {"
-    "    R = Y + 1.7927 * v;"
-    "    G = Y - 0.2132 * u - 0.5329 * v;"
-    "    B = Y + 2.1124 * u;"
-    "  } else {"
-    "    R = Y + 1.4020 * v;"
-    "    G = Y - 0.3441 * u - 0.7141 * v;"
-    "    B = Y + 1.7720 * u;"
+    HIGHP_GLSL
+    DEPTH_GLSL
+
+    "void main(){"
+    "  ROWP vec2 tc = vTex * uScale;"
+    "  if (uFirst == 0) {"
+    "    gl_FragColor = texture2D(uPrev, tc);"
+    "    return;"
     "  }"
-    "  return vec3(R, G, B);"
-    "}"
+    "  ROWP vec2 h = 0.5 / uSize.xy;"
+    "  float y = 0.25 * (sample_y(uTexY, tc + vec2(-h.x, -h.y), uDepth, uSize) +"
+    "                    sample_y(uTexY, tc + vec2( h.x, -h.y), uDepth, uSize) +"
+    "                    sample_y(uTexY, tc + vec2(-h.x,  h.y), uDepth, uSize) +"
+    "                    sample_y(uTexY, tc + vec2( h.x,  h.y), uDepth, uSize));"
+    "  gl_FragColor = vec4(y, sample_uv(uTexU, uTexV, tc, uDepth, uSize) + 0.5, 1.0);"
+    "}";
 
+const char* splash_fragment_shader_src =
+    "precision mediump float;"
+    "varying vec2 vTex;"
+    "uniform sampler2D uTex;"
     "void main(){"
-    "  vec2 tc = vec2(vTex.x, 1.0 - vTex.y);"
-    "  float y = texture2D(uTexY, tc).r;"
-    "  float u = texture2D(uTexU, tc).r - 0.5;"
-    "  float v = texture2D(uTexV, tc).r - 0.5;"
-    "  vec3 rgb = clamp(yuv_to_rgb(y, u, v), 0.0, 1.0);"
-    "  gl_FragColor = vec4(rgb, uAlpha);"
+    "  gl_FragColor = vec4(texture2D(uTex, vTex).rgb, 1.0);"
     "}";
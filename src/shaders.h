@@ -2,6 +2,12 @@
 #include <GLES2/gl2.h>
 
 extern const char* vertex_shader_src;
-extern const char* fragment_shader_src;
+extern const char* layer_fragment_shader_src;
+extern const char* transition_fragment_shader_src;
+extern const char* pyramid_fragment_shader_src;
+extern const char* splash_fragment_shader_src;
 
 GLuint compile_shader(GLenum type, const char* src);
+
+/* Compile + link; returns 0 on link failure. Shaders are released after link. */
+GLuint build_program(const char* vs_src, const char* fs_src);
@@ -0,0 +1,169 @@
+#include "splash.h"
+#include "program_cache.h"
+#include "shaders.h"
+
+#include <stdint.h>
+#include <unistd.h>
+
+#define SPLASH_MAGIC  0x31505053u  // "SPP1"
+#define SPLASH_SCALE  4            // box-downscale factor on capture
+
+typedef struct {
+    uint32_t magic;
+    uint32_t w;
+    uint32_t h;
+} SplashHeader;
+
+static void splash_path(char* out, size_t out_sz, const char* dir)
+{
+    snprintf(out, out_sz, "%s/last_frame.rgb", dir);
+}
+
+int splash_load(Splash* s)
+{
+    memset(s, 0, sizeof(*s));
+
+    const char* dir = app_cache_dir();
+    if (!dir) return 0;
+
+    char path[600];
+    splash_path(path, sizeof(path), dir);
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+
+    SplashHeader hdr;
+    guint8* rgb = NULL;
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != SPLASH_MAGIC ||
+        hdr.w == 0 || hdr.h == 0 || hdr.w > 4096 || hdr.h > 4096)
+        goto fail;
+
+    size_t sz = (size_t)hdr.w * hdr.h * 3;
+    rgb = (guint8*)malloc(sz);
+    if (!rgb || fread(rgb, 1, sz, f) != sz)
+        goto fail;
+    fclose(f);
+    f = NULL;
+
+    s->prog = program_cache_get("splash", vertex_shader_src, splash_fragment_shader_src);
+    if (!s->prog)
+        goto fail;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glGenTextures(1, &s->tex);
+    glBindTexture(GL_TEXTURE_2D, s->tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, (GLsizei)hdr.w, (GLsizei)hdr.h, 0,
+                 GL_RGB, GL_UNSIGNED_BYTE, rgb);
+    free(rgb);
+
+    // Fullscreen quad: the capture is already in screen space (post-warp).
+    static const float quad[] = {
+        -1.f, -1.f, 0.f, 0.f,
+         1.f, -1.f, 1.f, 0.f,
+        -1.f,  1.f, 0.f, 1.f,
+         1.f,  1.f, 1.f, 1.f,
+    };
+    glGenBuffers(1, &s->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, s->vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+    s->loaded = 1;
+    return 1;
+
+fail:
+    if (f) fclose(f);
+    free(rgb);
+    splash_free(s);
+    return 0;
+}
+
+void splash_draw(const Splash* s)
+{
+    if (!s->loaded) return;
+
+    GLint aPos = glGetAttribLocation(s->prog, "aPos");
+    GLint aTex = glGetAttribLocation(s->prog, "aTex");
+    if (aPos < 0 || aTex < 0) return;
+
+    glUseProgram(s->prog);
+    glBindBuffer(GL_ARRAY_BUFFER, s->vbo);
+    glEnableVertexAttribArray((GLuint)aPos);
+    glVertexAttribPointer((GLuint)aPos, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray((GLuint)aTex);
+    glVertexAttribPointer((GLuint)aTex, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float),
+                          (void*)(2 * sizeof(float)));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, s->tex);
+    glUniform1i(glGetUniformLocation(s->prog, "uTex"), 0);
+
+    glDisable(GL_BLEND);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void splash_free(Splash* s)
+{
+    if (s->tex)  glDeleteTextures(1, &s->tex);
+    if (s->vbo)  glDeleteBuffers(1, &s->vbo);
+    if (s->prog) glDeleteProgram(s->prog);
+    memset(s, 0, sizeof(*s));
+}
+
+void splash_capture(int w, int h)
+{
+    const char* dir = app_cache_dir();
+    if (!dir || w < SPLASH_SCALE || h < SPLASH_SCALE) return;
+
+    guint8* rgba = (guint8*)malloc((size_t)w * h * 4);
+    if (!rgba) return;
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+
+    int ow = w / SPLASH_SCALE;
+    int oh = h / SPLASH_SCALE;
+    guint8* rgb = (guint8*)malloc((size_t)ow * oh * 3);
+    if (!rgb) {
+        free(rgba);
+        return;
+    }
+
+    for (int y = 0; y < oh; y++) {
+        for (int x = 0; x < ow; x++) {
+            unsigned acc[3] = { 0, 0, 0 };
+            for (int sy = 0; sy < SPLASH_SCALE; sy++) {
+                const guint8* row = rgba + ((size_t)(y * SPLASH_SCALE + sy) * w + x * SPLASH_SCALE) * 4;
+                for (int sx = 0; sx < SPLASH_SCALE; sx++) {
+                    acc[0] += row[sx * 4 + 0];
+                    acc[1] += row[sx * 4 + 1];
+                    acc[2] += row[sx * 4 + 2];
+                }
+            }
+            guint8* o = rgb + ((size_t)y * ow + x) * 3;
+            for (int c = 0; c < 3; c++)
+                o[c] = (guint8)(acc[c] / (SPLASH_SCALE * SPLASH_SCALE));
+        }
+    }
+    free(rgba);
+
+    char path[600], tmp[640];
+    splash_path(path, sizeof(path), dir);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE* f = fopen(tmp, "wb");
+    if (f) {
+        SplashHeader hdr = { SPLASH_MAGIC, (uint32_t)ow, (uint32_t)oh };
+        size_t sz = (size_t)ow * oh * 3;
+        int ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 && fwrite(rgb, 1, sz, f) == sz;
+        ok = (fclose(f) == 0) && ok;
+        if (ok) rename(tmp, path);
+        else    unlink(tmp);
+    }
+    free(rgb);
+
+    log_info("[SPLASH] stored last frame %dx%d", ow, oh);
+}
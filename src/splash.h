@@ -0,0 +1,21 @@
+#pragma once
+#include "common.h"
+
+/*
+  Last-frame splash: the final composited frame of the previous run is
+  stored (downscaled RGB) in the cache dir and shown right after the GL
+  context comes up, before the first pipeline has decoded anything.
+*/
+typedef struct {
+    GLuint prog;
+    GLuint tex;
+    GLuint vbo;
+    int loaded;
+} Splash;
+
+int  splash_load(Splash* s);
+void splash_draw(const Splash* s);
+void splash_free(Splash* s);
+
+/* Reads back the current draw buffer (call before swapping). */
+void splash_capture(int w, int h);
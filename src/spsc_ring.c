@@ -0,0 +1,33 @@
+#include "spsc_ring.h"
+#include <string.h>
+
+void spsc_init(SpscRing* r, void* storage, size_t elem, unsigned capacity)
+{
+    r->slots = (unsigned char*)storage;
+    r->elem = elem;
+    r->mask = capacity - 1;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+}
+
+int spsc_push(SpscRing* r, const void* item)
+{
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head - tail > r->mask) return 0;
+
+    memcpy(r->slots + (size_t)(head & r->mask) * r->elem, item, r->elem);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return 1;
+}
+
+int spsc_pop(SpscRing* r, void* out)
+{
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (tail == head) return 0;
+
+    memcpy(out, r->slots + (size_t)(tail & r->mask) * r->elem, r->elem);
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return 1;
+}
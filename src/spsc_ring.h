@@ -0,0 +1,24 @@
+#pragma once
+#include <stdatomic.h>
+#include <stddef.h>
+
+/*
+  Lock-free single-producer/single-consumer ring of fixed-size elements.
+  One thread pushes, one thread pops; neither ever blocks. Capacity must
+  be a power of two. Storage is supplied by the caller.
+*/
+typedef struct {
+    unsigned char* slots;
+    size_t elem;
+    unsigned mask;
+    atomic_uint head;   // next slot to write (producer)
+    atomic_uint tail;   // next slot to read (consumer)
+} SpscRing;
+
+void spsc_init(SpscRing* r, void* storage, size_t elem, unsigned capacity);
+
+/* Returns 0 when full (the element is not queued). */
+int spsc_push(SpscRing* r, const void* item);
+
+/* Returns 0 when empty. */
+int spsc_pop(SpscRing* r, void* out);
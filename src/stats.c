@@ -0,0 +1,171 @@
+#include "stats.h"
+#include "metrics.h"
+
+typedef struct {
+    Uint64 us;
+    Uint64 max_us;
+    Uint64 bytes;
+    Uint32 calls;
+    Uint64 perf[PERF_COUNT];
+} StageAcc;
+
+typedef struct {
+    StageAcc stage[STAGE_COUNT];
+    Uint32 frames;
+    Uint64 frame_max_us;
+    double secs;
+} Window;
+
+static Window cur;
+static Window last;
+static Uint64 window_start_us;
+static Uint64 last_frame_us;
+
+const char* stats_stage_name(StatStage s)
+{
+    switch (s) {
+    case STAGE_VE_UPDATE:    return "ve_update";
+    case STAGE_UPLOAD_YUV:   return "upload_yuv";
+    case STAGE_UPLOAD_ALPHA: return "upload_alpha";
+    case STAGE_DRAW:         return "draw";
+    case STAGE_CMD_TO_FRAME: return "cmd_to_frame";
+    case STAGE_OSC_TO_FRAME: return "osc_to_frame";
+    case STAGE_DPROC_COPY:   return "dproc_copy";
+    case STAGE_DPROC_RECV:   return "dproc_recv";
+    case STAGE_PYRAMID:      return "pyramid";
+    default:                 return "?";
+    }
+}
+
+void stats_stage_add(StatStage s, Uint64 t0_us, size_t bytes)
+{
+    if ((unsigned)s >= STAGE_COUNT) return;
+    StageAcc* a = &cur.stage[s];
+    Uint64 d = time_now_us() - t0_us;
+    a->us += d;
+    if (d > a->max_us) a->max_us = d;
+    a->bytes += bytes;
+    a->calls++;
+}
+
+void stats_stage_begin(StageMark* m)
+{
+    perf_read(&m->perf);
+    m->t_us = time_now_us();
+}
+
+void stats_stage_end(StatStage s, const StageMark* m, size_t bytes)
+{
+    stats_stage_add(s, m->t_us, bytes);
+    if (!perf_enabled() || (unsigned)s >= STAGE_COUNT) return;
+
+    PerfSnap now;
+    perf_read(&now);
+    for (int i = 0; i < PERF_COUNT; i++)
+        cur.stage[s].perf[i] += now.v[i] - m->perf.v[i];
+}
+
+static int has_perf(const StageAcc* a)
+{
+    for (int i = 0; i < PERF_COUNT; i++)
+        if (a->perf[i]) return 1;
+    return 0;
+}
+
+/* Counters as per-second rates over the window; "" when none were collected. */
+static void format_perf(const StageAcc* a, double secs, char* buf, size_t n)
+{
+    buf[0] = '\0';
+    if (!has_perf(a) || secs <= 0.0) return;
+
+    size_t off = 0;
+    if (perf_available(PERF_CYCLES))
+        off += snprintf(buf + off, n - off, " %.1f Mcyc/s", a->perf[PERF_CYCLES] / secs / 1e6);
+    if (perf_available(PERF_INSTRUCTIONS) && a->perf[PERF_CYCLES] && off < n)
+        off += snprintf(buf + off, n - off, " IPC %.2f", (double)a->perf[PERF_INSTRUCTIONS] / a->perf[PERF_CYCLES]);
+    if (perf_available(PERF_CACHE_MISSES) && off < n)
+        off += snprintf(buf + off, n - off, " %.1fk miss/s", a->perf[PERF_CACHE_MISSES] / secs / 1e3);
+    if (perf_available(PERF_CTX_SWITCHES) && off < n)
+        snprintf(buf + off, n - off, " %.1f cs/s", a->perf[PERF_CTX_SWITCHES] / secs);
+}
+
+void stats_frame_end(void)
+{
+    Uint64 now = time_now_us();
+    if (window_start_us == 0)
+        window_start_us = now;
+    if (last_frame_us) {
+        if (now - last_frame_us > cur.frame_max_us)
+            cur.frame_max_us = now - last_frame_us;
+        metrics_observe_us(H_FRAME_TIME, now - last_frame_us);
+    }
+    last_frame_us = now;
+    cur.frames++;
+    metrics_add(M_FRAMES_PRESENTED, 1);
+
+    Uint64 span = now - window_start_us;
+    if (span < (Uint64)STATS_PERIOD_MS * 1000ull)
+        return;
+
+    cur.secs = span / 1e6;
+    log_info("[STATS] %.1f fps, worst frame %.2f ms",
+             cur.frames / cur.secs, cur.frame_max_us / 1000.0);
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const StageAcc* a = &cur.stage[i];
+        if (!a->calls) continue;
+        char perf[96];
+        format_perf(a, cur.secs, perf, sizeof(perf));
+        log_info("[STATS] %-12s %6.3f ms/call (max %6.3f) %6.3f ms/frame %5u calls %7.2f MB/s%s",
+                 stats_stage_name((StatStage)i),
+                 a->us / 1000.0 / a->calls,
+                 a->max_us / 1000.0,
+                 a->us / 1000.0 / cur.frames,
+                 a->calls,
+                 a->bytes / cur.secs / (1024.0 * 1024.0),
+                 perf);
+    }
+
+    last = cur;
+    memset(&cur, 0, sizeof(cur));
+    window_start_us = now;
+}
+
+int stats_format_json(char* buf, size_t n)
+{
+    size_t off = 0;
+    int w = snprintf(buf, n, "{\"window_s\":%.2f,\"fps\":%.2f,\"worst_frame_ms\":%.3f,\"stages\":{",
+                     last.secs, last.secs > 0.0 ? last.frames / last.secs : 0.0,
+                     last.frame_max_us / 1000.0);
+    if (w < 0 || (size_t)w >= n) return 0;
+    off = (size_t)w;
+
+    int first = 1;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const StageAcc* a = &last.stage[i];
+        if (!a->calls) continue;
+        w = snprintf(buf + off, n - off, "%s\"%s\":{\"calls\":%u,\"avg_ms\":%.3f,\"max_ms\":%.3f",
+                     first ? "" : ",", stats_stage_name((StatStage)i), a->calls,
+                     a->us / 1000.0 / a->calls, a->max_us / 1000.0);
+        if (w < 0 || (size_t)w >= n - off) return 0;
+        off += (size_t)w;
+        first = 0;
+
+        // Counters per second, only for stages that collected them.
+        for (int k = 0; k < PERF_COUNT && has_perf(a) && last.secs > 0.0; k++) {
+            if (!perf_available((PerfCounter)k))
+                continue;
+            w = snprintf(buf + off, n - off, ",\"%s_per_s\":%.0f",
+                         perf_counter_name((PerfCounter)k), a->perf[k] / last.secs);
+            if (w < 0 || (size_t)w >= n - off) return 0;
+            off += (size_t)w;
+        }
+
+        if (off + 1 >= n) return 0;
+        buf[off++] = '}';
+        buf[off] = '\0';
+    }
+
+    w = snprintf(buf + off, n - off, "}}");
+    if (w < 0 || (size_t)w >= n - off) return 0;
+    return (int)(off + (size_t)w);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "common.h"
+#include "perf_counters.h"
+
+/*
+  Render-thread stage timers. Each stage accumulates wall time, call count
+  and bytes moved; stats_frame_end() prints one line per stage every
+  STATS_PERIOD_MS and starts a new window. The last finished window is
+  kept for the control API. With perf counters enabled (perf_counters.h),
+  stages timed with stats_stage_begin/end also collect CPU counters.
+*/
+
+#define STATS_PERIOD_MS 5000
+
+typedef enum {
+    STAGE_VE_UPDATE = 0,    // bus polling, sample pulls and uploads for all layers
+    STAGE_UPLOAD_YUV,       // Y/U/V planes -> textures
+    STAGE_UPLOAD_ALPHA,     // A420 alpha plane -> texture
+    STAGE_DRAW,             // compositor draw submission
+    STAGE_CMD_TO_FRAME,     // control command received -> first frame swapped after it
+    STAGE_OSC_TO_FRAME,     // OSC packet received -> first frame swapped after it
+    STAGE_DPROC_COPY,       // isolated decoder: child copies a frame into the ring
+    STAGE_DPROC_RECV,       // isolated decoder: render thread takes a ready slot
+    STAGE_PYRAMID,          // minification pyramid build passes; bytes = texels rendered and copied
+    STAGE_COUNT
+} StatStage;
+
+const char* stats_stage_name(StatStage s);
+
+/* Call around a stage: t0 = time_now_us() before, stats_stage_add after. */
+void stats_stage_add(StatStage s, Uint64 t0_us, size_t bytes);
+
+/* Same, plus CPU counters when enabled (render thread). */
+typedef struct {
+    Uint64 t_us;
+    PerfSnap perf;
+} StageMark;
+
+void stats_stage_begin(StageMark* m);
+void stats_stage_end(StatStage s, const StageMark* m, size_t bytes);
+
+/* Once per presented frame. */
+void stats_frame_end(void);
+
+/* Last finished window as a JSON object (render thread). Returns bytes written. */
+int stats_format_json(char* buf, size_t n);
@@ -0,0 +1,125 @@
+#include "transitions.h"
+
+#define MASK_FALLBACK_SIZE 32   // upscaled by linear filtering
+
+TransitionKind transition_from_string(const char* s)
+{
+    if (!s) return TRANS_FADE;
+    for (int k = 0; k < TRANS_COUNT; k++)
+        if (strcmp(s, transition_name((TransitionKind)k)) == 0) return (TransitionKind)k;
+    return TRANS_FADE;
+}
+
+const char* transition_name(TransitionKind k)
+{
+    switch (k) {
+    case TRANS_WIPE: return "wipe";
+    case TRANS_LUMA: return "luma";
+    case TRANS_PUSH: return "push";
+    case TRANS_ZOOM: return "zoom";
+    default:         return "fade";
+    }
+}
+
+Easing easing_from_string(const char* s)
+{
+    if (!s) return EASE_LINEAR;
+    if (strcmp(s, "in") == 0) return EASE_IN;
+    if (strcmp(s, "out") == 0) return EASE_OUT;
+    if (strcmp(s, "inout") == 0) return EASE_IN_OUT;
+    return EASE_LINEAR;
+}
+
+const char* easing_name(Easing e)
+{
+    switch (e) { case EASE_IN: return "in"; case EASE_OUT: return "out"; case EASE_IN_OUT: return "inout"; default: return "linear"; }
+}
+
+float ease(Easing e, float t)
+{
+    if (t <= 0.0f) return 0.0f;
+    if (t >= 1.0f) return 1.0f;
+
+    switch (e) {
+    case EASE_IN:     return t * t;
+    case EASE_OUT:    return t * (2.0f - t);
+    case EASE_IN_OUT: return t * t * (3.0f - 2.0f * t);
+    default:          return t;
+    }
+}
+
+static GLuint upload_mask(const Uint8* pixels, int w, int h)
+{
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, w, h, 0,
+                 GL_LUMINANCE, GL_UNSIGNED_BYTE, pixels);
+    return tex;
+}
+
+static GLuint load_bmp_mask(const char* path)
+{
+    SDL_Surface* src = SDL_LoadBMP(path);
+    if (!src) {
+        log_warn("[TRANS] mask %s: %s", path, SDL_GetError());
+        return 0;
+    }
+
+    SDL_Surface* rgb = SDL_ConvertSurfaceFormat(src, SDL_PIXELFORMAT_RGB24, 0);
+    SDL_FreeSurface(src);
+    if (!rgb) return 0;
+
+    int w = rgb->w, h = rgb->h;
+    Uint8* luma = (Uint8*)malloc((size_t)w * (size_t)h);
+    if (!luma) {
+        SDL_FreeSurface(rgb);
+        return 0;
+    }
+
+    SDL_LockSurface(rgb);
+    for (int y = 0; y < h; y++) {
+        const Uint8* row = (const Uint8*)rgb->pixels + (size_t)y * (size_t)rgb->pitch;
+        for (int x = 0; x < w; x++) {
+            const Uint8* px = row + x * 3;
+            luma[(size_t)y * w + x] = (Uint8)((px[0] * 77 + px[1] * 150 + px[2] * 29) >> 8);
+        }
+    }
+    SDL_UnlockSurface(rgb);
+    SDL_FreeSurface(rgb);
+
+    GLuint tex = upload_mask(luma, w, h);
+    free(luma);
+
+    log_info("[TRANS] luma mask %s (%dx%d)", path, w, h);
+    return tex;
+}
+
+GLuint transition_load_mask(const char* bmp_path)
+{
+    if (bmp_path && bmp_path[0]) {
+        GLuint tex = load_bmp_mask(bmp_path);
+        if (tex) return tex;
+    }
+
+    // Diagonal gradient plus hashed noise so the default dissolve isn't just a wipe.
+    static Uint8 grad[MASK_FALLBACK_SIZE * MASK_FALLBACK_SIZE];
+    const int n = MASK_FALLBACK_SIZE;
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            Uint32 hsh = ((Uint32)x * 73856093u) ^ ((Uint32)y * 19349663u);
+            hsh ^= hsh >> 13;
+            hsh *= 0x5bd1e995u;
+            float r = ((hsh >> 24) / 255.0f - 0.5f) * 0.3f;
+            float d = (x + y) / (2.0f * (n - 1));
+            float v = d * 0.7f + 0.15f + r;
+            grad[y * n + x] = (Uint8)(255.0f * (v < 0.0f ? 0.0f : v > 1.0f ? 1.0f : v));
+        }
+    }
+    return upload_mask(grad, n, n);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "common.h"
+
+/*
+  Layer transition styles. FADE is drawn by the regular layer programs
+  (two sources in one pass); every other kind has its own single-pass
+  program, built at startup (or loaded from the program cache) so that
+  starting a transition never compiles anything.
+*/
+typedef enum {
+    TRANS_FADE = 0,
+    TRANS_WIPE,      // soft edge sweeping left to right
+    TRANS_LUMA,      // luma-key dissolve through a greyscale mask
+    TRANS_PUSH,      // incoming clip pushes the outgoing one out to the left
+    TRANS_ZOOM,      // outgoing clip zooms in while the incoming fades up
+    TRANS_COUNT
+} TransitionKind;
+
+typedef enum {
+    EASE_LINEAR = 0,
+    EASE_IN,         // quadratic
+    EASE_OUT,
+    EASE_IN_OUT      // smoothstep
+} Easing;
+
+TransitionKind transition_from_string(const char* s);
+const char* transition_name(TransitionKind k);
+Easing easing_from_string(const char* s);
+const char* easing_name(Easing e);
+
+/* Maps linear progress t (clamped to 0..1) through the curve. */
+float ease(Easing e, float t);
+
+/*
+  Mask for TRANS_LUMA: a 24/32-bit BMP (converted to luma) or, when no
+  path is given or it fails to load, a built-in diagonal gradient.
+  Returns a GL_LUMINANCE texture.
+*/
+GLuint transition_load_mask(const char* bmp_path);
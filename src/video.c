@@ -1,7 +1,15 @@
 #include "video.h"
+#include "video_pipeline.h"
+#include "metrics.h"
+#include "stats.h"
+#include "netsync.h"
+#include "rt_profile.h"
+#include "pyramid.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <malloc.h>
+#include <sys/resource.h>
 
 static void setup_tex_params(void)
 {
@@ -16,12 +24,15 @@ static void free_upload_buffers(Video* v)
     free(v->upload_y);
     free(v->upload_u);
     free(v->upload_v);
+    free(v->upload_a);
     v->upload_y = NULL;
     v->upload_u = NULL;
     v->upload_v = NULL;
+    v->upload_a = NULL;
     v->upload_y_size = 0;
     v->upload_u_size = 0;
     v->upload_v_size = 0;
+    v->upload_a_size = 0;
 }
 
 static int ensure_upload_buffer(guint8** buf, size_t* cap, size_t need)
@@ -41,80 +52,341 @@ static int ensure_upload_buffer(guint8** buf, size_t* cap, size_t need)
 void video_reset(Video* v)
 {
     memset(v, 0, sizeof(*v));
+    v->frames.last_pts = GST_CLOCK_TIME_NONE;
 }
 
-int video_start(Video* v, const char* filename)
+static void on_deep_element_added(GstBin* bin, GstBin* sub_bin, GstElement* element, gpointer user)
+{
+    VideoLearn* l = (VideoLearn*)user;
+    GstElementFactory* f = gst_element_get_factory(element);
+    if (!f) return;
+
+    const gchar* klass = gst_element_factory_get_metadata(f, GST_ELEMENT_METADATA_KLASS);
+    const gchar* name = gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(f));
+    if (!klass || !name) return;
+
+    if (strstr(klass, "Demux") && !l->chain.demux[0]) {
+        snprintf(l->chain.demux, sizeof(l->chain.demux), "%s", name);
+    } else if (strstr(klass, "Parser") && strstr(klass, "Video") && !l->chain.parser[0]) {
+        snprintf(l->chain.parser, sizeof(l->chain.parser), "%s", name);
+    } else if (strstr(klass, "Decoder") && strstr(klass, "Video") && !l->decoder) {
+        snprintf(l->chain.decoder, sizeof(l->chain.decoder), "%s", name);
+        l->decoder = (GstElement*)gst_object_ref(element);
+    }
+}
+
+static void learn_free(Video* v)
+{
+    if (!v->learn) return;
+    if (v->learn->decoder) gst_object_unref(v->learn->decoder);
+    free(v->learn);
+    v->learn = NULL;
+}
+
+/* Called on the first sample: the autoplugged chain is known to work. */
+static void learn_commit(Video* v)
+{
+    VideoLearn* l = v->learn;
+    if (!l || !l->decoder) return;
+
+    GstPad* pad = gst_element_get_static_pad(l->decoder, "sink");
+    GstCaps* caps = pad ? gst_pad_get_current_caps(pad) : NULL;
+    if (caps && gst_caps_get_size(caps) > 0) {
+        snprintf(l->chain.caps, sizeof(l->chain.caps), "%s",
+                 gst_structure_get_name(gst_caps_get_structure(caps, 0)));
+        media_index_store(v->path, &l->chain);
+        log_info("[MEDIA] learned %s: %s ! %s ! %s ! %s", v->path,
+                 l->chain.demux, l->chain.caps,
+                 l->chain.parser[0] ? l->chain.parser : "(no parser)", l->chain.decoder);
+    }
+    if (caps) gst_caps_unref(caps);
+    if (pad)  gst_object_unref(pad);
+    learn_free(v);
+}
+
+enum { START_DECODEBIN = 0, START_BUILT, START_REUSED, START_MODES };
+
+static const char* start_mode_name(int m)
+{
+    switch (m) { case START_BUILT: return "built"; case START_REUSED: return "reused"; default: return "decodebin"; }
+}
+
+static int start_mode(const Video* v)
+{
+    if (!v->explicit_chain) return START_DECODEBIN;
+    return v->reused ? START_REUSED : START_BUILT;
+}
+
+static void log_first_sample(Video* v)
+{
+    // Running averages per construction mode, to compare autoplug, fresh build and reuse.
+    static double sum_ms[START_MODES];
+    static int n[START_MODES];
+
+    int m = start_mode(v);
+    Uint64 us = time_now_us() - v->start_us;
+    double ms = us / 1000.0;
+    sum_ms[m] += ms;
+    metrics_observe_us(H_DECODER_START, us);
+    n[m]++;
+
+    char avg[160];
+    int len = 0;
+    for (int i = 0; i < START_MODES && len < (int)sizeof(avg); i++)
+        len += snprintf(avg + len, sizeof(avg) - len, " avg %s=%.1f ms (%d)",
+                        start_mode_name(i), n[i] ? sum_ms[i] / n[i] : 0.0, n[i]);
+    log_info("[VIDEO] first frame after %.1f ms (%s)%s", ms, start_mode_name(m), avg);
+}
+
+/* mallinfo2 is glibc 2.33+ (Bookworm); Bullseye's 2.31 only has the int-sized mallinfo. */
+static long heap_in_use(void)
+{
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 mi = mallinfo2();
+    return (long)mi.uordblks;
+#else
+    struct mallinfo mi = mallinfo();
+    return (long)(unsigned)mi.uordblks;
+#endif
+#else
+    return 0;
+#endif
+}
+
+static int video_start_chain(Video* v, const char* filename, int use_index)
+{
+    video_reset(v);
+    snprintf(v->path, sizeof(v->path), "%s", filename);
+    v->start_us = time_now_us();
+    long heap0 = heap_in_use();
+
+    MediaChain chain;
+    v->explicit_chain = use_index && media_index_lookup(filename, &chain);
+
+    VideoPipeline p;
+    int ok;
+    if (v->explicit_chain) {
+        char sig[256];
+        vpipe_signature(&chain, sig, sizeof(sig));
+        v->reused = vpipe_pool_take(&p, sig);
+        ok = v->reused || vpipe_build_explicit(&p, &chain);
+    } else {
+        ok = vpipe_build_decodebin(&p);
+    }
+    if (!ok) {
+        log_error("Pipeline construction failed: %s", filename);
+        return 0;
+    }
+
+    v->pipeline = p.pipeline;
+    v->src = p.src;
+    v->appsink = p.appsink;
+    snprintf(v->sig, sizeof(v->sig), "%s", p.sig);
+
+    g_object_set(v->src, "location", filename, NULL);
+
+    if (!v->explicit_chain) {
+        v->learn = (VideoLearn*)calloc(1, sizeof(VideoLearn));
+        if (v->learn)
+            g_signal_connect(v->pipeline, "deep-element-added",
+                             G_CALLBACK(on_deep_element_added), v->learn);
+    }
+
+    // Queue depth and drop policy are set by the sink tail (video_pipeline.c).
+    gst_app_sink_set_emit_signals((GstAppSink*)v->appsink, FALSE);
+
+    v->bus = gst_element_get_bus(v->pipeline);
+    rt_watch_bus(v->bus);
+
+    if (gst_element_set_state(v->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        log_error("Failed to set PLAYING for: %s", filename);
+        return 0;
+    }
+
+    double ms = (time_now_us() - v->start_us) / 1000.0;
+    long heap = heap_in_use() - heap0;
+    if (v->explicit_chain) {
+        log_info("Video started (%s ! %s ! %s -> appsink, %s) in %.1f ms, %d elements, %+ld heap bytes: %s",
+                 chain.demux, chain.parser[0] ? chain.parser : "-", chain.decoder,
+                 v->reused ? "reused" : "built", ms, p.elements, heap, filename);
+    } else {
+        log_info("Video started (decodebin -> appsink) in %.1f ms, %d elements, %+ld heap bytes: %s",
+                 ms, p.elements, heap, filename);
+    }
+    v->playing = 1;
+    return 1;
+}
+
+/* Decoding runs in a child process; frames arrive through its shared-memory ring. */
+static int video_start_isolated(Video* v, const char* filename, GstClockTime at)
 {
     video_reset(v);
     snprintf(v->path, sizeof(v->path), "%s", filename);
+    v->start_us = time_now_us();
 
-    char pipe[2048];
-    snprintf(pipe, sizeof(pipe),
-    "filesrc location=\"%s\" ! "
-    "decodebin ! "
-    "videoconvert ! "
-    "video/x-raw,format=I420 ! "
-    "appsink name=sink sync=false max-buffers=1 drop=true",
-    filename
-);
-
-    GError* err = NULL;
-    v->pipeline = gst_parse_launch(pipe, &err);
-    if (!v->pipeline) {
-        fprintf(stderr, "gst_parse_launch failed: %s\n", err ? err->message : "unknown");
-        if (err) g_error_free(err);
-        fflush(stderr);
+    v->proc = (DecoderProc*)calloc(1, sizeof(DecoderProc));
+    if (!v->proc || !dproc_start(v->proc, filename, at)) {
+        free(v->proc);
+        v->proc = NULL;
         return 0;
     }
+    v->playing = 1;
+    return 1;
+}
+
+int video_start(Video* v, const char* filename)
+{
+    if (dproc_enabled())
+        return video_start_isolated(v, filename, 0);
+    return video_start_chain(v, filename, 1);
+}
+
+/* ================= Gapless ================= */
+
+static void set_uri(GstElement* playbin, const char* filename)
+{
+    gchar* uri = gst_filename_to_uri(filename, NULL);
+    if (uri) {
+        g_object_set(playbin, "uri", uri, NULL);
+        g_free(uri);
+    }
+}
+
+/* Streaming thread: playbin has buffered the tail of the current clip. */
+static void on_about_to_finish(GstElement* playbin, gpointer user)
+{
+    GaplessFeed* f = (GaplessFeed*)user;
+
+    g_mutex_lock(&f->lock);
+    if (f->next[0]) {
+        snprintf(f->current, sizeof(f->current), "%s", f->next);
+        f->next[0] = '\0';
+    }
+    set_uri(playbin, f->current);
+    f->switched = 1;
+    g_mutex_unlock(&f->lock);
+}
 
-    v->appsink = gst_bin_get_by_name(GST_BIN(v->pipeline), "sink");
-    if (!v->appsink) {
-        fprintf(stderr, "appsink not found\n");
-        fflush(stderr);
+static void feed_free(Video* v)
+{
+    if (!v->feed) return;
+    g_mutex_clear(&v->feed->lock);
+    free(v->feed);
+    v->feed = NULL;
+}
+
+int video_start_gapless(Video* v, const char* filename)
+{
+    video_reset(v);
+    snprintf(v->path, sizeof(v->path), "%s", filename);
+    v->start_us = time_now_us();
+
+    VideoPipeline p;
+    if (!vpipe_build_gapless(&p)) {
+        log_error("Pipeline construction failed: %s", filename);
         return 0;
     }
+    v->pipeline = p.pipeline;
+    v->src = p.src;
+    v->appsink = p.appsink;
+
+    v->feed = (GaplessFeed*)calloc(1, sizeof(GaplessFeed));
+    if (!v->feed) return 0;
+    g_mutex_init(&v->feed->lock);
+    snprintf(v->feed->current, sizeof(v->feed->current), "%s", filename);
 
-    // Force raw I420 at the sink.
-    GstCaps* want = gst_caps_from_string("video/x-raw,format=I420");
-    gst_app_sink_set_caps((GstAppSink*)v->appsink, want);
-    gst_caps_unref(want);
+    set_uri(v->src, filename);
+    g_signal_connect(v->src, "about-to-finish", G_CALLBACK(on_about_to_finish), v->feed);
 
+    // Queue depth and drop policy are set by the sink tail (video_pipeline.c).
     gst_app_sink_set_emit_signals((GstAppSink*)v->appsink, FALSE);
-    gst_app_sink_set_drop((GstAppSink*)v->appsink, TRUE);
-    gst_app_sink_set_max_buffers((GstAppSink*)v->appsink, 1);
 
     v->bus = gst_element_get_bus(v->pipeline);
+    rt_watch_bus(v->bus);
 
     if (gst_element_set_state(v->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
-        fprintf(stderr, "Failed to set PLAYING for: %s\n", filename);
-        fflush(stderr);
+        log_error("Failed to set PLAYING for: %s", filename);
         return 0;
     }
 
-    fprintf(stderr, "Video started (decodebin -> appsink I420): %s\n", filename);
-    fflush(stderr);
+    log_info("Video started (gapless playbin -> appsink) in %.1f ms: %s",
+             (time_now_us() - v->start_us) / 1000.0, filename);
     v->playing = 1;
     return 1;
 }
 
+int video_is_gapless(const Video* v)
+{
+    return v && v->feed != NULL;
+}
+
+int video_gapless_wants_next(Video* v, char* tail, size_t tail_sz)
+{
+    if (!v->feed) return 0;
+
+    g_mutex_lock(&v->feed->lock);
+    int wants = (v->feed->next[0] == '\0');
+    if (wants) snprintf(tail, tail_sz, "%s", v->feed->current);
+    g_mutex_unlock(&v->feed->lock);
+    return wants;
+}
+
+void video_gapless_queue(Video* v, const char* filename)
+{
+    if (!v->feed || !filename) return;
+
+    g_mutex_lock(&v->feed->lock);
+    snprintf(v->feed->next, sizeof(v->feed->next), "%s", filename);
+    g_mutex_unlock(&v->feed->lock);
+}
+
 void video_stop(Video* v)
 {
     if (!v) return;
 
-    if (v->pipeline)
-        gst_element_set_state(v->pipeline, GST_STATE_NULL);
+    if (v->proc) {
+        dproc_stop(v->proc);
+        free(v->proc);
+        v->proc = NULL;
+    }
+
+    if (v->bus) gst_object_unref(v->bus);
+    learn_free(v);
+
+    VideoPipeline p = {
+        .pipeline = v->pipeline,
+        .src = v->src,
+        .appsink = v->appsink,
+    };
+    snprintf(p.sig, sizeof(p.sig), "%s", v->sig);
 
-    if (v->bus)      gst_object_unref(v->bus);
-    if (v->appsink)  gst_object_unref(v->appsink);
-    if (v->pipeline) gst_object_unref(v->pipeline);
+    // Explicit chains are parked for the next clip with the same codec.
+    if (!vpipe_pool_put(&p))
+        vpipe_destroy(&p);
 
     v->pipeline = NULL;
+    v->src      = NULL;
     v->appsink  = NULL;
     v->bus      = NULL;
     v->playing  = 0;
+    if (v->held) gst_sample_unref(v->held);
+    v->held = NULL;
+    feed_free(v);
     free_upload_buffers(v);
 }
 
+void video_set_paused(Video* v, int paused)
+{
+    if (!v || (!v->pipeline && !v->proc) || v->paused == paused) return;
+
+    if (v->proc)
+        dproc_set_paused(v->proc, paused);
+    else
+        gst_element_set_state(v->pipeline, paused ? GST_STATE_PAUSED : GST_STATE_PLAYING);
+    v->paused = paused;
+}
+
 void video_delete_textures(Video* v)
 {
     if (!v) return;
@@ -122,15 +394,27 @@ void video_delete_textures(Video* v)
         glDeleteTextures(1, &v->texY);
         glDeleteTextures(1, &v->texU);
         glDeleteTextures(1, &v->texV);
-        v->texY = v->texU = v->texV = 0;
+        if (v->texA) glDeleteTextures(1, &v->texA);
+        v->texY = v->texU = v->texV = v->texA = 0;
+        if (v->prevY) {
+            glDeleteTextures(1, &v->prevY);
+            glDeleteTextures(1, &v->prevU);
+            glDeleteTextures(1, &v->prevV);
+            if (v->prevA) glDeleteTextures(1, &v->prevA);
+        }
+        v->prevY = v->prevU = v->prevV = v->prevA = 0;
+        v->has_prev = 0;
         v->tex_inited = 0;
     }
+    pyramid_free(&v->pyr);
 }
 
 void video_poll_bus(Video* v)
 {
     if (!v || !v->bus) return;
 
+    int fallback = 0;
+
     while (1) {
         GstMessage* msg = gst_bus_pop(v->bus);
         if (!msg) break;
@@ -140,13 +424,45 @@ void video_poll_bus(Video* v)
             GError* err = NULL;
             gchar* dbg = NULL;
             gst_message_parse_error(msg, &err, &dbg);
-            fprintf(stderr, "GST ERROR (%s): %s\n", v->path, err ? err->message : "unknown");
-            if (dbg) fprintf(stderr, "GST DEBUG: %s\n", dbg);
+            // A broken source can post the same error every frame: keep the log readable.
+            log_ratelimited(LL_ERROR, "GST ERROR (%s): %s", v->path, err ? err->message : "unknown");
+            if (dbg) log_ratelimited(LL_DEBUG, "GST DEBUG: %s", dbg);
             if (dbg) g_free(dbg);
             if (err) g_error_free(err);
-            fflush(stderr);
+            metrics_add(M_BUS_ERRORS, 1);
+            v->errors++;
+
+            // An errored pipeline is never parked for reuse.
+            v->sig[0] = '\0';
+
+            // A stale index entry must not leave the clip dead: autoplug instead.
+            if (v->explicit_chain && !v->first_sample_seen)
+                fallback = 1;
             break;
         }
+        case GST_MESSAGE_STREAM_START:
+            // Gapless: the clip queued at about-to-finish is now on screen.
+            if (v->feed) {
+                g_mutex_lock(&v->feed->lock);
+                if (v->feed->switched) {
+                    v->feed->switched = 0;
+                    video_log_frames(v, "gapless");
+                    memset(&v->frames, 0, sizeof(v->frames));
+                    v->frames.last_pts = GST_CLOCK_TIME_NONE;
+                    snprintf(v->path, sizeof(v->path), "%s", v->feed->current);
+                    log_info("[VIDEO] gapless -> %s", v->path);
+                }
+                g_mutex_unlock(&v->feed->lock);
+            }
+            break;
+        case GST_MESSAGE_ASYNC_DONE:
+            // Watchdog rebuild: carry on where the broken pipeline stopped.
+            if (v->resume_at && GST_MESSAGE_SRC(msg) == GST_OBJECT(v->pipeline)) {
+                gst_element_seek_simple(v->pipeline, GST_FORMAT_TIME,
+                    (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT), (gint64)v->resume_at);
+                v->resume_at = 0;
+            }
+            break;
         case GST_MESSAGE_EOS:
             gst_element_seek_simple(v->pipeline, GST_FORMAT_TIME,
                 (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT), 0);
@@ -156,144 +472,981 @@ void video_poll_bus(Video* v)
         }
 
         gst_message_unref(msg);
+        if (fallback) break;
+    }
+
+    if (fallback) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s", v->path);
+        log_warn("[MEDIA] explicit chain failed, falling back to decodebin: %s", path);
+
+        media_index_forget(path);
+        video_stop(v);
+        video_start_chain(v, path, 0);
+        metrics_add(M_PIPELINE_RESTARTS, 1);
     }
 }
 
-static void upload_i420(Video* v, const GstVideoInfo* info, GstBuffer* buffer)
+static int g_ten_bit = -1;   // MAPPER_10BIT, read once
+
+int video_format_supported(GstVideoFormat fmt)
 {
-    GstVideoFrame frame;
-    if (!gst_video_frame_map(&frame, info, buffer, GST_MAP_READ))
+    if (g_ten_bit < 0) {
+        const char* e = getenv("MAPPER_10BIT");
+        g_ten_bit = !(e && e[0] == '0');
+    }
+    switch (fmt) {
+    case GST_VIDEO_FORMAT_I420:
+    case GST_VIDEO_FORMAT_A420:
+        return 1;
+    case GST_VIDEO_FORMAT_I420_10LE:
+    case GST_VIDEO_FORMAT_P010_10LE:
+        return g_ten_bit;
+    default:
+        return 0;
+    }
+}
+
+VideoDepth video_depth_of(GstVideoFormat fmt)
+{
+    switch (fmt) {
+    case GST_VIDEO_FORMAT_I420_10LE: return VIDEO_DEPTH_10;
+    case GST_VIDEO_FORMAT_P010_10LE: return VIDEO_DEPTH_P010;
+    default:                         return VIDEO_DEPTH_8;
+    }
+}
+
+/* Split-byte 16-bit planes can't be filtered by the texture unit (the high byte would blur); the shader filters them. */
+static GLuint new_plane_tex(int w, int h, GLenum fmt)
+{
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    setup_tex_params();
+    if (fmt != GL_LUMINANCE) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glTexImage2D(GL_TEXTURE_2D, 0, fmt, w, h, 0, fmt, GL_UNSIGNED_BYTE, NULL);
+    return tex;
+}
+
+/* GL format and bytes per texel of plane i (0 Y, 1 U or P010's UV, 2 V, 3 A). */
+static GLenum plane_format(VideoDepth d, int i, int* bpp)
+{
+    if (d == VIDEO_DEPTH_8 || i == 3) {
+        *bpp = 1;
+        return GL_LUMINANCE;
+    }
+    if (d == VIDEO_DEPTH_P010 && i == 1) {
+        *bpp = 4;
+        return GL_RGBA;
+    }
+    *bpp = 2;
+    return GL_LUMINANCE_ALPHA;
+}
+
+/* Upload decimation for the quality governor: planes go up at 1/2^shift size. */
+static int g_upload_shift;
+
+void video_set_upload_shift(int shift)
+{
+    g_upload_shift = (shift < 0) ? 0 : (shift > 2) ? 2 : shift;
+}
+
+/* Copies every 2^shift-th texel of every 2^shift-th row into a tight dw x dh plane. */
+static void decimate_plane(guint8* dst, const guint8* src, int stride, int dw, int dh, int shift, int bpp)
+{
+    for (int y = 0; y < dh; y++) {
+        const guint8* s = src + ((size_t)y << shift) * (size_t)stride;
+        guint8* d = dst + (size_t)y * (size_t)dw * (size_t)bpp;
+        if (bpp == 1) {
+            for (int x = 0; x < dw; x++)
+                d[x] = s[x << shift];
+        } else {
+            for (int x = 0; x < dw; x++)
+                memcpy(d + (size_t)x * bpp, s + ((size_t)x << shift) * bpp, (size_t)bpp);
+        }
+    }
+}
+
+/* Uploads one plane of w x h texels, repacking through *buf when the stride is padded or decimating. */
+static void upload_plane(GLuint tex, GLenum fmt, int bpp, const guint8* data, int stride, int w, int h,
+                         int shift, guint8** buf, size_t* cap)
+{
+    glBindTexture(GL_TEXTURE_2D, tex);
+    if (shift > 0) {
+        int dw = w >> shift, dh = h >> shift;
+        if (!ensure_upload_buffer(buf, cap, (size_t)dw * (size_t)dh * (size_t)bpp))
+            return;
+        decimate_plane(*buf, data, stride, dw, dh, shift, bpp);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, dw, dh, fmt, GL_UNSIGNED_BYTE, *buf);
         return;
+    }
 
-    int w = GST_VIDEO_INFO_WIDTH(info);
-    int h = GST_VIDEO_INFO_HEIGHT(info);
+    size_t row = (size_t)w * (size_t)bpp;
+    if ((size_t)stride == row) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, fmt, GL_UNSIGNED_BYTE, data);
+        return;
+    }
 
-    const guint8* dataY = (const guint8*)GST_VIDEO_FRAME_PLANE_DATA(&frame, 0);
-    const guint8* dataU = (const guint8*)GST_VIDEO_FRAME_PLANE_DATA(&frame, 1);
-    const guint8* dataV = (const guint8*)GST_VIDEO_FRAME_PLANE_DATA(&frame, 2);
+    if (!ensure_upload_buffer(buf, cap, row * (size_t)h))
+        return;
+    for (int y = 0; y < h; y++)
+        memcpy(*buf + (size_t)y * row, data + (size_t)y * (size_t)stride, row);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, fmt, GL_UNSIGNED_BYTE, *buf);
+}
 
-    int strideY = GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 0);
-    int strideU = GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 1);
-    int strideV = GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 2);
+/* Colour left, alpha (as luma) right: "clip_alpha.mp4", "logo-alpha.mov". */
+static int path_is_packed_alpha(const char* path)
+{
+    const char* base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    const char* dot = strrchr(base, '.');
+    size_t len = dot ? (size_t)(dot - base) : strlen(base);
+    return len > 6 && (strncmp(base + len - 6, "_alpha", 6) == 0 ||
+                       strncmp(base + len - 6, "-alpha", 6) == 0);
+}
+
+static const char* depth_name(VideoDepth d, int has_plane)
+{
+    switch (d) {
+    case VIDEO_DEPTH_10:   return "I420_10LE";
+    case VIDEO_DEPTH_P010: return "P010";
+    default:               return has_plane ? "A420" : "I420";
+    }
+}
+
+void video_plane_size(const Video* v, float size[4])
+{
+    size[0] = (float)(v->width >> v->upload_shift);
+    size[1] = (float)(v->height >> v->upload_shift);
+    size[2] = (float)((v->width / 2) >> v->upload_shift);
+    size[3] = (float)((v->height / 2) >> v->upload_shift);
+}
+
+/* Creates the texture set (Y, U, V[, A]) for the current size, depth and shift. */
+static void new_plane_set(const Video* v, int has_plane, GLuint out[4])
+{
+    int w = v->width >> v->upload_shift, h = v->height >> v->upload_shift;
+    int cw = (v->width / 2) >> v->upload_shift, ch = (v->height / 2) >> v->upload_shift;
+    int bpp;
+
+    out[0] = new_plane_tex(w, h, plane_format(v->depth, 0, &bpp));
+    out[1] = new_plane_tex(cw, ch, plane_format(v->depth, 1, &bpp));
+    // P010 carries U and V in one plane; the V sampler still needs a texture.
+    out[2] = (v->depth == VIDEO_DEPTH_P010) ? new_plane_tex(1, 1, GL_LUMINANCE)
+                                            : new_plane_tex(cw, ch, plane_format(v->depth, 2, &bpp));
+    out[3] = has_plane ? new_plane_tex(w, h, GL_LUMINANCE) : 0;
+}
 
+/* I420 planes (+ A420 alpha as plane 3, or 10-bit planes) -> textures; shared by appsink and isolated decoders. */
+static void upload_planes(Video* v, int w, int h, int has_plane, VideoDepth depth,
+                          const guint8* const data[4], const int stride[4])
+{
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    if (!v->tex_inited || v->width != w || v->height != h) {
-        if (v->tex_inited) {
-            glDeleteTextures(1, &v->texY);
-            glDeleteTextures(1, &v->texU);
-            glDeleteTextures(1, &v->texV);
-            v->tex_inited = 0;
-        }
+    // Decimation never goes below a usable chroma plane.
+    int shift = g_upload_shift;
+    while (shift > 0 && ((w >> shift) < 64 || (h >> shift) < 64))
+        shift--;
+
+    int fresh = 0;
+    if (!v->tex_inited || v->width != w || v->height != h || (v->texA != 0) != has_plane ||
+        v->upload_shift != shift || v->depth != depth) {
+        if (v->tex_inited)
+            video_delete_textures(v);
 
         v->width = w;
         v->height = h;
+        v->upload_shift = shift;
+        v->depth = depth;
 
-        glGenTextures(1, &v->texY);
-        glBindTexture(GL_TEXTURE_2D, v->texY);
-        setup_tex_params();
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, w, h, 0,
-                     GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
-
-        glGenTextures(1, &v->texU);
-        glBindTexture(GL_TEXTURE_2D, v->texU);
-        setup_tex_params();
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, w/2, h/2, 0,
-                     GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
-
-        glGenTextures(1, &v->texV);
-        glBindTexture(GL_TEXTURE_2D, v->texV);
-        setup_tex_params();
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, w/2, h/2, 0,
-                     GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+        GLuint t[4];
+        new_plane_set(v, has_plane, t);
+        v->texY = t[0];
+        v->texU = t[1];
+        v->texV = t[2];
+        v->texA = t[3];
+        if (video_cadence_mode() == CADENCE_BLEND) {
+            new_plane_set(v, has_plane, t);
+            v->prevY = t[0];
+            v->prevU = t[1];
+            v->prevV = t[2];
+            v->prevA = t[3];
+        }
 
+        v->alpha = has_plane ? VIDEO_ALPHA_PLANE
+                 : path_is_packed_alpha(v->path) ? VIDEO_ALPHA_PACKED
+                 : VIDEO_ALPHA_NONE;
         v->tex_inited = 1;
+        v->has_prev = 0;
+        fresh = 1;
 
-        fprintf(stderr, "Textures init (I420) %dx%d strideY=%d strideU=%d strideV=%d\n",
-                w, h, strideY, strideU, strideV);
-        fflush(stderr);
+        log_info("Textures init (%s) %dx%d (1/%d) strideY=%d strideU=%d strideV=%d%s",
+                 depth_name(depth, has_plane), w, h, 1 << shift,
+                 stride[0], stride[1], stride[2],
+                 v->alpha == VIDEO_ALPHA_PACKED ? " (side-by-side alpha)" : "");
     }
 
-    glBindTexture(GL_TEXTURE_2D, v->texY);
-    if (strideY == w) {
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h,
-                        GL_LUMINANCE, GL_UNSIGNED_BYTE, dataY);
-    } else {
-        size_t tight = (size_t)w * (size_t)h;
-        if (ensure_upload_buffer(&v->upload_y, &v->upload_y_size, tight)) {
-            for (int y = 0; y < h; y++)
-                memcpy(v->upload_y + (size_t)y * (size_t)w, dataY + (size_t)y * (size_t)strideY, (size_t)w);
-            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h,
-                            GL_LUMINANCE, GL_UNSIGNED_BYTE, v->upload_y);
-        }
+    // Blend cadence: the outgoing frame becomes "previous" without a copy.
+    if (v->prevY && !fresh) {
+        GLuint t;
+        t = v->prevY; v->prevY = v->texY; v->texY = t;
+        t = v->prevU; v->prevU = v->texU; v->texU = t;
+        t = v->prevV; v->prevV = v->texV; v->texV = t;
+        t = v->prevA; v->prevA = v->texA; v->texA = t;
+        v->has_prev = 1;
     }
 
-    glBindTexture(GL_TEXTURE_2D, v->texU);
     int cw = w / 2;
     int ch = h / 2;
-    if (strideU == cw) {
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, cw, ch,
-                        GL_LUMINANCE, GL_UNSIGNED_BYTE, dataU);
-    } else {
-        size_t tight = (size_t)cw * (size_t)ch;
-        if (ensure_upload_buffer(&v->upload_u, &v->upload_u_size, tight)) {
-            for (int y = 0; y < ch; y++)
-                memcpy(v->upload_u + (size_t)y * (size_t)cw, dataU + (size_t)y * (size_t)strideU, (size_t)cw);
-            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, cw, ch,
-                            GL_LUMINANCE, GL_UNSIGNED_BYTE, v->upload_u);
-        }
+
+    int ybpp, ubpp, vbpp;
+    GLenum yfmt = plane_format(depth, 0, &ybpp);
+    GLenum ufmt = plane_format(depth, 1, &ubpp);
+    GLenum vfmt = plane_format(depth, 2, &vbpp);
+
+    StageMark m;
+    stats_stage_begin(&m);
+    upload_plane(v->texY, yfmt, ybpp, data[0], stride[0], w, h, shift,
+                 &v->upload_y, &v->upload_y_size);
+    upload_plane(v->texU, ufmt, ubpp, data[1], stride[1], cw, ch, shift,
+                 &v->upload_u, &v->upload_u_size);
+    if (depth != VIDEO_DEPTH_P010)
+        upload_plane(v->texV, vfmt, vbpp, data[2], stride[2], cw, ch, shift,
+                     &v->upload_v, &v->upload_v_size);
+    else
+        vbpp = 0;
+
+    size_t luma = ((size_t)w * h) >> (2 * shift);
+    size_t chroma = ((size_t)cw * ch) >> (2 * shift);
+    size_t bytes = luma * ybpp + chroma * (ubpp + vbpp);
+    stats_stage_end(STAGE_UPLOAD_YUV, &m, bytes);
+
+    if (has_plane) {
+        // Timed on its own so the cost of alpha sources shows up separately.
+        stats_stage_begin(&m);
+        upload_plane(v->texA, GL_LUMINANCE, 1, data[3], stride[3], w, h, shift,
+                     &v->upload_a, &v->upload_a_size);
+        stats_stage_end(STAGE_UPLOAD_ALPHA, &m, luma);
+        metrics_add(M_UPLOAD_BYTES, luma);
     }
+    metrics_add(M_UPLOAD_BYTES, bytes);
+    v->frames.uploaded++;
+    v->upload_us = time_now_us();
+}
 
-    glBindTexture(GL_TEXTURE_2D, v->texV);
-    if (strideV == cw) {
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, cw, ch,
-                        GL_LUMINANCE, GL_UNSIGNED_BYTE, dataV);
-    } else {
-        size_t tight = (size_t)cw * (size_t)ch;
-        if (ensure_upload_buffer(&v->upload_v, &v->upload_v_size, tight)) {
-            for (int y = 0; y < ch; y++)
-                memcpy(v->upload_v + (size_t)y * (size_t)cw, dataV + (size_t)y * (size_t)strideV, (size_t)cw);
-            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, cw, ch,
-                            GL_LUMINANCE, GL_UNSIGNED_BYTE, v->upload_v);
-        }
+static const char* deint_name(DeinterlaceMode m)
+{
+    switch (m) {
+    case DEINT_BOB:      return "bob";
+    case DEINT_ADAPTIVE: return "adaptive";
+    default:             return "off";
+    }
+}
+
+static void set_interlace(Video* v, int interlaced, int tff)
+{
+    // Mixed streams can flip every few frames: rate-limited, this runs on the render thread.
+    if (interlaced != v->interlaced || (interlaced && tff != v->tff))
+        log_ratelimited(LL_INFO, "[VIDEO] %s%s, deinterlace %s: %s",
+                        interlaced ? "interlaced" : "progressive",
+                        interlaced ? (tff ? " (top field first)" : " (bottom field first)") : "",
+                        deint_name(video_deinterlace_mode()), v->path);
+    v->interlaced = interlaced;
+    v->tff = tff;
+}
+
+static void upload_i420(Video* v, const GstVideoInfo* info, GstBuffer* buffer)
+{
+    // Mixed streams flag each interlaced frame; field order comes with the buffer or the caps.
+    GstVideoInterlaceMode im = GST_VIDEO_INFO_INTERLACE_MODE(info);
+    set_interlace(v, im == GST_VIDEO_INTERLACE_MODE_INTERLEAVED ||
+                     (im == GST_VIDEO_INTERLACE_MODE_MIXED &&
+                      GST_BUFFER_FLAG_IS_SET(buffer, GST_VIDEO_BUFFER_FLAG_INTERLACED)),
+                  GST_BUFFER_FLAG_IS_SET(buffer, GST_VIDEO_BUFFER_FLAG_TFF) ||
+                     GST_VIDEO_INFO_FIELD_ORDER(info) == GST_VIDEO_FIELD_ORDER_TOP_FIELD_FIRST);
+
+    GstVideoFrame frame;
+    if (!gst_video_frame_map(&frame, info, buffer, GST_MAP_READ))
+        return;
+
+    const guint8* data[4] = { 0 };
+    int stride[4] = { 0 };
+    for (guint i = 0; i < GST_VIDEO_FRAME_N_PLANES(&frame) && i < 4; i++) {
+        data[i] = GST_VIDEO_FRAME_PLANE_DATA(&frame, i);
+        stride[i] = GST_VIDEO_FRAME_PLANE_STRIDE(&frame, i);
     }
+    GstVideoFormat fmt = GST_VIDEO_INFO_FORMAT(info);
+    upload_planes(v, GST_VIDEO_INFO_WIDTH(info), GST_VIDEO_INFO_HEIGHT(info),
+                  fmt == GST_VIDEO_FORMAT_A420, video_depth_of(fmt), data, stride);
 
     gst_video_frame_unmap(&frame);
 }
 
-void video_update_texture(Video* v)
+static Uint64 process_cpu_us(void)
 {
-    static int warned_non_i420 = 0;
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+    return (Uint64)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ull +
+           (Uint64)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
 
-    if (!v || !v->appsink) return;
+/* Every decoded frame passes here once; PTS jumps reveal frames lost upstream. */
+static void note_decoded(Video* v, GstClockTime pts)
+{
+    VideoFrameStats* f = &v->frames;
+    if (f->decoded++ == 0)
+        f->cpu_us0 = process_cpu_us();
+    if (!GST_CLOCK_TIME_IS_VALID(pts)) return;
 
-    // Non-blocking pull: never stall the render loop waiting for decode.
-    GstSample* sample = gst_app_sink_try_pull_sample((GstAppSink*)v->appsink, 0);
-    if (!sample) return;
+    // Loops, seeks and clip changes move PTS backwards or far ahead: not losses.
+    if (GST_CLOCK_TIME_IS_VALID(f->last_pts) && v->frame_ns > 0 &&
+        pts > f->last_pts && pts - f->last_pts < GST_SECOND) {
+        guint64 missing = (pts - f->last_pts + v->frame_ns / 2) / v->frame_ns;
+        if (missing > 1) {
+            f->lost += missing - 1;
+            metrics_add(M_FRAMES_DROPPED, missing - 1);
+        }
+    }
+    f->last_pts = pts;
+}
+
+static GstSample* pull_sample(Video* v)
+{
+    GstSample* s = gst_app_sink_try_pull_sample((GstAppSink*)v->appsink, 0);
+    if (!s) return NULL;
+
+    GstBuffer* b = gst_sample_get_buffer(s);
+    note_decoded(v, b ? GST_BUFFER_PTS(b) : GST_CLOCK_TIME_NONE);
+    return s;
+}
+
+static void present_sample(Video* v, GstSample* sample)
+{
+    static int warned_non_i420 = 0;
 
     GstCaps* caps = gst_sample_get_caps(sample);
     GstBuffer* buffer = gst_sample_get_buffer(sample);
 
     GstVideoInfo info;
     if (!caps || !buffer || !gst_video_info_from_caps(&info, caps))
-        goto out;
+        return;
 
-    if (GST_VIDEO_INFO_FORMAT(&info) != GST_VIDEO_FORMAT_I420) {
+    GstVideoFormat fmt = GST_VIDEO_INFO_FORMAT(&info);
+    if (!video_format_supported(fmt)) {
         if (!warned_non_i420) {
-            fprintf(stderr, "Unexpected sink format: %s (expected I420)\n",
-                    gst_video_format_to_string(GST_VIDEO_INFO_FORMAT(&info)));
-            fflush(stderr);
+            log_warn("Unexpected sink format: %s (expected I420/A420/I420_10LE/P010)",
+                     gst_video_format_to_string(GST_VIDEO_INFO_FORMAT(&info)));
             warned_non_i420 = 1;
         }
-        goto out;
+        return;
     }
 
+    if (GST_VIDEO_INFO_FPS_N(&info) > 0)
+        v->frame_ns = gst_util_uint64_scale(GST_SECOND, GST_VIDEO_INFO_FPS_D(&info),
+                                            GST_VIDEO_INFO_FPS_N(&info));
+
     GstVideoColorimetry c = info.colorimetry;
     v->video_range = (c.range == GST_VIDEO_COLOR_RANGE_16_235);
     v->bt709       = (c.matrix == GST_VIDEO_COLOR_MATRIX_BT709);
 
     upload_i420(v, &info, buffer);
 
-out:
-    gst_sample_unref(sample);
+    if (!v->first_sample_seen) {
+        v->first_sample_seen = 1;
+        log_first_sample(v);
+        // Alpha streams decode through a combiner bin the explicit builder can't express.
+        if (fmt == GST_VIDEO_FORMAT_A420)
+            learn_free(v);
+        else
+            learn_commit(v);
+    }
+}
+
+/* Far off the timeline (start-up, lost network): jump instead of dropping frames. */
+static int video_sync_reseek(Video* v, gint64 target)
+{
+    Uint64 now = time_now_us();
+    if (v->last_reseek_us && now - v->last_reseek_us < NETSYNC_RESEEK_MIN_US)
+        return 0;
+    v->last_reseek_us = now;
+
+    if (v->held) {
+        gst_sample_unref(v->held);
+        v->held = NULL;
+    }
+
+    // Aim past the target by the time the seek itself takes to settle.
+    gint64 pos = (target + NETSYNC_RESEEK_LEAD_NS) % v->duration_ns;
+    gst_element_seek_simple(v->pipeline, GST_FORMAT_TIME,
+        (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE), pos);
+
+    log_info("[SYNC] %s: reseek to %.3f s", v->path, pos / 1e9);
+    return 1;
+}
+
+/* Stream time of a sample, or -1 when it carries no usable timestamp. */
+static gint64 sample_stream_time(GstSample* s)
+{
+    GstBuffer* b = gst_sample_get_buffer(s);
+    const GstSegment* seg = gst_sample_get_segment(s);
+    if (!b || !seg || !GST_CLOCK_TIME_IS_VALID(GST_BUFFER_PTS(b))) return -1;
+
+    guint64 t = gst_segment_to_stream_time(seg, GST_FORMAT_TIME, GST_BUFFER_PTS(b));
+    return GST_CLOCK_TIME_IS_VALID(t) ? (gint64)t : -1;
+}
+
+/* Signed distance from the shared target, wrapped into (-dur/2, dur/2]. */
+static gint64 wrap_error(gint64 pts, gint64 target, gint64 dur)
+{
+    gint64 d = pts - target;
+    if (d > dur / 2) d -= dur;
+    else if (d <= -dur / 2) d += dur;
+    return d;
+}
+
+/*
+   Networked sync: show the newest decoded frame that is due on the shared
+   timeline, drop frames to catch up, and reseek when far off. Returns 1
+   when a frame was due (shown, or starved of one), 0 when the held frame
+   is not due yet, and -1 when the clip can't be placed on the timeline
+   (caller runs free).
+*/
+static int update_synced(Video* v)
+{
+    GstClockTime now = netsync_now();
+    if (!GST_CLOCK_TIME_IS_VALID(now) || v->feed) return -1;
+
+    if (v->duration_ns <= 0) {
+        gint64 d = 0;
+        if (!gst_element_query_duration(v->pipeline, GST_FORMAT_TIME, &d) || d <= 0)
+            return -1;
+        v->duration_ns = d;
+    }
+
+    const gint64 dur = v->duration_ns;
+    const gint64 half = (v->frame_ns > 0 ? (gint64)v->frame_ns : (gint64)GST_SECOND / 60) / 2;
+    gint64 target = ((gint64)now > (gint64)v->sync_base) ? ((gint64)(now - v->sync_base)) % dur : 0;
+
+    GstSample* due = NULL;
+    gint64 due_err = 0;
+    int dropped = 0;
+
+    for (;;) {
+        if (!v->held)
+            v->held = pull_sample(v);
+        if (!v->held) break;
+
+        gint64 pts = sample_stream_time(v->held);
+        gint64 err = (pts >= 0) ? wrap_error(pts, target, dur) : 0;
+        if (err > half) break;          // not yet: keep it for a later vsync
+
+        if (due) {
+            gst_sample_unref(due);
+            dropped++;
+        }
+        due = v->held;
+        due_err = err;
+        v->held = NULL;
+    }
+
+    if (!due) {
+        // Nothing due: either waiting for the right frame or starved.
+        gint64 pts = v->held ? sample_stream_time(v->held) : -1;
+        gint64 ahead = (pts >= 0) ? wrap_error(pts, target, dur) : 0;
+        if (ahead > NETSYNC_RESEEK_NS)
+            video_sync_reseek(v, target);
+        return v->held == NULL;
+    }
+
+    present_sample(v, due);
+    gst_sample_unref(due);
+
+    int resynced = 0;
+    if (due_err < -NETSYNC_RESEEK_NS)
+        resynced = video_sync_reseek(v, target);
+    netsync_note_frame(due_err, dropped, resynced);
+    if (dropped) {
+        v->frames.dropped += (guint64)dropped;
+        metrics_add(M_FRAMES_DROPPED, (Uint64)dropped);
+    }
+    return 1;
+}
+
+/* ================= Deinterlacing ================= */
+
+static int g_deint = -1;
+
+DeinterlaceMode video_deinterlace_mode(void)
+{
+    if (g_deint < 0) {
+        const char* e = getenv("MAPPER_DEINTERLACE");
+        g_deint = (e && strcmp(e, "off") == 0) ? DEINT_OFF
+                : (e && strcmp(e, "bob") == 0) ? DEINT_BOB
+                : DEINT_ADAPTIVE;
+    }
+    return (DeinterlaceMode)g_deint;
+}
+
+DeinterlaceMode video_field_params(const Video* v, float di[3])
+{
+    // Decimated uploads take every 2nd/4th row: one field only, nothing to undo.
+    DeinterlaceMode m = (v->interlaced && v->upload_shift == 0) ? video_deinterlace_mode() : DEINT_OFF;
+    int first = v->tff ? 0 : 1;
+    di[0] = (float)m;
+    di[1] = (float)(v->field ? 1 - first : first);
+    di[2] = (float)v->height;
+    return m;
+}
+
+/* ================= Cadence ================= */
+
+#define CADENCE_MAX_VSYNCS 4   // a render hiccup or a resume never fast-forwards more
+
+static guint64 g_vsync_ns = GST_SECOND / 60;
+static int g_cadence = -1;
+
+void video_set_display_rate(int refresh_hz)
+{
+    if (refresh_hz > 0)
+        g_vsync_ns = GST_SECOND / (guint64)refresh_hz;
+}
+
+CadenceMode video_cadence_mode(void)
+{
+    if (g_cadence < 0) {
+        const char* e = getenv("MAPPER_CADENCE");
+        g_cadence = (e && strcmp(e, "blend") == 0) ? CADENCE_BLEND : CADENCE_REPEAT;
+    }
+    return (CadenceMode)g_cadence;
+}
+
+static guint64 absdiff_ns(guint64 a, guint64 b)
+{
+    return a > b ? a - b : b - a;
+}
+
+/* Ideal vsyncs per frame over one cycle, e.g. "3:2" for 24p on 60 Hz. */
+static void log_pattern(const Video* v)
+{
+    char pat[64];
+    int len = 0;
+    guint64 acc = 0;
+    for (int i = 0; i < 12 && len < (int)sizeof(pat) - 4; i++) {
+        int n = 0;
+        do {
+            acc += g_vsync_ns;
+            n++;
+        } while (acc < v->frame_ns);
+        acc -= v->frame_ns;
+        len += snprintf(pat + len, sizeof(pat) - len, "%s%d", i ? ":" : "", n);
+        if (acc < g_vsync_ns / 100) break;   // back in phase: one cycle
+    }
+    int blend = video_cadence_mode() == CADENCE_BLEND && v->frame_ns > g_vsync_ns;
+    log_info("[CADENCE] %.3f fps on %.2f Hz: %s%s: %s", (double)GST_SECOND / v->frame_ns,
+             (double)GST_SECOND / g_vsync_ns, pat, blend ? " (blended)" : "", v->path);
+}
+
+/*
+   Frames the clip should advance this render frame. Missed vsyncs still
+   count, so a slow render frame doesn't slow the clip down.
+*/
+static int cadence_steps(Video* v, int* vsyncs)
+{
+    VideoCadence* c = &v->cad;
+    Uint64 now = time_now_us();
+    gint64 dt_ns = c->last_us ? (gint64)(now - c->last_us) * 1000 : (gint64)g_vsync_ns;
+    c->last_us = now;
+
+    // Nearest whole vsyncs; the rest carries over, so swaps that don't block still keep time.
+    gint64 t = dt_ns + c->rem_ns;
+    gint64 n = (t + (gint64)g_vsync_ns / 2) / (gint64)g_vsync_ns;
+    if (n < 0) n = 0;
+    c->rem_ns = t - n * (gint64)g_vsync_ns;
+    if (n > CADENCE_MAX_VSYNCS) {
+        n = CADENCE_MAX_VSYNCS;
+        c->rem_ns = 0;
+    }
+    *vsyncs = (int)n;
+
+    // Rate unknown until the first sample: take what comes.
+    if (!v->frame_ns || !v->first_sample_seen) return 1;
+    if (c->logged_frame_ns != v->frame_ns) {
+        c->logged_frame_ns = v->frame_ns;
+        log_pattern(v);
+    }
+
+    c->acc_ns += (guint64)n * g_vsync_ns;
+    int steps = 0;
+    while (c->acc_ns >= v->frame_ns) {
+        c->acc_ns -= v->frame_ns;
+        steps++;
+    }
+    return steps;
+}
+
+/* After the pulls: blend weight and judder for this vsync. */
+static void cadence_done(Video* v, int vsyncs, int wanted, int advanced)
+{
+    VideoCadence* c = &v->cad;
+    if (!v->frame_ns || !v->first_sample_seen) return;
+    if (advanced) c->shown++;
+
+    guint64 dev;
+    if (video_cadence_mode() == CADENCE_BLEND && v->frame_ns > g_vsync_ns) {
+        // Starved: hold the newest frame rather than swing back towards the previous one.
+        c->weight = (wanted && !advanced) ? 1.0f : (float)c->acc_ns / (float)v->frame_ns;
+        if (!vsyncs) return;
+        guint64 pos = c->shown * v->frame_ns + (guint64)(c->weight * v->frame_ns);
+        guint64 prev = c->last_pos_ns;
+        c->last_pos_ns = pos;
+        if (!prev || pos < prev) return;
+        dev = absdiff_ns(pos - prev, (guint64)vsyncs * g_vsync_ns);
+    } else {
+        c->weight = 1.0f;
+        c->held += (Uint32)vsyncs;
+        if (!advanced) return;
+        dev = absdiff_ns((guint64)c->held * g_vsync_ns, v->frame_ns);
+        c->held = 0;
+        if (c->shown < 2) return;   // the first frame's time on screen isn't a cadence
+    }
+
+    c->judder_n++;
+    c->judder_sum_ns += dev;
+    if (dev > c->judder_max_ns) c->judder_max_ns = dev;
+}
+
+/* Returns 1 when a new frame was due this render frame. */
+static int update_free(Video* v)
+{
+    int vsyncs;
+    int steps = cadence_steps(v, &vsyncs);
+
+    // Non-blocking pulls: never stall the render loop waiting for decode.
+    GstSample* sample = NULL;
+    for (int i = 0; i < steps; i++) {
+        GstSample* s = v->held ? v->held : pull_sample(v);
+        v->held = NULL;
+        if (!s) break;
+        if (sample) {
+            // Clip faster than the display: skip frames, evenly.
+            gst_sample_unref(sample);
+            v->frames.dropped++;
+            metrics_add(M_FRAMES_DROPPED, 1);
+        }
+        sample = s;
+    }
+    cadence_done(v, vsyncs, steps > 0, sample != NULL);
+    if (sample) {
+        present_sample(v, sample);
+        gst_sample_unref(sample);
+    }
+    return steps > 0;
+}
+
+#define DPROC_MAX_RESTARTS 5
+
+/*
+   The child died: the textures keep its last frame on screen while a new
+   one resumes just past it. A source that keeps killing its decoder
+   before delivering a frame is given up on (the last frame stays).
+*/
+static void isolated_restart(Video* v)
+{
+    GstClockTime at = GST_CLOCK_TIME_IS_VALID(v->frames.last_pts)
+                    ? v->frames.last_pts + v->frame_ns : 0;
+    dproc_stop(v->proc);
+    metrics_add(M_PIPELINE_RESTARTS, 1);
+
+    if (++v->proc_restarts > DPROC_MAX_RESTARTS || !dproc_start(v->proc, v->path, at)) {
+        log_error("[DPROC] giving up on %s after %d restarts", v->path, v->proc_restarts - 1);
+        free(v->proc);
+        v->proc = NULL;
+        v->playing = 0;
+        return;
+    }
+    if (v->paused)
+        dproc_set_paused(v->proc, 1);
+}
+
+/* Paced by the cadence like the free-running appsink path; same return. */
+static int update_isolated(Video* v)
+{
+    int vsyncs;
+    int steps = cadence_steps(v, &vsyncs);
+
+    DprocFrame f;
+    int have = 0;
+    for (int i = 0; i < steps; i++) {
+        DprocFrame next;
+        int r = dproc_next_frame(v->proc, &next);
+        if (r < 0) {
+            isolated_restart(v);
+            return 1;
+        }
+        if (r == 0) break;
+        note_decoded(v, next.pts);
+        if (have) {
+            dproc_release(v->proc, &f);
+            v->frames.dropped++;
+            metrics_add(M_FRAMES_DROPPED, 1);
+        }
+        f = next;
+        have = 1;
+    }
+
+    // The format changed while f was held: its layout no longer matches v->proc->fmt.
+    if (have && f.gen != v->proc->gen) {
+        dproc_release(v->proc, &f);
+        v->frames.dropped++;
+        metrics_add(M_FRAMES_DROPPED, 1);
+        have = 0;
+    }
+    cadence_done(v, vsyncs, steps > 0, have);
+    if (!have) return steps > 0;
+
+    const DprocFormat* fmt = &v->proc->fmt;
+    v->frame_ns = fmt->frame_ns;
+    v->video_range = fmt->video_range;
+    v->bt709 = fmt->bt709;
+    v->proc_restarts = 0;
+
+    set_interlace(v, (f.flags & DPROC_INTERLACED) != 0, (f.flags & DPROC_TFF) != 0);
+    upload_planes(v, fmt->width, fmt->height, fmt->has_alpha, (VideoDepth)fmt->depth, f.plane, f.stride);
+    dproc_release(v->proc, &f);
+
+    if (!v->first_sample_seen) {
+        v->first_sample_seen = 1;
+        log_first_sample(v);
+    }
+    return 1;
+}
+
+void video_update_texture(Video* v)
+{
+    if (!v || (!v->appsink && !v->proc)) return;
+
+    // Networked sync needs the pipeline's position: isolated sources run free.
+    // Cadence repeats are planned; only a due frame that didn't come counts as repeated.
+    guint64 uploaded = v->frames.uploaded;
+    int due = 1;
+    v->cad.weight = 1.0f;   // newest frame only, unless the blend cadence says otherwise
+    if (v->proc)
+        due = update_isolated(v);
+    else if (netsync_role() == SYNC_OFF || (due = update_synced(v)) < 0)
+        due = update_free(v);
+
+    if (!v->tex_inited) return;
+
+    // Second field once half the newest frame's period has passed (content time where paced).
+    if (v->interlaced && v->frame_ns) {
+        guint64 into_ns = v->cad.last_us ? v->cad.acc_ns : (time_now_us() - v->upload_us) * 1000;
+        v->field = (into_ns * 2 >= v->frame_ns);
+    }
+
+    v->frames.presented++;
+    if (due && v->frames.uploaded == uploaded) {
+        v->frames.repeated++;
+        metrics_add(M_FRAMES_REPEATED, 1);
+    }
+}
+
+/* ================= Watchdog ================= */
+
+#define VIDEO_WD_BACKOFF_MS     1000
+#define VIDEO_WD_BACKOFF_MAX_MS 30000
+
+static Uint64 stall_limit_us(const Video* v)
+{
+    if (!v->first_sample_seen) return VIDEO_START_STALL_MS * 1000ull;
+
+    Uint64 period_us = v->frame_ns ? v->frame_ns / 1000 : 1000000 / 30;
+    Uint64 us = period_us * VIDEO_STALL_FRAMES;
+    return (us < VIDEO_STALL_MIN_MS * 1000ull) ? VIDEO_STALL_MIN_MS * 1000ull : us;
+}
+
+/* New decoder for the same clip at its last position; the textures keep the last good frame up. */
+static int video_rebuild(Video* v)
+{
+    Video old = *v;
+    GstClockTime at = GST_CLOCK_TIME_IS_VALID(v->frames.last_pts) ? v->frames.last_pts : 0;
+    int gapless = (v->feed != NULL);
+    char path[1024];
+    snprintf(path, sizeof(path), "%s", v->path);
+
+    // A broken pipeline is never parked for reuse.
+    v->sig[0] = '\0';
+    video_stop(v);
+
+    int ok = gapless           ? video_start_gapless(v, path)
+           : dproc_enabled()   ? video_start_isolated(v, path, at)
+           : video_start_chain(v, path, 1);
+    if (!v->proc)
+        v->resume_at = at;
+
+    v->texY = old.texY;
+    v->texU = old.texU;
+    v->texV = old.texV;
+    v->texA = old.texA;
+    v->prevY = old.prevY;
+    v->prevU = old.prevU;
+    v->prevV = old.prevV;
+    v->prevA = old.prevA;
+    v->has_prev = old.has_prev;
+    v->pyr = old.pyr;
+    v->alpha = old.alpha;
+    v->depth = old.depth;
+    v->interlaced = old.interlaced;
+    v->tff = old.tff;
+    v->tex_inited = old.tex_inited;
+    v->upload_shift = old.upload_shift;
+    v->width = old.width;
+    v->height = old.height;
+    v->video_range = old.video_range;
+    v->bt709 = old.bt709;
+    v->frame_ns = old.frame_ns;
+    v->sync_base = old.sync_base;
+    v->duration_ns = old.duration_ns;
+    v->frames = old.frames;
+    v->cad = old.cad;
+    v->wd = old.wd;
+    v->wd.errors = 0;
+    if (old.paused)
+        video_set_paused(v, 1);
+    return ok;
+}
+
+VideoHealth video_watchdog(Video* v)
+{
+    if (!v || !v->path[0]) return VIDEO_HEALTHY;
+
+    VideoWatchdog* w = &v->wd;
+    Uint64 now = time_now_us();
+
+    // Paused sources aren't expected to decode; faults wait for the resume.
+    if (!w->progress_us || v->paused) {
+        w->progress_us = now;
+        w->decoded = v->frames.decoded;
+        return w->fault_us ? VIDEO_RECOVERING : VIDEO_HEALTHY;
+    }
+
+    if (v->frames.decoded != w->decoded) {
+        w->decoded = v->frames.decoded;
+        w->progress_us = now;
+        if (w->fault_us) {
+            Uint64 us = now - w->fault_us;
+            metrics_observe_us(H_RECOVERY, us);
+            log_info("[WD] %s: recovered after %.1f ms, %d rebuild(s)", v->path, us / 1000.0, w->attempts);
+            w->fault_us = 0;
+            w->attempts = 0;
+        }
+    }
+
+    if (!w->fault_us) {
+        const char* why = NULL;
+        if (v->errors != w->errors)
+            why = "bus error";
+        else if (!v->pipeline && !v->proc)
+            why = "decoder gone";
+        else if (now - w->progress_us > stall_limit_us(v))
+            why = "stalled";
+        w->errors = v->errors;
+        if (!why) return VIDEO_HEALTHY;
+
+        w->fault_us = now;
+        w->retry_us = now;
+        w->attempts = 0;
+        w->stalls++;
+        metrics_add(M_STALLS, 1);
+        log_warn("[WD] %s: %s, %.0f ms since the last frame", v->path, why, (now - w->progress_us) / 1000.0);
+    }
+
+    if (now < w->retry_us)
+        return (w->attempts > VIDEO_WD_REBUILDS) ? VIDEO_WANTS_SKIP : VIDEO_RECOVERING;
+
+    // 1 s, 2 s, 4 s ... between rebuilds, capped.
+    int shift = w->attempts < 5 ? w->attempts : 5;
+    Uint64 backoff_ms = (Uint64)VIDEO_WD_BACKOFF_MS << shift;
+    if (backoff_ms > VIDEO_WD_BACKOFF_MAX_MS) backoff_ms = VIDEO_WD_BACKOFF_MAX_MS;
+    w->attempts++;
+    w->retry_us = now + backoff_ms * 1000;
+
+    log_warn("[WD] %s: rebuild %d at %.3f s, next in %llu ms", v->path, w->attempts,
+             GST_CLOCK_TIME_IS_VALID(v->frames.last_pts) ? v->frames.last_pts / 1e9 : 0.0,
+             (unsigned long long)backoff_ms);
+    metrics_add(M_PIPELINE_RESTARTS, 1);
+    video_rebuild(v);
+    w->progress_us = now;
+
+    return (w->attempts > VIDEO_WD_REBUILDS) ? VIDEO_WANTS_SKIP : VIDEO_RECOVERING;
+}
+
+/* Copies s into out as the inside of a JSON string. */
+static void json_escape(const char* s, char* out, size_t n)
+{
+    size_t o = 0;
+    for (; *s && o + 7 < n; s++) {
+        unsigned char ch = (unsigned char)*s;
+        if (ch == '"' || ch == '\\') {
+            out[o++] = '\\';
+            out[o++] = (char)ch;
+        } else if (ch < 0x20) {
+            o += (size_t)snprintf(out + o, n - o, "\\u%04x", ch);
+        } else {
+            out[o++] = (char)ch;
+        }
+    }
+    out[o] = '\0';
 }
+
+/* Process CPU since the clip's first sample, per frame decoded after it. */
+static double cpu_ms_per_frame(const Video* v)
+{
+    const VideoFrameStats* f = &v->frames;
+    if (f->decoded < 2 || !f->cpu_us0) return 0.0;
+    return (process_cpu_us() - f->cpu_us0) / 1000.0 / (double)(f->decoded - 1);
+}
+
+int video_frames_json(const Video* v, char* buf, size_t n)
+{
+    const VideoFrameStats* f = &v->frames;
+    const char* name = strrchr(v->path, '/');
+    char clip[sizeof(v->path) * 2];
+    json_escape(name ? name + 1 : v->path, clip, sizeof(clip));
+    int w = snprintf(buf, n, "{\"clip\":\"%s\",\"decoded\":%llu,\"lost\":%llu,\"dropped\":%llu,"
+                             "\"uploaded\":%llu,\"presented\":%llu,\"repeated\":%llu,"
+                             "\"stalls\":%u,\"cadence\":\"%s\",\"judder_ms\":%.2f,\"judder_max_ms\":%.2f,"
+                             "\"format\":\"%s\",\"cpu_ms_per_frame\":%.3f}",
+                     clip,
+                     (unsigned long long)f->decoded, (unsigned long long)f->lost,
+                     (unsigned long long)f->dropped,
+                     (unsigned long long)f->uploaded, (unsigned long long)f->presented,
+                     (unsigned long long)f->repeated, v->wd.stalls,
+                     video_cadence_mode() == CADENCE_BLEND ? "blend" : "repeat",
+                     v->cad.judder_n ? v->cad.judder_sum_ns / 1e6 / v->cad.judder_n : 0.0,
+                     v->cad.judder_max_ns / 1e6,
+                     depth_name(v->depth, v->texA != 0), cpu_ms_per_frame(v));
+    return (w < 0 || (size_t)w >= n) ? 0 : w;
+}
+
+void video_log_frames(const Video* v, const char* who)
+{
+    const VideoFrameStats* f = &v->frames;
+    if (!f->decoded && !f->presented) return;
+
+    log_info("[FRAMES] %s %s: %llu decoded, %llu lost, %llu dropped, "
+             "%llu uploaded, %llu presented, %llu repeated (%.1f%%), judder %.2f ms (max %.2f), "
+             "%s, %.3f ms CPU/frame",
+             who, v->path,
+             (unsigned long long)f->decoded, (unsigned long long)f->lost,
+             (unsigned long long)f->dropped,
+             (unsigned long long)f->uploaded, (unsigned long long)f->presented,
+             (unsigned long long)f->repeated,
+             f->presented ? 100.0 * f->repeated / f->presented : 0.0,
+             v->cad.judder_n ? v->cad.judder_sum_ns / 1e6 / v->cad.judder_n : 0.0,
+             v->cad.judder_max_ns / 1e6,
+             depth_name(v->depth, v->texA != 0), cpu_ms_per_frame(v));
+}
+
@@ -5,20 +5,173 @@
 #include <gst/app/gstappsink.h>
 #include <gst/video/video.h>
 
+#include "media_index.h"
+#include "decoder_proc.h"
+
+/* Filled from decodebin's streaming threads; heap-owned so Video can be copied. */
+typedef struct {
+    MediaChain chain;
+    GstElement* decoder;
+} VideoLearn;
+
+/* Gapless playback: next clip handed to playbin from its streaming thread. */
+typedef struct {
+    GMutex lock;
+    char current[1024];   // last uri handed to playbin
+    char next[1024];      // queued for about-to-finish (empty = loop current)
+    int switched;         // about-to-finish fired; path updates on stream-start
+} GaplessFeed;
+
+typedef enum {
+    VIDEO_ALPHA_NONE = 0,
+    VIDEO_ALPHA_PLANE,     // A420: 4th plane in texA
+    VIDEO_ALPHA_PACKED     // side-by-side: colour left half, alpha as luma right half
+} VideoAlpha;
+
+/*
+   Sample depth as uploaded. 10-bit planes go up as split bytes (low byte
+   in luminance, high in alpha; P010's interleaved UV as RGBA) and are put
+   back together and dithered to the output in the fragment shader, so
+   decoders' native 10-bit output needs no CPU down-conversion.
+*/
+typedef enum {
+    VIDEO_DEPTH_8 = 0,     // I420 / A420
+    VIDEO_DEPTH_10,        // I420_10LE: value in the low 10 bits
+    VIDEO_DEPTH_P010       // P010_10LE: value in the high 10 bits, UV interleaved
+} VideoDepth;
+
+/*
+   Deinterlacing (MAPPER_DEINTERLACE). Interlaced frames are uploaded whole
+   with the buffer's field flags, and the YUV->RGB pass shows one field at a
+   time at twice the frame rate. Bob interpolates the missing lines from the
+   field's own; adaptive keeps the other field's lines (full vertical detail)
+   wherever they don't comb against it and bobs where they do.
+*/
+typedef enum {
+    DEINT_OFF = 0,
+    DEINT_BOB,
+    DEINT_ADAPTIVE
+} DeinterlaceMode;
+
+/*
+   Per-clip frame accounting (render thread). "repeated" means decode fell
+   behind (a new frame was due but none was decoded); "lost" and "dropped"
+   mean frames went missing before reaching the screen. CPU per frame is
+   the whole process's, to compare runs (e.g. MAPPER_10BIT=0 against 1).
+*/
+typedef struct {
+    guint64 decoded;       // samples pulled from the appsink
+    guint64 lost;          // PTS gaps: frames that never reached the appsink
+    guint64 dropped;       // pulled but discarded unshown (sync catch-up)
+    guint64 uploaded;      // samples uploaded to textures
+    guint64 presented;     // render frames that showed this clip
+    guint64 repeated;      // ... of which showed the previous sample again
+    GstClockTime last_pts; // NONE until the first timestamped sample
+    Uint64 cpu_us0;        // process CPU time at the first sample
+} VideoFrameStats;
+
+/*
+   Stall watchdog (render thread). A bus error, a dead decoder or no new
+   sample for VIDEO_STALL_FRAMES frame periods while playing is a fault;
+   the pipeline is rebuilt at the last position with exponential backoff.
+*/
+#define VIDEO_STALL_FRAMES   30
+#define VIDEO_STALL_MIN_MS   500
+#define VIDEO_START_STALL_MS 5000   // before the first sample
+#define VIDEO_WD_REBUILDS    3      // failed rebuilds before asking for a skip
+
+typedef enum {
+    VIDEO_HEALTHY = 0,
+    VIDEO_RECOVERING,
+    VIDEO_WANTS_SKIP       // rebuilds keep failing: move on if possible
+} VideoHealth;
+
+typedef struct {
+    guint64 decoded;       // frames.decoded at the last check
+    Uint64 progress_us;    // last time decoded moved (or playback started/resumed)
+    int errors;            // bus errors already acted on
+    Uint64 fault_us;       // 0 = healthy, else when the current fault was detected
+    Uint64 retry_us;       // next rebuild
+    int attempts;          // rebuilds since the fault began
+    Uint32 stalls;         // faults over the clip's lifetime
+} VideoWatchdog;
+
+/*
+   Cadence (free-running and isolated sources): each render frame the clip
+   advances by the vsyncs that passed times the display period, so 24p on
+   60 Hz shows frames for 3, 2, 3, 2 vsyncs and 25p on 50 Hz for exactly 2.
+   MAPPER_CADENCE=blend instead shows the two newest frames mixed by phase
+   (one frame later) when the clip is slower than the display.
+
+   Judder: in repeat mode, how far each frame's time on screen was from
+   the frame period; in blend mode, how far each vsync's step in shown
+   content time was from the vsync period.
+*/
+typedef enum {
+    CADENCE_REPEAT = 0,
+    CADENCE_BLEND
+} CadenceMode;
+
+typedef struct {
+    guint64 acc_ns;        // content time past the newest frame's slot
+    Uint64 last_us;        // previous render frame (0 = not started)
+    gint64 rem_ns;         // render time not yet counted as a whole vsync (can be negative)
+    float weight;          // blend: share of the newest frame over the previous one
+    guint64 shown;         // frames advanced
+    guint64 last_pos_ns;   // blend: content time on screen at the previous vsync
+    Uint32 held;           // repeat: vsyncs the newest frame has been up
+    guint64 judder_n;
+    guint64 judder_sum_ns;
+    guint64 judder_max_ns;
+    guint64 logged_frame_ns; // pattern logged for this rate
+} VideoCadence;
+
+/*
+   Minification pyramid (pyramid.h): half, quarter, ... size copies of the
+   newest frame's Y/U/V, built on the GPU when the warp shrinks the clip.
+*/
+typedef struct {
+    GLuint atlas;          // RGBA: level 1 left, 2..n stacked to its right
+    GLuint scratch;        // previous level while the next one renders
+    GLuint fbo;            // renders into atlas
+    int w1, h1;            // level 1 size
+    int levels;            // built for the newest frame (0 = not in use)
+    int wanted;            // levels the warp asked for last time (logged on change)
+    guint64 frame;         // frames.uploaded it was built from
+} VideoPyramid;
+
 typedef struct {
     GstElement* pipeline;
+    GstElement* src;
     GstElement* appsink;
     GstBus* bus;
 
     int width;
     int height;
 
-    // I420 textures
+    // I420 textures (+ full-res alpha plane for A420)
     GLuint texY;
     GLuint texU;
     GLuint texV;
+    GLuint texA;
+    VideoAlpha alpha;
+    VideoDepth depth;
+    int interlaced;        // newest frame carries two fields
+    int tff;               // ... top field first
+    int field;             // field on screen: 0 = first, 1 = second
+    Uint64 upload_us;      // newest frame went up
+
+    // Blend cadence: the frame before texY..texA (ping-ponged on upload)
+    GLuint prevY;
+    GLuint prevU;
+    GLuint prevV;
+    GLuint prevA;
+    int has_prev;
+
+    VideoPyramid pyr;
 
     int tex_inited;
+    int upload_shift;      // textures hold the planes at 1/2^shift size
 
     int video_range; // 1 = video range
     int bt709;       // 1 = BT.709
@@ -27,17 +180,73 @@ typedef struct {
     guint8* upload_y;
     guint8* upload_u;
     guint8* upload_v;
+    guint8* upload_a;
     size_t upload_y_size;
     size_t upload_u_size;
     size_t upload_v_size;
+    size_t upload_a_size;
 
     char path[1024];
     int playing;
+    int paused;            // PAUSED while its layer is occluded
+
+    int explicit_chain;    // built from the media index instead of decodebin
+    int reused;            // explicit chain taken from the idle pool
+    char sig[256];         // codec signature for pooling (empty = autoplugged)
+    VideoLearn* learn;     // decodebin only: records the chain it autoplugs
+    GaplessFeed* feed;     // long-lived playbin pipeline fed clip after clip
+    DecoderProc* proc;     // decodes in a child process instead (decoder_proc.h)
+    int proc_restarts;     // child respawns since the last frame it delivered
+    int errors;            // bus errors since start
+    GstClockTime resume_at; // watchdog rebuild: seek here once prerolled (0 = none)
+    VideoWatchdog wd;
+    VideoCadence cad;
+    Uint64 start_us;
+    int first_sample_seen;
+
+    // Networked sync (netsync.h): position = (shared_now - sync_base) mod duration
+    GstSample* held;       // decoded but not yet due
+    GstClockTime sync_base;
+    gint64 duration_ns;
+    guint64 frame_ns;
+    Uint64 last_reseek_us;
+
+    VideoFrameStats frames;
 } Video;
 
 void video_reset(Video* v);
 int  video_start(Video* v, const char* filename);
+int  video_start_gapless(Video* v, const char* filename);
+int  video_is_gapless(const Video* v);
+/* Returns 1 when nothing is queued; *tail is the clip that will play last. */
+int  video_gapless_wants_next(Video* v, char* tail, size_t tail_sz);
+void video_gapless_queue(Video* v, const char* filename);
 void video_stop(Video* v);
+void video_set_paused(Video* v, int paused);
 void video_delete_textures(Video* v);
 void video_poll_bus(Video* v);
 void video_update_texture(Video* v);
+/* Once per render frame for every active source, hidden or not. */
+VideoHealth video_watchdog(Video* v);
+
+/* Display refresh the cadence is paced against (display.h). */
+void video_set_display_rate(int refresh_hz);
+CadenceMode video_cadence_mode(void);
+
+DeinterlaceMode video_deinterlace_mode(void);
+/* Shader parameters for the field on screen: mode, parity (0 = top), texture rows. Returns the mode. */
+DeinterlaceMode video_field_params(const Video* v, float di[3]);
+
+/* Formats the sink accepts (MAPPER_10BIT=0 narrows them to I420/A420). */
+int  video_format_supported(GstVideoFormat fmt);
+VideoDepth video_depth_of(GstVideoFormat fmt);
+
+/* Texture sizes as uploaded (luma width, height, chroma width, height): the shader filters 10-bit planes itself. */
+void video_plane_size(const Video* v, float size[4]);
+
+/* Uploads from now on at 1/2^shift resolution (0 = full, max 2); textures resize on the next frame. */
+void video_set_upload_shift(int shift);
+
+/* Frame accounting for the current clip, as a JSON object / one log line. */
+int  video_frames_json(const Video* v, char* buf, size_t n);
+void video_log_frames(const Video* v, const char* who);
@@ -1,131 +1,395 @@
 #include "video_engine.h"
+#include "video_pipeline.h"
+#include "metrics.h"
+#include "netsync.h"
 #include <SDL2/SDL.h>
 #include <stdio.h>
 #include <string.h>
 
 /* ================= Engine lifecycle ================= */
 
+static void layer_defaults(Layer* l)
+{
+    memset(l, 0, sizeof(*l));
+    l->opacity = 1.0f;
+    l->blend_mode = BLEND_NORMAL;
+    l->rect[2] = 1.0f;
+    l->rect[3] = 1.0f;
+    l->pending_at = GST_CLOCK_TIME_NONE;
+    l->start_at = GST_CLOCK_TIME_NONE;
+    l->started_at = GST_CLOCK_TIME_NONE;
+}
+
 void ve_init(VideoEngine* ve)
 {
     memset(ve, 0, sizeof(*ve));
     ve->xfade_seconds = XFADE_SECONDS;
+    for (int i = 0; i < VE_MAX_LAYERS; i++)
+        layer_defaults(&ve->layers[i]);
+}
+
+VeMode ve_mode_from_string(const char* s)
+{
+    if (!s) return VE_MODE_CROSSFADE;
+    if (strcmp(s, "cut") == 0 || strcmp(s, "hardcut") == 0) return VE_MODE_HARDCUT;
+    if (strcmp(s, "gapless") == 0) return VE_MODE_GAPLESS;
+    return VE_MODE_CROSSFADE;
+}
+
+const char* ve_mode_name(VeMode m)
+{
+    switch (m) { case VE_MODE_HARDCUT: return "hardcut"; case VE_MODE_GAPLESS: return "gapless"; default: return "crossfade"; }
+}
+
+BlendMode ve_blend_from_string(const char* s)
+{
+    if (!s) return BLEND_NORMAL;
+    if (strcmp(s, "add") == 0) return BLEND_ADD;
+    if (strcmp(s, "multiply") == 0) return BLEND_MULTIPLY;
+    if (strcmp(s, "screen") == 0) return BLEND_SCREEN;
+    return BLEND_NORMAL;
+}
+
+void ve_set_mode(VideoEngine* ve, VeMode mode)
+{
+    if (ve->mode == mode) return;
+    ve->mode = mode;
+
+    log_info("[VE] Mode = %s", ve_mode_name(mode));
+}
+
+void ve_set_transition(VideoEngine* ve, TransitionKind kind, Easing easing)
+{
+    ve->transition = kind;
+    ve->easing = easing;
+
+    log_info("[VE] Transition = %s (%s)", transition_name(kind), easing_name(easing));
+}
+
+void ve_set_next_provider(VideoEngine* ve, VeNextFn fn, void* user)
+{
+    ve->next_fn = fn;
+    ve->next_user = user;
+}
+
+Layer* ve_base(VideoEngine* ve)
+{
+    return &ve->layers[VE_BASE_LAYER];
+}
+
+static Layer* ve_layer(VideoEngine* ve, int idx)
+{
+    if (idx < 0 || idx >= VE_MAX_LAYERS) return NULL;
+    return &ve->layers[idx];
+}
+
+/* Only the playlist layer is fed gaplessly; overlays simply loop. */
+static int ve_video_start(VideoEngine* ve, int idx, Video* v, const char* path)
+{
+    if (ve->mode == VE_MODE_GAPLESS && idx == VE_BASE_LAYER)
+        return video_start_gapless(v, path);
+    return video_start(v, path);
 }
 
 int ve_start_current(VideoEngine* ve, const char* path)
 {
-    if (!video_start(&ve->cur, path))
+    return ve_layer_load(ve, VE_BASE_LAYER, path);
+}
+
+/* Takes ownership of a pipeline that was started elsewhere (boot worker). */
+void ve_adopt_current(VideoEngine* ve, const Video* started)
+{
+    Layer* l = ve_base(ve);
+    l->cur = *started;
+    l->active = 1;
+
+    log_info("[VE] Current = %s", l->cur.path);
+}
+
+void ve_request_transition(VideoEngine* ve, const char* path)
+{
+    ve_layer_request_transition(ve, VE_BASE_LAYER, path);
+}
+
+/* ================= Layer stack ================= */
+
+int ve_layer_load(VideoEngine* ve, int idx, const char* path)
+{
+    Layer* l = ve_layer(ve, idx);
+    if (!l || !path || !path[0]) return 0;
+
+    if (l->active) {
+        ve_layer_request_transition(ve, idx, path);
+        return 1;
+    }
+
+    if (!ve_video_start(ve, idx, &l->cur, path))
         return 0;
+    l->active = 1;
+    l->hidden = 0;
 
-    printf("[VE] Current = %s\n", ve->cur.path);
-    fflush(stdout);
+    log_info("[VE] Layer %d current = %s", idx, l->cur.path);
     return 1;
 }
 
-void ve_request_transition(VideoEngine* ve, const char* path)
+void ve_layer_unload(VideoEngine* ve, int idx)
+{
+    Layer* l = ve_layer(ve, idx);
+    if (!l || !l->active) return;
+
+    float opacity = l->opacity;
+    BlendMode mode = l->blend_mode;
+    float rect[4] = { l->rect[0], l->rect[1], l->rect[2], l->rect[3] };
+
+    char who[32];
+    snprintf(who, sizeof(who), "layer %d", idx);
+    video_log_frames(&l->cur, who);
+
+    video_stop(&l->cur);
+    video_stop(&l->nxt);
+    video_delete_textures(&l->cur);
+    video_delete_textures(&l->nxt);
+
+    // Presentation settings survive so a reload lands in the same place.
+    layer_defaults(l);
+    l->opacity = opacity;
+    l->blend_mode = mode;
+    memcpy(l->rect, rect, sizeof(rect));
+
+    log_info("[VE] Layer %d unloaded", idx);
+}
+
+void ve_layer_request_transition(VideoEngine* ve, int idx, const char* path)
+{
+    Layer* l = ve_layer(ve, idx);
+    if (!l || !path || !path[0]) return;
+
+    snprintf(l->pending_path, sizeof(l->pending_path), "%s", path);
+    l->pending = 1;
+    l->pending_at = GST_CLOCK_TIME_NONE;
+    l->requested_us = time_now_us();
+
+    log_info("[VE] Layer %d transition requested -> %s", idx, path);
+}
+
+void ve_layer_schedule_transition(VideoEngine* ve, int idx, const char* path, GstClockTime at)
 {
-    if (!path || !path[0]) return;
+    Layer* l = ve_layer(ve, idx);
+    if (!l || !path || !path[0]) return;
 
-    snprintf(ve->pending_path, sizeof(ve->pending_path), "%s", path);
-    ve->pending = 1;
+    // A transition still running would delay the preroll past `at`: finish it now.
+    if (l->transitioning && l->xfade_start_ms != 0)
+        l->xfade_start_ms = 1;
 
-    printf("[VE] Transition requested -> %s\n", path);
-    fflush(stdout);
+    snprintf(l->pending_path, sizeof(l->pending_path), "%s", path);
+    l->pending = 1;
+    l->pending_at = at;
+    l->requested_us = time_now_us();
+
+    log_info("[VE] Layer %d transition scheduled -> %s", idx, path);
+}
+
+void ve_layer_set_opacity(VideoEngine* ve, int idx, float opacity)
+{
+    Layer* l = ve_layer(ve, idx);
+    if (!l) return;
+    l->opacity = (opacity < 0.0f) ? 0.0f : (opacity > 1.0f) ? 1.0f : opacity;
+}
+
+void ve_layer_set_blend(VideoEngine* ve, int idx, BlendMode mode)
+{
+    Layer* l = ve_layer(ve, idx);
+    if (!l) return;
+    l->blend_mode = mode;
 }
 
-static void ve_try_start_next(VideoEngine* ve)
+void ve_layer_set_rect(VideoEngine* ve, int idx, float x, float y, float w, float h)
 {
-    if (!ve->pending || ve->transitioning)
+    Layer* l = ve_layer(ve, idx);
+    if (!l || w <= 0.0f || h <= 0.0f) return;
+    l->rect[0] = x;
+    l->rect[1] = y;
+    l->rect[2] = w;
+    l->rect[3] = h;
+}
+
+/* Set by the compositor: hidden layers stop decoding until they show again. */
+void ve_layer_set_hidden(VideoEngine* ve, int idx, int hidden)
+{
+    Layer* l = ve_layer(ve, idx);
+    if (!l || !l->active || l->hidden == hidden) return;
+
+    l->hidden = hidden;
+    video_set_paused(&l->cur, hidden);
+    if (l->transitioning)
+        video_set_paused(&l->nxt, hidden);
+
+    log_info("[VE] Layer %d %s", idx, hidden ? "hidden (decoders paused)" : "visible");
+}
+
+/* ================= Update ================= */
+
+static void layer_try_start_next(VideoEngine* ve, int idx)
+{
+    Layer* l = &ve->layers[idx];
+    if (!l->pending || l->transitioning)
+        return;
+
+    if (!l->active) {
+        l->pending = 0;
+        ve_layer_load(ve, idx, l->pending_path);
         return;
+    }
 
-    if (!video_start(&ve->nxt, ve->pending_path)) {
-        ve->pending = 0;
+    if (!ve_video_start(ve, idx, &l->nxt, l->pending_path)) {
+        l->pending = 0;
         return;
     }
 
-    ve->pending = 0;
-    ve->transitioning = 1;
-    ve->blend = 0.0f;
-    ve->xfade_start_ms = 0;
+    if (l->hidden)
+        video_set_paused(&l->nxt, 1);
+
+    l->pending = 0;
+    l->transitioning = 1;
+    l->blend = 0.0f;
+    l->xfade_start_ms = 0;
+    l->transition = ve->transition;
+    l->easing = ve->easing;
 
-    printf("[VE] Next started: %s\n", ve->nxt.path);
-    fflush(stdout);
+    // Scheduled: clip position 0 lands on `at` on every node.
+    l->start_at = l->pending_at;
+    if (GST_CLOCK_TIME_IS_VALID(l->start_at))
+        l->nxt.sync_base = l->start_at;
+    l->pending_at = GST_CLOCK_TIME_NONE;
+
+    log_info("[VE] Layer %d next started: %s", idx, l->nxt.path);
 }
 
-void ve_update(VideoEngine* ve)
+/* Keep the gapless pipeline's about-to-finish slot filled with the next clip. */
+static void ve_feed_gapless(VideoEngine* ve)
+{
+    Layer* l = ve_base(ve);
+    if (ve->mode != VE_MODE_GAPLESS || !ve->next_fn || !video_is_gapless(&l->cur))
+        return;
+
+    char tail[1024];
+    if (!video_gapless_wants_next(&l->cur, tail, sizeof(tail)))
+        return;
+
+    const char* next = ve->next_fn(ve->next_user, tail);
+    if (next)
+        video_gapless_queue(&l->cur, next);
+}
+
+static void layer_update(VideoEngine* ve, int idx)
 {
-    video_poll_bus(&ve->cur);
-    if (ve->transitioning)
-        video_poll_bus(&ve->nxt);
+    Layer* l = &ve->layers[idx];
 
-    video_update_texture(&ve->cur);
-    if (ve->transitioning)
-        video_update_texture(&ve->nxt);
+    if (!l->active) {
+        layer_try_start_next(ve, idx);
+        return;
+    }
+
+    video_poll_bus(&l->cur);
+    if (l->transitioning)
+        video_poll_bus(&l->nxt);
+
+    // Hidden layers are paused; nothing new to upload.
+    if (!l->hidden) {
+        video_update_texture(&l->cur);
+        if (l->transitioning)
+            video_update_texture(&l->nxt);
+    }
 
-    if (ve->transitioning) {
-        if (ve->xfade_start_ms == 0 && ve->nxt.tex_inited) {
-            ve->xfade_start_ms = SDL_GetTicks();
-            ve->blend = 0.0f;
+    // Broken decoders are rebuilt in place; the playlist layer moves past clips that stay broken.
+    if (video_watchdog(&l->cur) == VIDEO_WANTS_SKIP && idx == VE_BASE_LAYER &&
+        !l->transitioning && !l->pending && ve->next_fn) {
+        const char* next = ve->next_fn(ve->next_user, l->cur.path);
+        if (next && strcmp(next, l->cur.path) != 0) {
+            log_warn("[WD] layer %d: giving up on %s, skipping to %s", idx, l->cur.path, next);
+            metrics_add(M_STALL_SKIPS, 1);
+            ve_layer_request_transition(ve, idx, next);
         }
+    }
+    if (l->transitioning)
+        video_watchdog(&l->nxt);
+
+    if (l->transitioning) {
+        if (l->xfade_start_ms == 0 && l->nxt.tex_inited) {
+            if (!GST_CLOCK_TIME_IS_VALID(l->start_at)) {
+                l->xfade_start_ms = SDL_GetTicks();
+                l->blend = 0.0f;
+            } else {
+                GstClockTime now = netsync_now();
+                if (!GST_CLOCK_TIME_IS_VALID(now) || now >= l->start_at) {
+                    // Back-date by how late this vsync is so progress matches other nodes.
+                    Uint32 late_ms = GST_CLOCK_TIME_IS_VALID(now) ? (Uint32)((now - l->start_at) / GST_MSECOND) : 0;
+                    l->xfade_start_ms = SDL_GetTicks() - late_ms;
+                    if (l->xfade_start_ms == 0) l->xfade_start_ms = 1;
+                    l->blend = 0.0f;
+                    l->started_at = l->start_at;
+                }
+            }
 
-        if (ve->xfade_start_ms != 0) {
+            if (l->xfade_start_ms != 0) {
+                metrics_add(M_TRANSITIONS, 1);
+                if (l->requested_us)
+                    metrics_observe_us(H_TRANSITION_LATENCY, time_now_us() - l->requested_us);
+                l->requested_us = 0;
+            }
+        }
+
+        if (l->xfade_start_ms != 0) {
             Uint32 now = SDL_GetTicks();
-            float t = (now - ve->xfade_start_ms) / 1000.0f;
-            ve->blend = t / ve->xfade_seconds;
+            float t = (now - l->xfade_start_ms) / 1000.0f;
+            float secs = (ve->mode == VE_MODE_HARDCUT) ? 0.0f : ve->xfade_seconds;
+            float lin = (secs > 0.0f) ? t / secs : 1.0f;
+            l->blend = ease(l->easing, lin);
+
+            if (lin >= 1.0f) {
+                char who[32];
+                snprintf(who, sizeof(who), "layer %d", idx);
+                video_log_frames(&l->cur, who);
 
-            if (ve->blend >= 1.0f) {
-                video_stop(&ve->cur);
-                video_delete_textures(&ve->cur);
+                video_stop(&l->cur);
+                video_delete_textures(&l->cur);
 
-                ve->cur = ve->nxt;
-                video_reset(&ve->nxt);
+                l->cur = l->nxt;
+                video_reset(&l->nxt);
 
-                ve->transitioning = 0;
-                ve->blend = 0.0f;
-                ve->xfade_start_ms = 0;
+                l->transitioning = 0;
+                l->blend = 0.0f;
+                l->xfade_start_ms = 0;
+                l->start_at = GST_CLOCK_TIME_NONE;
 
-                printf("[VE] Transition complete\n");
-                fflush(stdout);
+                log_info("[VE] Layer %d transition complete", idx);
             }
         }
     } else {
-        ve_try_start_next(ve);
+        layer_try_start_next(ve, idx);
     }
 }
 
-/* ================= Rendering helpers ================= */
-
-/*
-   Binds textures for ONE video.
-   Blending is handled outside via glBlendFunc.
-*/
-void ve_bind_video_textures(Video* v,
-                            GLint uTexY,
-                            GLint uTexU,
-                            GLint uTexV)
+void ve_update(VideoEngine* ve)
 {
-    if (!v->tex_inited)
-        return;
+    for (int i = 0; i < VE_MAX_LAYERS; i++)
+        layer_update(ve, i);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, v->texY);
-    glUniform1i(uTexY, 0);
-
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, v->texU);
-    glUniform1i(uTexU, 1);
-
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, v->texV);
-    glUniform1i(uTexV, 2);
+    if (!ve_base(ve)->transitioning)
+        ve_feed_gapless(ve);
 }
 
 /* ================= Shutdown ================= */
 
 void ve_shutdown(VideoEngine* ve)
 {
-    video_stop(&ve->cur);
-    video_stop(&ve->nxt);
-    video_delete_textures(&ve->cur);
-    video_delete_textures(&ve->nxt);
+    for (int i = 0; i < VE_MAX_LAYERS; i++) {
+        Layer* l = &ve->layers[i];
+        video_stop(&l->cur);
+        video_stop(&l->nxt);
+        video_delete_textures(&l->cur);
+        video_delete_textures(&l->nxt);
+    }
+    vpipe_pool_clear();
     memset(ve, 0, sizeof(*ve));
 }
@@ -1,26 +1,91 @@
 #pragma once
 #include "common.h"
 #include "video.h"
+#include "transitions.h"
 
+#define VE_MAX_LAYERS 8
+#define VE_BASE_LAYER 0   // playlist layer, bottom of the stack
+
+typedef enum {
+    VE_MODE_CROSSFADE = 0,  // requests crossfade over xfade_seconds
+    VE_MODE_HARDCUT,        // requests cut on the first decoded frame
+    VE_MODE_GAPLESS         // clips advance back-to-back in one pipeline;
+                            // explicit requests still crossfade
+} VeMode;
+
+typedef enum {
+    BLEND_NORMAL = 0,
+    BLEND_ADD,
+    BLEND_MULTIPLY,
+    BLEND_SCREEN
+} BlendMode;
+
+/* Render-thread callback choosing the clip after `current` (gapless mode). */
+typedef const char* (*VeNextFn)(void* user, const char* current);
+
+/*
+   One entry of the layer stack. Each layer owns its source and its own
+   cur -> nxt transition; the stack is composited bottom (index 0) to top.
+*/
 typedef struct {
     Video cur;
     Video nxt;
     int transitioning;
 
-    float blend;               // 0..1
+    float blend;               // 0..1 eased progress of nxt over cur
     Uint32 xfade_start_ms;
-    float xfade_seconds;
+    TransitionKind transition; // style latched when nxt starts
+    Easing easing;
 
     char pending_path[1024];   // requested next
     int pending;               // request queued
+    Uint64 requested_us;       // when the pending request arrived (metrics)
+    GstClockTime pending_at;   // shared-clock start for scheduled requests
+    GstClockTime start_at;     // NONE: start as soon as nxt has a frame
+    GstClockTime started_at;   // start_at of the last scheduled transition that began
+
+    int active;                // has a source
+    float opacity;             // 0..1
+    BlendMode blend_mode;
+    float rect[4];             // x, y, w, h on the warped surface (0..1)
+    int hidden;                // occluded or invisible: decoders paused
+} Layer;
+
+typedef struct {
+    Layer layers[VE_MAX_LAYERS];
+    float xfade_seconds;
+    TransitionKind transition;  // style for transitions started from now on
+    Easing easing;
+
+    VeMode mode;
+    VeNextFn next_fn;
+    void* next_user;
 } VideoEngine;
 
+VeMode ve_mode_from_string(const char* s);
+const char* ve_mode_name(VeMode m);
+BlendMode ve_blend_from_string(const char* s);
+
 void ve_init(VideoEngine* ve);
 int  ve_start_current(VideoEngine* ve, const char* path);
+void ve_adopt_current(VideoEngine* ve, const Video* started);
+void ve_set_mode(VideoEngine* ve, VeMode mode);
+void ve_set_transition(VideoEngine* ve, TransitionKind kind, Easing easing);
+void ve_set_next_provider(VideoEngine* ve, VeNextFn fn, void* user);
 void ve_request_transition(VideoEngine* ve, const char* path);
 void ve_update(VideoEngine* ve);
 void ve_shutdown(VideoEngine* ve);
-void ve_bind_video_textures(Video* v,
-                            GLint uTexY,
-                            GLint uTexU,
-                            GLint uTexV);
+
+/* Base layer (playlist) shorthand. */
+Layer* ve_base(VideoEngine* ve);
+
+/* Layer stack. Loading into an active layer transitions it. */
+int  ve_layer_load(VideoEngine* ve, int idx, const char* path);
+void ve_layer_unload(VideoEngine* ve, int idx);
+void ve_layer_request_transition(VideoEngine* ve, int idx, const char* path);
+/* Prerolls now, starts the transition at shared-clock time `at` (netsync.h). */
+void ve_layer_schedule_transition(VideoEngine* ve, int idx, const char* path, GstClockTime at);
+void ve_layer_set_opacity(VideoEngine* ve, int idx, float opacity);
+void ve_layer_set_blend(VideoEngine* ve, int idx, BlendMode mode);
+void ve_layer_set_rect(VideoEngine* ve, int idx, float x, float y, float w, float h);
+void ve_layer_set_hidden(VideoEngine* ve, int idx, int hidden);
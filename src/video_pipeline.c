@@ -0,0 +1,276 @@
+#include "video_pipeline.h"
+#include "metrics.h"
+#include "video.h"
+
+#define DECODE_INTERVAL_MAX_US 1000000   // longer gaps are pauses or stalls, not decoding
+
+static GMutex g_pool_lock;
+static VideoPipeline g_pool[VIDEO_POOL_MAX];
+static int g_pool_count = 0;
+
+void vpipe_signature(const MediaChain* c, char* out, size_t out_sz)
+{
+    snprintf(out, out_sz, "%s|%s|%s|%s", c->demux, c->caps, c->parser, c->decoder);
+}
+
+static GstElement* make_in(VideoPipeline* p, GstElement* bin, const char* factory, const char* name)
+{
+    GstElement* e = gst_element_factory_make(factory, name);
+    if (!e) {
+        log_warn("[PIPE] missing element: %s", factory);
+        return NULL;
+    }
+    gst_bin_add(GST_BIN(bin), e);
+    p->elements++;
+    return e;
+}
+
+static GstElement* make(VideoPipeline* p, const char* factory, const char* name)
+{
+    return make_in(p, p->pipeline, factory, name);
+}
+
+/* Every decoded frame enters the sink tail once, on the streaming thread. */
+static GstPadProbeReturn on_decoded(GstPad* pad, GstPadProbeInfo* info, gpointer user)
+{
+    (void)pad;
+    Uint64* last = (Uint64*)user;
+    GstBuffer* b = GST_PAD_PROBE_INFO_BUFFER(info);
+    Uint64 now = time_now_us();
+
+    // A seek or the next gapless clip starts a new run of frames.
+    if (*last && b && !GST_BUFFER_FLAG_IS_SET(b, GST_BUFFER_FLAG_DISCONT) &&
+        now - *last < DECODE_INTERVAL_MAX_US)
+        metrics_observe_us(H_DECODE_INTERVAL, now - *last);
+    *last = now;
+    return GST_PAD_PROBE_OK;
+}
+
+/* videoconvert ! video/x-raw,format={I420,A420,I420_10LE,P010_10LE} ! appsink; returns the convert head.
+   videoconvert keeps A420 for alpha sources and passes 10-bit decoder output through
+   untouched; everything else becomes I420. MAPPER_10BIT=0 forces 10-bit to I420 too. */
+static GstElement* make_sink_tail(VideoPipeline* p, GstElement* bin)
+{
+    GstElement* conv = make_in(p, bin, "videoconvert", NULL);
+    GstElement* filt = make_in(p, bin, "capsfilter", NULL);
+    GstElement* sink = make_in(p, bin, "appsink", "sink");
+    if (!conv || !filt || !sink) return NULL;
+
+    GstCaps* want = gst_caps_from_string(video_format_supported(GST_VIDEO_FORMAT_P010_10LE)
+                                             ? "video/x-raw,format={ I420, A420, I420_10LE, P010_10LE }"
+                                             : "video/x-raw,format={ I420, A420 }");
+    g_object_set(filt, "caps", want, NULL);
+    gst_caps_unref(want);
+
+    // Frames are paced by the render loop; a short queue keeps decode just ahead.
+    g_object_set(sink, "sync", FALSE, "max-buffers", 4, "drop", FALSE, NULL);
+
+    if (!gst_element_link_many(conv, filt, sink, NULL)) return NULL;
+
+    GstPad* pad = gst_element_get_static_pad(conv, "sink");
+    if (pad) {
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_decoded, g_new0(Uint64, 1), g_free);
+        gst_object_unref(pad);
+    }
+
+    p->appsink = (GstElement*)gst_object_ref(sink);
+    return conv;
+}
+
+static int pad_caps_named(GstPad* pad, const char* want)
+{
+    GstCaps* caps = gst_pad_get_current_caps(pad);
+    if (!caps) caps = gst_pad_query_caps(pad, NULL);
+    if (!caps) return 0;
+
+    int ok = gst_caps_get_size(caps) > 0 &&
+             strcmp(gst_structure_get_name(gst_caps_get_structure(caps, 0)), want) == 0;
+    gst_caps_unref(caps);
+    return ok;
+}
+
+/* Demuxer/decodebin pads appear on every READY->PAUSED, so this stays connected. */
+static void on_dynamic_pad(GstElement* el, GstPad* pad, gpointer user)
+{
+    GstElement* head = (GstElement*)user;
+    GstPad* sink = gst_element_get_static_pad(head, "sink");
+    if (!sink) return;
+
+    if (!gst_pad_is_linked(sink)) {
+        const char* want = (const char*)g_object_get_data(G_OBJECT(head), "want-caps");
+        if (pad_caps_named(pad, want ? want : "video/x-raw"))
+            gst_pad_link(pad, sink);
+    }
+    gst_object_unref(sink);
+}
+
+static int begin(VideoPipeline* p)
+{
+    memset(p, 0, sizeof(*p));
+    p->pipeline = gst_pipeline_new(NULL);
+    if (!p->pipeline) return 0;
+    p->elements = 1;
+
+    p->src = make(p, "filesrc", "src");
+    if (!p->src) return 0;
+    gst_object_ref(p->src);
+    return 1;
+}
+
+int vpipe_build_explicit(VideoPipeline* p, const MediaChain* c)
+{
+    if (!begin(p)) goto fail;
+
+    GstElement* demux = make(p, c->demux, "demux");
+    GstElement* head  = make(p, "capsfilter", NULL);
+    GstElement* parse = c->parser[0] ? make(p, c->parser, NULL) : NULL;
+    GstElement* queue = make(p, "queue", NULL);
+    GstElement* dec   = make(p, c->decoder, NULL);
+    GstElement* conv  = make_sink_tail(p, p->pipeline);
+
+    if (!demux || !head || (c->parser[0] && !parse) || !queue || !dec || !conv)
+        goto fail;
+
+    GstCaps* caps = gst_caps_new_empty_simple(c->caps);
+    g_object_set(head, "caps", caps, NULL);
+    gst_caps_unref(caps);
+    g_object_set_data_full(G_OBJECT(head), "want-caps", g_strdup(c->caps), g_free);
+
+    if (!gst_element_link(p->src, demux))
+        goto fail;
+    if (parse ? !gst_element_link_many(head, parse, queue, dec, conv, NULL)
+              : !gst_element_link_many(head, queue, dec, conv, NULL))
+        goto fail;
+
+    g_signal_connect(demux, "pad-added", G_CALLBACK(on_dynamic_pad), head);
+
+    vpipe_signature(c, p->sig, sizeof(p->sig));
+    return 1;
+
+fail:
+    vpipe_destroy(p);
+    return 0;
+}
+
+int vpipe_build_decodebin(VideoPipeline* p)
+{
+    if (!begin(p)) goto fail;
+
+    GstElement* dbin = make(p, "decodebin", "decodebin");
+    GstElement* conv = make_sink_tail(p, p->pipeline);
+    if (!dbin || !conv)
+        goto fail;
+    if (!gst_element_link(p->src, dbin))
+        goto fail;
+
+    g_signal_connect(dbin, "pad-added", G_CALLBACK(on_dynamic_pad), conv);
+    return 1;
+
+fail:
+    vpipe_destroy(p);
+    return 0;
+}
+
+#define PLAY_FLAG_VIDEO        (1 << 0)
+#define PLAY_FLAG_NATIVE_VIDEO (1 << 6)   // skip playsink's own convert/scale
+
+int vpipe_build_gapless(VideoPipeline* p)
+{
+    memset(p, 0, sizeof(*p));
+
+    GstElement* pb = gst_element_factory_make("playbin3", "player");
+    if (!pb) pb = gst_element_factory_make("playbin", "player");
+    if (!pb) {
+        log_warn("[PIPE] missing element: playbin3/playbin");
+        return 0;
+    }
+    p->pipeline = pb;
+    p->src = (GstElement*)gst_object_ref(pb);
+    p->elements = 1;
+
+    // The appsink tail lives in a bin handed to playbin as its video sink.
+    GstElement* bin = gst_bin_new("vsink");
+    GstElement* conv = make_sink_tail(p, bin);
+    if (!conv) {
+        gst_object_unref(bin);
+        goto fail;
+    }
+
+    GstPad* sink = gst_element_get_static_pad(conv, "sink");
+    gst_element_add_pad(bin, gst_ghost_pad_new("sink", sink));
+    gst_object_unref(sink);
+
+    g_object_set(pb, "video-sink", bin, "flags", PLAY_FLAG_VIDEO | PLAY_FLAG_NATIVE_VIDEO, NULL);
+    return 1;
+
+fail:
+    vpipe_destroy(p);
+    return 0;
+}
+
+void vpipe_destroy(VideoPipeline* p)
+{
+    if (p->pipeline) gst_element_set_state(p->pipeline, GST_STATE_NULL);
+
+    if (p->appsink)  gst_object_unref(p->appsink);
+    if (p->src)      gst_object_unref(p->src);
+    if (p->pipeline) gst_object_unref(p->pipeline);
+    memset(p, 0, sizeof(*p));
+}
+
+/* ================= Idle pool ================= */
+
+int vpipe_pool_take(VideoPipeline* p, const char* sig)
+{
+    int found = 0;
+
+    g_mutex_lock(&g_pool_lock);
+    for (int i = 0; i < g_pool_count; i++) {
+        if (strcmp(g_pool[i].sig, sig) != 0) continue;
+        *p = g_pool[i];
+        g_pool[i] = g_pool[--g_pool_count];
+        found = 1;
+        break;
+    }
+    g_mutex_unlock(&g_pool_lock);
+
+    if (found) p->elements = 0;
+    return found;
+}
+
+int vpipe_pool_put(VideoPipeline* p)
+{
+    if (!p->pipeline || !p->sig[0]) return 0;
+
+    // READY drops the demuxer pads and decoder buffers but keeps the graph.
+    if (gst_element_set_state(p->pipeline, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE)
+        return 0;
+
+    GstBus* bus = gst_element_get_bus(p->pipeline);
+    if (bus) {
+        GstMessage* msg;
+        while ((msg = gst_bus_pop(bus)) != NULL)
+            gst_message_unref(msg);
+        gst_object_unref(bus);
+    }
+
+    int pooled = 0;
+    g_mutex_lock(&g_pool_lock);
+    if (g_pool_count < VIDEO_POOL_MAX) {
+        g_pool[g_pool_count++] = *p;
+        pooled = 1;
+    }
+    g_mutex_unlock(&g_pool_lock);
+
+    if (pooled) memset(p, 0, sizeof(*p));
+    return pooled;
+}
+
+void vpipe_pool_clear(void)
+{
+    g_mutex_lock(&g_pool_lock);
+    for (int i = 0; i < g_pool_count; i++)
+        vpipe_destroy(&g_pool[i]);
+    g_pool_count = 0;
+    g_mutex_unlock(&g_pool_lock);
+}
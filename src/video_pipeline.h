@@ -0,0 +1,35 @@
+#pragma once
+#include "common.h"
+#include "media_index.h"
+
+/*
+  Programmatic decode pipelines + a small pool of idle ones.
+
+  Explicit chains (from the media index) carry a codec signature. When a
+  clip ends, its pipeline is parked in READY; a later clip with the same
+  signature takes it back by swapping filesrc's location, so the graph,
+  the decoder instance and the appsink are not rebuilt.
+*/
+
+#define VIDEO_POOL_MAX 2
+
+typedef struct {
+    GstElement* pipeline;
+    GstElement* src;
+    GstElement* appsink;
+    char sig[256];   // empty: autoplugged, never pooled
+    int elements;    // elements created for this start (0 when reused)
+} VideoPipeline;
+
+void vpipe_signature(const MediaChain* c, char* out, size_t out_sz);
+
+int  vpipe_build_explicit(VideoPipeline* p, const MediaChain* c);
+int  vpipe_build_decodebin(VideoPipeline* p);
+
+/* playbin3 (video only) into the appsink tail; p->src is the playbin ("uri"). */
+int  vpipe_build_gapless(VideoPipeline* p);
+void vpipe_destroy(VideoPipeline* p);
+
+int  vpipe_pool_take(VideoPipeline* p, const char* sig);
+int  vpipe_pool_put(VideoPipeline* p);
+void vpipe_pool_clear(void);